@@ -0,0 +1,385 @@
+#include "batch_mode.h"
+#include "bulk_update.h"
+#include "file_handler.h"
+#include "operations.h"
+#include "price_cleanup.h"
+#include "profiler.h"
+#include "server.h"
+#include "logger.h"
+#include "sheet_import.h"
+#include "snapshot.h"
+#include "stream_sync.h"
+#include "thread_pool.h"
+#include "xlsx_writer.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Pipeline steps, run in the order given to --ops
+const char* const kOperations[] = {"clean-price", "update-stock", "update-price", "sync", "sort", "nan-to-zero", "home-nursing"};
+
+struct BatchOptions {
+    string stockPath, pricePath, appPath;
+    string stockUpdatesPath, priceUpdatesPath;
+    string outPath, stockOutPath, priceOutPath, xlsxPath, logPath, profilePath, snapshotDir;
+    vector<string> ops;
+    bool stream = false;
+    string memoryBudget, tempDir;
+};
+
+void printUsage(ostream& out) {
+    out << "Usage:\n"
+           "  pharmacy                       start the interactive menu\n"
+           "  pharmacy sync [options]        run operations without prompts\n"
+           "  pharmacy serve [options]       keep the sheets loaded and answer lookups, updates and\n"
+           "                                 syncs on a Unix socket (requests listed in server.h)\n"
+           "\n"
+           "Options:\n"
+           "  --stock FILE        Stock Sheet (.csv, .html, .htm, .xlsx or .xls)\n"
+           "  --price FILE        Price Sheet\n"
+           "  --app FILE          App Sheet\n"
+           "  --ops LIST          comma separated steps, run in order:\n"
+           "                        clean-price   menu options 10-14 on the Price Sheet\n"
+           "                        update-stock  apply the --stock-updates file to the Stock Sheet totals\n"
+           "                        update-price  apply the --price-updates file to the Price Sheet prices\n"
+           "                                      (as loaded, so list it before clean-price)\n"
+           "                        sync          update App Sheet price/stock (option 5)\n"
+           "                        sort          drop multi-number SKUs and sort by sku (option 6)\n"
+           "                        nan-to-zero   convert nan values to 0 (option 16)\n"
+           "                        home-nursing  set home nursing stock to 9000000 (option 15)\n"
+           "  --stock-updates FILE\n"
+           "                      code,value lines for update-stock (- reads stdin)\n"
+           "  --price-updates FILE\n"
+           "                      code,value lines for update-price (- reads stdin)\n"
+           "  --out FILE          where to write the App Sheet (default: the --app file, as .csv)\n"
+           "  --stock-out FILE    also write the Stock Sheet (e.g. after update-stock)\n"
+           "  --price-out FILE    also write the Price Sheet (e.g. after clean-price)\n"
+           "  --xlsx FILE         also export the App Sheet as XLSX (option 9)\n"
+           "  --stream            sync CSV sheets too large to load: only the stock and price\n"
+           "                      codes are kept in memory and the App Sheet is synced row by\n"
+           "                      row into --out (takes --ops sync only)\n"
+           "  --memory-budget MB  with --stream, sort on disk if the lookup tables need more\n"
+           "  --temp-dir DIR      with --stream, where the sort runs go (default: next to --out)\n"
+           "  --socket FILE       serve: socket path (default: pharmacy.sock); serve takes\n"
+           "                      --stock, --price, --app, --socket, --log and --snapshot-dir\n"
+           "  --log FILE          change log file (default: log.txt)\n"
+           "  --snapshot-dir DIR  keep binary snapshots of the loaded and saved sheets in DIR\n"
+           "                      and reload unchanged sheets from them (default: off)\n"
+           "  --profile FILE      time every step: print a summary table and write a Chrome\n"
+           "                      trace (chrome://tracing or Perfetto) to FILE\n"
+           "\n"
+           "Exit codes: 0 ok, 2 bad arguments, 3 load failed, 4 operation failed, 5 write failed,\n"
+           "            6 socket unavailable (serve)\n";
+}
+
+bool isKnownOperation(const string& op) {
+    for (const char* known : kOperations) {
+        if (op == known) return true;
+    }
+    return false;
+}
+
+vector<string> splitList(const string& list) {
+    vector<string> items;
+    size_t start = 0;
+    while (start <= list.size()) {
+        size_t comma = list.find(',', start);
+        if (comma == string::npos) comma = list.size();
+        string item = list.substr(start, comma - start);
+        item.erase(0, item.find_first_not_of(" \t"));
+        item.erase(item.find_last_not_of(" \t") + 1);
+        if (!item.empty()) items.push_back(item);
+        start = comma + 1;
+    }
+    return items;
+}
+
+// Parses the options after the subcommand. Returns false (after printing why) on bad arguments.
+bool parseOptions(int argc, char* argv[], int first, BatchOptions& options) {
+    for (int i = first; i < argc; ++i) {
+        string arg = argv[i];
+        string* target = nullptr;
+        if (arg == "--stock") target = &options.stockPath;
+        else if (arg == "--price") target = &options.pricePath;
+        else if (arg == "--app") target = &options.appPath;
+        else if (arg == "--stock-updates") target = &options.stockUpdatesPath;
+        else if (arg == "--price-updates") target = &options.priceUpdatesPath;
+        else if (arg == "--out") target = &options.outPath;
+        else if (arg == "--stock-out") target = &options.stockOutPath;
+        else if (arg == "--price-out") target = &options.priceOutPath;
+        else if (arg == "--xlsx") target = &options.xlsxPath;
+        else if (arg == "--log") target = &options.logPath;
+        else if (arg == "--profile") target = &options.profilePath;
+        else if (arg == "--snapshot-dir") target = &options.snapshotDir;
+        else if (arg == "--memory-budget") target = &options.memoryBudget;
+        else if (arg == "--temp-dir") target = &options.tempDir;
+
+        if (arg == "--stream") {
+            options.stream = true;
+        } else if (arg == "--ops") {
+            if (i + 1 >= argc) {
+                cerr << "Error: --ops needs a value\n";
+                return false;
+            }
+            options.ops = splitList(argv[++i]);
+        } else if (target != nullptr) {
+            if (i + 1 >= argc) {
+                cerr << "Error: " << arg << " needs a value\n";
+                return false;
+            }
+            *target = argv[++i];
+        } else {
+            cerr << "Error: Unknown option " << arg << "\n";
+            return false;
+        }
+    }
+
+    if (options.ops.empty()) {
+        cerr << "Error: No operations given (use --ops)\n";
+        return false;
+    }
+    bool needStock = !options.stockOutPath.empty(), needPrice = !options.priceOutPath.empty();
+    bool needApp = !options.outPath.empty() || !options.xlsxPath.empty();
+    for (const string& op : options.ops) {
+        if (!isKnownOperation(op)) {
+            cerr << "Error: Unknown operation " << op << "\n";
+            return false;
+        }
+        if (op == "clean-price") needPrice = true;
+        else if (op == "update-stock") needStock = true;
+        else if (op == "update-price") needPrice = true;
+        else if (op == "sync") needStock = needPrice = needApp = true;
+        else needApp = true;
+    }
+    if (needStock && options.stockPath.empty()) {
+        cerr << "Error: --stock is required by the update-stock and sync operations and by --stock-out\n";
+        return false;
+    }
+    if (needPrice && options.pricePath.empty()) {
+        cerr << "Error: --price is required by the clean-price, update-price and sync operations and by --price-out\n";
+        return false;
+    }
+    for (const string& op : options.ops) {
+        if (op == "update-stock" && options.stockUpdatesPath.empty()) {
+            cerr << "Error: --stock-updates is required by the update-stock operation\n";
+            return false;
+        }
+        if (op == "update-price" && options.priceUpdatesPath.empty()) {
+            cerr << "Error: --price-updates is required by the update-price operation\n";
+            return false;
+        }
+    }
+    if (options.stockUpdatesPath == "-" && options.priceUpdatesPath == "-") {
+        cerr << "Error: Only one of --stock-updates and --price-updates can read stdin\n";
+        return false;
+    }
+    if (needApp && options.appPath.empty()) {
+        cerr << "Error: --app is required by the sync, sort, nan-to-zero and home-nursing operations and by --out and --xlsx\n";
+        return false;
+    }
+    if (options.stream) {
+        if (options.ops.size() != 1 || options.ops[0] != "sync") {
+            cerr << "Error: --stream runs the sync operation only (--ops sync)\n";
+            return false;
+        }
+        if (!options.stockOutPath.empty() || !options.priceOutPath.empty() || !options.xlsxPath.empty()) {
+            cerr << "Error: --stream writes the App Sheet only (no --stock-out, --price-out or --xlsx)\n";
+            return false;
+        }
+        for (const string* path : {&options.stockPath, &options.pricePath, &options.appPath}) {
+            if (isConvertibleFile(*path)) {
+                cerr << "Error: --stream reads CSV sheets only, not " << *path << "\n";
+                return false;
+            }
+        }
+    } else if (!options.memoryBudget.empty() || !options.tempDir.empty()) {
+        cerr << "Error: --memory-budget and --temp-dir go with --stream\n";
+        return false;
+    }
+    if (!options.memoryBudget.empty()) {
+        char* end = nullptr;
+        unsigned long megabytes = strtoul(options.memoryBudget.c_str(), &end, 10);
+        if (options.memoryBudget[0] == '-' || *end != '\0' || megabytes == 0) {
+            cerr << "Error: --memory-budget needs a size in MB\n";
+            return false;
+        }
+    }
+    return true;
+}
+
+// Where the App Sheet is written: --out, or the --app file (an imported one as the .csv next to it)
+string appOutputPath(const BatchOptions& options) {
+    return options.outPath.empty() ? csvPathFor(options.appPath) : options.outPath;
+}
+
+// --stream: the sync without loading the sheets (stream_sync.h)
+int runStreamSync(const BatchOptions& options) {
+    PROFILE_SCOPE("batch sync --stream");
+    StreamSyncOptions streamOptions;
+    if (!options.memoryBudget.empty()) streamOptions.memoryBudget = strtoul(options.memoryBudget.c_str(), nullptr, 10) << 20;
+    streamOptions.tempDir = options.tempDir;
+    string outPath = appOutputPath(options);
+    cout << "Running sync (streaming)...\n";
+    StreamSyncResult result;
+    if (!streamSyncAppSheet(options.appPath, options.stockPath, options.pricePath, outPath, streamOptions, &result)) {
+        return BatchOperationError;
+    }
+    cout << "App Sheet written to " << outPath << " (" << result.appRows << " rows, ";
+    if (result.sortedOnDisk && result.sortRuns > 0) cout << "sorted on disk in " << result.sortRuns << " runs)\n";
+    else if (result.sortedOnDisk) cout << "sorted in memory)\n";
+    else cout << (result.tableBytes + (1 << 19)) / (1 << 20) << " MB of lookup tables)\n";
+    return BatchOk;
+}
+
+int runSync(const BatchOptions& options) {
+    PROFILE_SCOPE("batch sync");
+    if (options.stream) return runStreamSync(options);
+    SheetData stockSheet, priceSheet, appSheet;
+    // A leading clean-price on a CSV Price Sheet is fused into the read (one pass, no raw copy)
+    bool cleanWhileReading = options.ops[0] == "clean-price" && !isConvertibleFile(options.pricePath);
+    // The App Sheet is read, synced, cleaned and written as columns (see Sheet) unless a step
+    // needs its rows: sort reorders them and the XLSX export writes them out
+    bool columnarApp = options.xlsxPath.empty() && find(options.ops.begin(), options.ops.end(), "sort") == options.ops.end();
+    Sheet appColumns;
+
+    // The sheets are read at the same time and reported afterwards in a fixed order
+    const string* paths[] = {&options.stockPath, &options.pricePath, &options.appPath};
+    SheetData* sheets[] = {&stockSheet, &priceSheet, &appSheet};
+    const char* names[] = {"Stock Sheet", "Price Sheet", "App Sheet"};
+    bool loaded[3] = {false, false, false};
+    if (cleanWhileReading) cout << "Running clean-price...\n";
+    ThreadPool::shared().parallelFor(3, [&](size_t i) {
+        if (paths[i]->empty()) return;
+        if (i == 1 && cleanWhileReading) loaded[i] = PriceCleanupPlan::menuSequence().readCSV(*paths[i], *sheets[i]);
+        else if (i == 2 && columnarApp) loaded[i] = readSheet(*paths[i], appColumns, appSheetColumnTypes());
+        else loaded[i] = readSheet(*paths[i], *sheets[i]);
+    });
+    for (int i = 0; i < 3; ++i) {
+        if (paths[i]->empty()) continue;
+        if (!loaded[i]) {
+            cerr << "Error: Failed to load " << names[i] << " from " << *paths[i] << "\n";
+            return BatchLoadError;
+        }
+        size_t rows = i == 2 && columnarApp ? appColumns.rowCount() : sheets[i]->size();
+        cout << names[i] << " loaded (" << rows << " rows" << (i == 1 && cleanWhileReading ? " after clean-price" : "")
+             << ") from " << *paths[i] << "\n";
+    }
+
+    for (size_t i = cleanWhileReading ? 1 : 0; i < options.ops.size(); ++i) {
+        const string& op = options.ops[i];
+        cout << "Running " << op << "...\n";
+        if (op == "clean-price") {
+            // Same steps as menu options 10-14, composed into one pass
+            PriceCleanupPlan::menuSequence().apply(priceSheet);
+        } else if (op == "update-stock" || op == "update-price") {
+            bool stock = op == "update-stock";
+            const string& path = stock ? options.stockUpdatesPath : options.priceUpdatesPath;
+            vector<BulkUpdate> updates;
+            if (!readBulkUpdates(path, updates)) {
+                cerr << "Error: Failed to read updates from " << path << "\n";
+                return BatchLoadError;
+            }
+            BulkTarget target = stock ? BulkTarget::Stock : BulkTarget::Price;
+            SheetData& sheet = stock ? stockSheet : priceSheet;
+            BulkUpdateReport report = applyBulkUpdates(sheet, SheetIndex(sheet, stock ? 0 : 14), target, updates);
+            printBulkUpdateReport(report, target);
+        } else if (op == "sync") {
+            bool synced = columnarApp ? syncAppSheet(appColumns, stockSheet, priceSheet)
+                                      : syncAppSheet(appSheet, stockSheet, priceSheet);
+            if (!synced) return BatchOperationError;
+        } else if (op == "sort") {
+            removeRowsWithSkuContainingMultipleNumbers(appSheet);
+            sortAppSheet(appSheet);
+        } else if (op == "nan-to-zero") {
+            if (columnarApp) convertNanToZero(appColumns);
+            else convertNanToZero(appSheet);
+        } else if (op == "home-nursing") {
+            if (columnarApp) setHomeNursingStockTo9000000(appColumns);
+            else setHomeNursingStockTo9000000(appSheet);
+        }
+    }
+
+    // The output sheets are written at the same time
+    vector<pair<string, const SheetData*>> outputs;
+    vector<string> outputNames;
+    if (!options.stockOutPath.empty()) {
+        outputs.push_back({options.stockOutPath, &stockSheet});
+        outputNames.push_back("Stock Sheet");
+    }
+    if (!options.priceOutPath.empty()) {
+        outputs.push_back({options.priceOutPath, &priceSheet});
+        outputNames.push_back("Price Sheet");
+    }
+    if (!options.appPath.empty()) {
+        // Like the interactive mode, an imported App Sheet is saved as the .csv next to it
+        outputs.push_back({appOutputPath(options), &appSheet});
+        outputNames.push_back("App Sheet");
+    }
+    vector<char> written(outputs.size(), 0);
+    ThreadPool::shared().parallelFor(outputs.size(), [&](size_t i) {
+        if (columnarApp && outputs[i].second == &appSheet) written[i] = writeCSV(outputs[i].first, appColumns);
+        else written[i] = writeCSV(outputs[i].first, *outputs[i].second);
+    });
+    for (size_t i = 0; i < outputs.size(); ++i) {
+        if (!written[i]) {
+            cerr << "Error: Failed to write " << outputNames[i] << " to " << outputs[i].first << "\n";
+            return BatchWriteError;
+        }
+        cout << outputNames[i] << " written to " << outputs[i].first << "\n";
+    }
+    if (!options.xlsxPath.empty()) {
+        if (!writeXlsx(options.xlsxPath, appSheet)) {
+            cerr << "Error: Failed to export App Sheet to " << options.xlsxPath << "\n";
+            return BatchWriteError;
+        }
+        cout << "App Sheet exported to " << options.xlsxPath << "\n";
+    }
+    return BatchOk;
+}
+
+} // namespace
+
+int runBatchCommand(int argc, char* argv[]) {
+    string command = argv[1];
+    if (command == "--help" || command == "-h" || command == "help") {
+        printUsage(cout);
+        return BatchOk;
+    }
+    if (command == "serve") return runServeCommand(argc, argv);
+    if (command != "sync") {
+        cerr << "Error: Unknown command " << command << "\n\n";
+        printUsage(cerr);
+        return BatchUsageError;
+    }
+
+    BatchOptions options;
+    if (!parseOptions(argc, argv, 2, options)) {
+        cerr << "\n";
+        printUsage(cerr);
+        return BatchUsageError;
+    }
+    if (!options.logPath.empty()) {
+        LoggerOptions logOptions;
+        logOptions.path = options.logPath;
+        configureLogger(logOptions);
+    }
+
+    if (!options.profilePath.empty()) enableProfiling(true);
+    setSnapshotDirectory(options.snapshotDir);
+
+    int result = runSync(options);
+    logChange("Batch " + command + " finished with exit code " + to_string(result) + ".");
+    if (!flushLog()) cerr << "Error: Some log records could not be written to the log file.\n";
+    if (!options.profilePath.empty()) {
+        enableProfiling(false);
+        printProfileSummary(cout);
+        if (writeProfileTrace(options.profilePath)) cout << "Profile trace written to " << options.profilePath << "\n";
+        else cerr << "Error: Failed to write the profile trace to " << options.profilePath << "\n";
+    }
+    return result;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+// Non-interactive command line mode for scheduled runs, e.g.
+//   pharmacy sync --stock s.csv --price p.csv --app a.csv --ops clean-price,sync,sort,nan-to-zero --out a.csv
+// Runs the operations as a pipeline with no prompts or delays and reports the result
+// through the exit code.
+
+enum BatchExitCode {
+    BatchOk = 0,
+    BatchUsageError = 2,     // bad or missing arguments
+    BatchLoadError = 3,      // an input sheet could not be read or imported
+    BatchOperationError = 4, // an operation could not run (e.g. sync on an empty sheet)
+    BatchWriteError = 5,     // an output file could not be written
+    BatchServeError = 6      // serve could not listen on its socket
+};
+
+// Runs the command given on the command line and returns a BatchExitCode
+int runBatchCommand(int argc, char* argv[]);
@@ -0,0 +1,103 @@
+#pragma once
+#include <chrono>
+#include <cstdio>
+#include <string>
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+// Keeps the optimizer from discarding a benchmarked result
+template <class T>
+inline void doNotOptimize(const T& value) {
+#if defined(__GNUC__)
+    asm volatile("" : : "g"(&value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
+
+struct BenchResult {
+    double secondsPerIteration;
+    long iterations;
+};
+
+// Runs fn repeatedly for at least minSeconds and returns the mean time per call
+template <class Fn>
+BenchResult runBenchmark(Fn&& fn, double minSeconds = 0.5) {
+    using Clock = std::chrono::steady_clock;
+    long iterations = 0;
+    auto start = Clock::now();
+    double elapsed = 0;
+    do {
+        fn();
+        ++iterations;
+        elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+    } while (elapsed < minSeconds);
+    return {elapsed / iterations, iterations};
+}
+
+// Like runBenchmark, but runs setup() before every call and leaves it out of the timing
+// (e.g. to give an in-place operation a fresh copy of its input each time)
+template <class Setup, class Fn>
+BenchResult runBenchmarkWithSetup(Setup&& setup, Fn&& fn, double minSeconds = 0.5) {
+    using Clock = std::chrono::steady_clock;
+    long iterations = 0;
+    double elapsed = 0;
+    do {
+        setup();
+        auto start = Clock::now();
+        fn();
+        elapsed += std::chrono::duration<double>(Clock::now() - start).count();
+        ++iterations;
+    } while (elapsed < minSeconds);
+    return {elapsed / iterations, iterations};
+}
+
+// Prints one result line in the Google Benchmark console layout
+inline void printBenchHeader() {
+    std::printf("%-44s %14s %12s  %s\n", "Benchmark", "Time", "Iterations", "UserCounters...");
+    std::printf("%s\n", std::string(90, '-').c_str());
+}
+
+inline void printBenchLine(const std::string& name, const BenchResult& result, const std::string& counters = "") {
+    std::printf("%-44s %11.3f ms %12ld  %s\n", name.c_str(), result.secondsPerIteration * 1e3, result.iterations,
+                counters.c_str());
+}
+
+// Formats a bytes-per-second counter, e.g. "bytes_per_second=1.23G/s"
+inline std::string throughputCounter(double bytes, double seconds) {
+    char buf[64];
+    std::snprintf(buf, sizeof(buf), "bytes_per_second=%.3fG/s", bytes / seconds / 1e9);
+    return buf;
+}
+
+// Resident memory of this process in bytes right now (Linux only; 0 elsewhere)
+inline size_t currentRssBytes() {
+#if defined(__linux__)
+    FILE* file = std::fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long total = 0, resident = 0;
+    int fields = std::fscanf(file, "%lu %lu", &total, &resident);
+    std::fclose(file);
+    return fields == 2 ? resident * static_cast<size_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Highest resident memory of this process so far in bytes (0 where unknown)
+inline size_t peakRssBytes() {
+#if defined(__unix__) || defined(__APPLE__)
+    rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) return 0;
+#if defined(__APPLE__)
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
@@ -0,0 +1,81 @@
+// Microbenchmark: RFC 4180 tokenizer against the previous getline/stringstream splitter.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -mavx2 -pthread -I.. csv_tokenizer_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o csv_tokenizer_bench
+#include "bench_util.h"
+#include "dataset.h"
+#include "../csv_tokenizer.h"
+#include "../file_handler.h"
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// The splitter readCSV used before the tokenizer (no quote handling)
+static vector<string> legacySplitCSVLine(const string& line) {
+    vector<string> result;
+    stringstream ss(line);
+    string item;
+    while (getline(ss, item, ',')) {
+        result.push_back(item);
+    }
+    return result;
+}
+
+// Generated App Sheet rows: 28 columns, some quoted product names with commas and quotes
+static string makeCsv(size_t targetBytes) {
+    PharmacyDataset dataset(targetBytes / 150 + 1); // about 150 bytes per row
+    string out;
+    out.reserve(targetBytes + 512);
+    vector<string> row;
+    for (size_t r = 0; out.size() < targetBytes; ++r) {
+        dataset.appRow(r, row);
+        out += joinCSVLine(row);
+        out += '\n';
+    }
+    return out;
+}
+
+static vector<string> splitLines(const string& data) {
+    vector<string> lines;
+    istringstream in(data);
+    string line;
+    while (getline(in, line)) lines.push_back(line);
+    return lines;
+}
+
+int main(int argc, char** argv) {
+    size_t megabytes = argc > 1 ? strtoul(argv[1], nullptr, 10) : 64;
+    string data = makeCsv(megabytes << 20);
+    vector<string> lines = splitLines(data);
+    double bytes = static_cast<double>(data.size());
+
+    printf("Input: %zu bytes, %zu rows, classifier backend: %s\n", data.size(), lines.size(), csvTokenizerBackend());
+    printBenchHeader();
+
+    BenchResult legacy = runBenchmark([&]() {
+        size_t cells = 0;
+        for (const string& line : lines) cells += legacySplitCSVLine(line).size();
+        doNotOptimize(cells);
+    });
+    printBenchLine("BM_LegacySplitCSVLine", legacy, throughputCounter(bytes, legacy.secondsPerIteration));
+
+    BenchResult split = runBenchmark([&]() {
+        size_t cells = 0;
+        for (const string& line : lines) cells += splitCSVLine(line).size();
+        doNotOptimize(cells);
+    });
+    printBenchLine("BM_SplitCSVLine", split, throughputCounter(bytes, split.secondsPerIteration));
+
+    vector<CsvField> fields;
+    vector<size_t> rowEnds;
+    BenchResult tokenize = runBenchmark([&]() {
+        fields.clear();
+        rowEnds.clear();
+        tokenizeCsv(data.data(), data.size(), fields, rowEnds);
+        doNotOptimize(fields.data());
+    });
+    printBenchLine("BM_TokenizeCsv", tokenize, throughputCounter(bytes, tokenize.secondsPerIteration));
+    printf("Tokenizer speedup over legacy splitter: %.1fx\n", legacy.secondsPerIteration / tokenize.secondsPerIteration);
+    return 0;
+}
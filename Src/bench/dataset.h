@@ -0,0 +1,221 @@
+#pragma once
+#include "../file_handler.h"
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Deterministic synthetic pharmacy data in the layouts the program reads:
+//   Stock Sheet   code 0, Arabic name 1, branch quantities 2-20, total 21
+//   Price Sheet   Arabic name 1, السعر 8, الكود 14 (and 15, read by search)
+//   App Sheet     English name 1, Arabic name 2, sku 8, price 9, max stock 25, stock 27
+//   Price export  the raw ERP layout menu options 10-14 clean: 10 title rows, then rows
+//                 with the price merged into I as "price|price" and الكود in P
+// The three sheets share one code space: most App Sheet SKUs are found in the Stock and
+// Price Sheets, about 2% of codes carry the #S#R marker, and some SKUs hold several
+// numbers, "nan" stock or home nursing services names, as the real exports do. Codes
+// have 6 digits like the real catalogues, except about 1% of 8-digit ones, which the
+// sort step drops along with the multi-number SKUs (and every code past the 900,000th
+// product, where 6 digits run out).
+// Rows are produced one at a time, so files of 10M rows never need to fit in memory.
+// The same seed gives byte-identical files on every platform.
+class PharmacyDataset {
+public:
+    explicit PharmacyDataset(size_t rows, uint64_t seed = 2024) : rows_(rows), seed_(seed) {}
+
+    size_t rows() const { return rows_; }
+
+    // Numeric part of product r's code (0-based): 100000 + r, or 10000000 + r for the
+    // long codes
+    uint64_t codeNumber(size_t r) const {
+        return r < kShortCodes && hash(r, 8) % 100 != 0 ? kShortCodeBase + r : kLongCodeBase + r;
+    }
+    // Product whose code has the given numeric part
+    static size_t productOf(uint64_t number) {
+        return static_cast<size_t>(number >= kLongCodeBase ? number - kLongCodeBase : number - kShortCodeBase);
+    }
+    // Code of product r, e.g. "100042" or "100050#S#R"
+    std::string code(size_t r) const {
+        std::string text = std::to_string(codeNumber(r));
+        if (hash(r, 1) % 50 == 0) text += "#S#R";
+        return text;
+    }
+
+    void stockHeader(std::vector<std::string>& row) const {
+        row.assign(22, "");
+        row[0] = "code";
+        row[1] = "الصنف";
+        for (int c = 2; c < 21; ++c) row[c] = "فرع " + std::to_string(c - 1);
+        row[21] = "total";
+    }
+    void stockRow(size_t r, std::vector<std::string>& row) const {
+        row.assign(22, "");
+        row[0] = code(r);
+        row[1] = arabicName(r);
+        uint64_t total = 0;
+        for (int c = 2; c < 21; ++c) {
+            uint64_t quantity = hash(r, 100 + c) % 4 == 0 ? hash(r, 200 + c) % 40 : 0;
+            row[c] = std::to_string(quantity);
+            total += quantity;
+        }
+        row[21] = std::to_string(total);
+    }
+
+    void priceHeader(std::vector<std::string>& row) const {
+        row.assign(16, "");
+        row[1] = "الصنف";
+        row[8] = "السعر";
+        row[14] = "الكود";
+        row[15] = "الكود";
+    }
+    void priceRow(size_t r, std::vector<std::string>& row) const {
+        row.assign(16, "");
+        row[0] = std::to_string(r + 1);
+        row[1] = arabicName(r);
+        row[8] = price(r);
+        row[14] = code(r);
+        row[15] = code(r);
+    }
+
+    void appHeader(std::vector<std::string>& row) const {
+        row.assign(28, "");
+        for (int c = 0; c < 28; ++c) row[c] = "col" + std::to_string(c);
+        row[1] = "name";
+        row[2] = "name_ar";
+        row[8] = "sku";
+        row[9] = "price";
+        row[25] = "max_stock";
+        row[27] = "stock";
+    }
+    void appRow(size_t r, std::vector<std::string>& row) const {
+        row.assign(28, "nan");
+        uint64_t h = hash(r, 2);
+        size_t product = static_cast<size_t>(hash(r, 3) % (rows_ + rows_ / 10 + 1)); // ~10% not in stock
+        row[0] = std::to_string(r + 1);
+        row[1] = h % 200 == 0 ? "Home Nursing Services - Visit" : englishName(product);
+        row[2] = arabicName(product);
+        if (h % 100 == 1) row[8] = std::to_string(codeNumber(product)) + "/" + std::to_string(product % 97);
+        else row[8] = code(product);
+        row[9] = h % 7 == 0 ? "nan" : price(product);
+        row[25] = std::to_string(hash(r, 4) % 100);
+        row[27] = h % 5 == 0 ? "nan" : std::to_string(hash(r, 5) % 300);
+        for (int c : {3, 4, 5, 10, 11}) row[c] = hash(r, 10 + c) % 3 == 0 ? "" : "nan";
+    }
+
+    // Raw ERP export: rows [0, kTitleRows) are report titles, then the header, then products
+    static const size_t kTitleRows = 10;
+    size_t priceExportRows() const { return kTitleRows + 1 + rows_; }
+    void priceExportRow(size_t r, std::vector<std::string>& row) const {
+        if (r < kTitleRows) {
+            row.assign(1, r == 0 ? "تقرير أسعار الأصناف" : "");
+            return;
+        }
+        row.assign(22, "");
+        if (r == kTitleRows) {
+            row[8] = "السعر";
+            row[15] = "الكود";
+            row[20] = "الصنف";
+            return;
+        }
+        size_t product = r - kTitleRows - 1;
+        row[0] = std::to_string(product + 1);
+        row[8] = price(product) + "|" + price(product);
+        row[15] = code(product);
+        row[20] = arabicName(product);
+    }
+
+private:
+    static const uint64_t kShortCodeBase = 100000;
+    static const size_t kShortCodes = 900000;
+    static const uint64_t kLongCodeBase = 10000000;
+
+    // splitmix64 of (seed, row, stream): independent, platform-stable values per cell
+    uint64_t hash(uint64_t r, uint64_t stream) const {
+        uint64_t x = seed_ ^ (r * 0x9E3779B97F4A7C15ULL) ^ (stream * 0xD1B54A32D192ED03ULL);
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+
+    std::string price(size_t r) const {
+        uint64_t h = hash(r, 6);
+        return std::to_string(5 + h % 995) + (h % 4 == 0 ? ".5" : ".0");
+    }
+
+    std::string arabicName(size_t r) const {
+        static const char* const names[] = {"بنادول", "أموكسيسيلين", "فيتامين سي", "كونجستال", "أوجمنتين",
+                                            "بروفين", "فولتارين", "نيكسيوم", "جلوكوفاج", "كتافلام"};
+        static const char* const forms[] = {"أقراص", "كبسولات", "شراب", "فوار", "كريم", "حقن"};
+        uint64_t h = hash(r, 7);
+        return std::string(names[h % 10]) + " " + forms[(h >> 8) % 6] + " " + std::to_string(50 * (1 + (h >> 16) % 20)) + "mg";
+    }
+
+    std::string englishName(size_t r) const {
+        static const char* const names[] = {"Panadol", "Amoxicillin", "Vitamin C", "Congestal", "Augmentin",
+                                            "Brufen", "Voltaren", "Nexium", "Glucophage", "Cataflam"};
+        uint64_t h = hash(r, 7);
+        std::string name = names[h % 10];
+        // Some names need CSV quoting
+        if ((h >> 24) % 8 == 0) name += ", " + std::to_string(50 * (1 + (h >> 16) % 20)) + "mg";
+        if ((h >> 24) % 32 == 1) name += " \"Extra\"";
+        return name;
+    }
+
+    size_t rows_;
+    uint64_t seed_;
+};
+
+// Streams rows [0, count) of a generated sheet to a CSV file in writeCSV's format.
+// Returns true if successful.
+template <class RowFn>
+bool writeGeneratedCsv(const std::string& path, size_t count, RowFn&& rowAt) {
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::vector<std::string> row;
+    std::string buffer;
+    for (size_t r = 0; r < count; ++r) {
+        rowAt(r, row);
+        buffer += joinCSVLine(row);
+        if (r + 1 != count) buffer += '\n';
+        if (buffer.size() >= (1 << 20)) {
+            std::fwrite(buffer.data(), 1, buffer.size(), file);
+            buffer.clear();
+        }
+    }
+    std::fwrite(buffer.data(), 1, buffer.size(), file);
+    return std::fclose(file) == 0;
+}
+
+// Writes stock.csv, price.csv, app.csv and price_export.csv into dir. Returns true if successful.
+inline bool writePharmacyDataset(const PharmacyDataset& data, const std::string& dir) {
+    auto sheetRows = [&data](auto header, auto body) {
+        return [&data, header, body](size_t r, std::vector<std::string>& row) {
+            if (r == 0) (data.*header)(row);
+            else (data.*body)(r - 1, row);
+        };
+    };
+    return writeGeneratedCsv(dir + "/stock.csv", data.rows() + 1,
+                             sheetRows(&PharmacyDataset::stockHeader, &PharmacyDataset::stockRow)) &&
+           writeGeneratedCsv(dir + "/price.csv", data.rows() + 1,
+                             sheetRows(&PharmacyDataset::priceHeader, &PharmacyDataset::priceRow)) &&
+           writeGeneratedCsv(dir + "/app.csv", data.rows() + 1,
+                             sheetRows(&PharmacyDataset::appHeader, &PharmacyDataset::appRow)) &&
+           writeGeneratedCsv(dir + "/price_export.csv", data.priceExportRows(),
+                             [&data](size_t r, std::vector<std::string>& row) { data.priceExportRow(r, row); });
+}
+
+// Builds a generated sheet in memory (header row first)
+template <class HeaderFn, class RowFn>
+SheetData buildSheet(const PharmacyDataset& data, HeaderFn header, RowFn body) {
+    SheetData sheet;
+    sheet.reserve(data.rows() + 1);
+    std::vector<std::string> row;
+    (data.*header)(row);
+    sheet.push_back(row);
+    for (size_t r = 0; r < data.rows(); ++r) {
+        (data.*body)(r, row);
+        sheet.push_back(row);
+    }
+    return sheet;
+}
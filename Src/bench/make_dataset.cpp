@@ -0,0 +1,38 @@
+// Writes a synthetic pharmacy dataset (stock.csv, price.csv, app.csv, price_export.csv)
+// for benchmarks and manual runs. See dataset.h for the layouts.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. make_dataset.cpp $(ls ../*.cpp | grep -v /main.cpp) -o make_dataset
+// Usage: make_dataset <rows> [output dir] [seed]     (rows: 10000 to 10000000)
+#include "dataset.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <string>
+using namespace std;
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <rows> [output dir] [seed]\n", argv[0]);
+        return 2;
+    }
+    size_t rows = strtoull(argv[1], nullptr, 10);
+    string dir = argc > 2 ? argv[2] : ".";
+    uint64_t seed = argc > 3 ? strtoull(argv[3], nullptr, 10) : 2024;
+    if (rows == 0) {
+        fprintf(stderr, "Error: rows must be a positive number\n");
+        return 2;
+    }
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+
+    auto start = chrono::steady_clock::now();
+    if (!writePharmacyDataset(PharmacyDataset(rows, seed), dir)) {
+        fprintf(stderr, "Error: Could not write the dataset to %s\n", dir.c_str());
+        return 1;
+    }
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+    printf("Wrote %zu rows per sheet to %s in %.2f s (seed %llu)\n", rows, dir.c_str(), seconds,
+           static_cast<unsigned long long>(seed));
+    return 0;
+}
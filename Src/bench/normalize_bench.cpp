@@ -0,0 +1,143 @@
+// Cell normalization: the copy-and-lowercase comparisons the operations used before
+// text_utils.h against the allocation-free helpers, with heap allocations counted per
+// cell through the profiler's operator new hook. Exits with status 1 if a helper or the
+// per-cell loop of an operation allocates.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. normalize_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o normalize_bench
+// Usage: normalize_bench [rows]
+#include "bench_util.h"
+#include "dataset.h"
+#include "../logger.h"
+#include "../operations.h"
+#include "../profiler.h"
+#include "../row_rules.h"
+#include "../text_utils.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+static bool isMissingByCopy(string_view cell) {
+    string lowerCell(cell);
+    transform(lowerCell.begin(), lowerCell.end(), lowerCell.begin(), ::tolower);
+    return lowerCell == "nan" || lowerCell == "n/a" || lowerCell == "na" || lowerCell == "null" ||
+           lowerCell == "undefined" || lowerCell == "";
+}
+
+static bool isHomeNursingByCopy(string_view cell) {
+    string lowerCell(cell);
+    transform(lowerCell.begin(), lowerCell.end(), lowerCell.begin(), ::tolower);
+    return lowerCell.find("home nursing services") != string::npos;
+}
+
+static string trimByCopy(string_view text) {
+    const string str(text);
+    const char* ws = " \t\n\r\f\v";
+    size_t start = str.find_first_not_of(ws);
+    size_t end = str.find_last_not_of(ws);
+    return (start == string::npos) ? "" : str.substr(start, end - start + 1);
+}
+
+// Heap allocations made during one call of fn by any thread, so the work the row rules
+// hand to the shared pool's workers is counted too
+template <class Fn>
+static uint64_t allocationsOf(Fn&& fn) {
+    uint64_t before = processAllocationCount();
+    fn();
+    return processAllocationCount() - before;
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    PharmacyDataset dataset(rows);
+    SheetData app = buildSheet(dataset, &PharmacyDataset::appHeader, &PharmacyDataset::appRow);
+    // Long cells, so the copies cannot hide in the small string buffer
+    for (size_t r = 1; r < app.size(); r += 3) app[r][1] += " - Pharmacy Home Nursing Services Department";
+    size_t cells = 0;
+    for (const auto& row : app) cells += row.size();
+    LoggerOptions logOptions;
+    logOptions.path = "normalize_bench.log";
+    configureLogger(logOptions);
+    missingValueWords(); // built on first use, before anything is counted
+    PatternSet homeNursing;
+    homeNursing.add("home nursing services");
+
+    struct Case {
+        const char* name;
+        function<void()> run;
+        bool mustNotAllocate;
+    };
+    size_t matched = 0;
+    SheetData work;
+    auto eachCell = [&](auto&& test) {
+        return [&, test]() {
+            size_t count = 0;
+            for (const auto& row : app)
+                for (const SheetCell& cell : row) count += test(cell);
+            matched = count;
+            doNotOptimize(count);
+        };
+    };
+    vector<Case> cases = {
+        {"BM_MissingValue/copy_and_lower", eachCell([](string_view c) { return isMissingByCopy(c); }), false},
+        {"BM_MissingValue/word_matcher", eachCell([](string_view c) { return missingValueWords().matches(c); }), true},
+        {"BM_HomeNursing/copy_and_lower", eachCell([](string_view c) { return isHomeNursingByCopy(c); }), false},
+        {"BM_HomeNursing/contains_ignore_case",
+         eachCell([](string_view c) { return containsIgnoreCase(c, "home nursing services"); }), true},
+        {"BM_HomeNursing/pattern_set", eachCell([&](string_view c) { return homeNursing.scan(c) != 0; }), true},
+        {"BM_TrimCompare/copy", eachCell([](string_view c) { return trimByCopy(c) == trimByCopy("nan"); }), false},
+        {"BM_TrimCompare/view", eachCell([](string_view c) { return trimView(c) == trimView("nan"); }), true},
+    };
+
+    bool ok = true;
+    printf("App Sheet: %zu rows, %zu cells\n", app.size(), cells);
+    printBenchHeader();
+    for (const Case& benchCase : cases) {
+        enableProfiling(true);
+        uint64_t allocations = allocationsOf(benchCase.run);
+        enableProfiling(false);
+        BenchResult result = runBenchmark(benchCase.run);
+        char counters[96];
+        snprintf(counters, sizeof(counters), "matches=%zu allocs_per_cell=%.3f", matched, double(allocations) / cells);
+        printBenchLine(string(benchCase.name) + "/" + to_string(rows), result, counters);
+        if (benchCase.mustNotAllocate && allocations != 0) {
+            printf("FAIL: %s made %llu allocations\n", benchCase.name, static_cast<unsigned long long>(allocations));
+            ok = false;
+        }
+    }
+
+    // The operations themselves: only the log line, the console message and the row match
+    // results may allocate
+    struct Operation {
+        const char* name;
+        void (*run)(SheetData&);
+    };
+    const Operation operations[] = {{"convertNanToZero", convertNanToZero},
+                                    {"setHomeNursingStockTo9000000", setHomeNursingStockTo9000000}};
+    for (const Operation& operation : operations) {
+        ostringstream discarded;
+        streambuf* console = cout.rdbuf(discarded.rdbuf());
+        work = app;
+        operation.run(work); // first call sets up the rule sets and the thread pool
+        work = app;
+        enableProfiling(true);
+        uint64_t allocations = allocationsOf([&]() { operation.run(work); });
+        enableProfiling(false);
+        cout.rdbuf(console);
+        printf("%-44s allocations=%llu (%zu cells)\n", operation.name, static_cast<unsigned long long>(allocations), cells);
+        if (allocations > 16) {
+            printf("FAIL: %s allocates per cell\n", operation.name);
+            ok = false;
+        }
+    }
+    flushLog();
+    remove("normalize_bench.log");
+    printf(ok ? "No per-cell allocations.\n" : "Per-cell allocations found.\n");
+    return ok ? 0 : 1;
+}
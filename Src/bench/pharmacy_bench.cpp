@@ -0,0 +1,241 @@
+// Benchmark suite: file I/O, lookups, sync, cleanup and sort on a generated dataset
+// (dataset.h) with the real column layouts.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. pharmacy_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o pharmacy_bench
+// Usage: pharmacy_bench [rows per sheet] [filter]
+//   Only benchmarks whose name contains filter are run (e.g. "Sync", "Price").
+#include "bench_util.h"
+#include "dataset.h"
+#include "../bulk_update.h"
+#include "../file_handler.h"
+#include "../logger.h"
+#include "../operations.h"
+#include "../price_cleanup.h"
+#include "../row_rules.h"
+#include "../snapshot.h"
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Defined in operations.cpp (linear scan, the lookup every operation used before SheetIndex)
+int findRowByCode(const SheetData& sheet, const string& code, int codeCol);
+
+struct BenchCase {
+    string name;
+    function<BenchResult()> run;
+    string counters;
+};
+
+static double fileBytes(const string& path) {
+    error_code ec;
+    auto size = filesystem::file_size(path, ec);
+    return ec ? 0 : static_cast<double>(size);
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    string filter = argc > 2 ? argv[2] : "";
+    const string dir = "pharmacy_bench_data";
+    filesystem::create_directories(dir);
+
+    PharmacyDataset dataset(rows);
+    if (!writePharmacyDataset(dataset, dir)) {
+        fprintf(stderr, "Error: Could not write the dataset to %s\n", dir.c_str());
+        return 1;
+    }
+    const SheetData stock = buildSheet(dataset, &PharmacyDataset::stockHeader, &PharmacyDataset::stockRow);
+    const SheetData price = buildSheet(dataset, &PharmacyDataset::priceHeader, &PharmacyDataset::priceRow);
+    const SheetData app = buildSheet(dataset, &PharmacyDataset::appHeader, &PharmacyDataset::appRow);
+    SheetData priceExport;
+    vector<string> exportRow;
+    for (size_t r = 0; r < dataset.priceExportRows(); ++r) {
+        dataset.priceExportRow(r, exportRow);
+        priceExport.push_back(exportRow);
+    }
+
+    const string appPath = dir + "/app.csv";
+    const double appBytes = fileBytes(appPath);
+    vector<string> appLines;
+    for (const auto& row : app) {
+        vector<string> fields;
+        for (const SheetCell& cell : row) fields.emplace_back(cell);
+        appLines.push_back(joinCSVLine(fields));
+    }
+
+    LoggerOptions logOptions;
+    logOptions.path = dir + "/bench.log";
+    configureLogger(logOptions);
+
+    SheetData work, loaded;
+    SyncChangeSet changes;
+    // One keyword rule against eight (the extra ones searching any cell): the match is one
+    // scan either way
+    RowRules oneRule, eightRules;
+    oneRule.add({"home nursing services", -1, 27, "9000000"});
+    const char* keywords[] = {"home nursing services", "syrup", "tablets", "cream", "injection", "drops", "baby", "vitamin"};
+    for (const char* keyword : keywords) eightRules.add({keyword, -1, 27, "0"});
+    // A delivery of stock counts for a tenth of the products, applied one code at a time
+    // (menu option 2) or as one batch
+    vector<BulkUpdate> delivery;
+    for (size_t k = 0; k < rows / 10; ++k) delivery.push_back({dataset.code(k * 10), to_string(k % 500), k + 1});
+    vector<BenchCase> cases = {
+        {"BM_ReadCSV/parse", [&]() { // snapshots off, the default
+             return runBenchmark([&]() { doNotOptimize(readCSV(appPath, loaded)); });
+         }, "bytes"},
+        {"BM_ReadCSV/snapshot", [&]() {
+             setSnapshotDirectory(dir + "/snapshots");
+             readCSV(appPath, loaded); // leaves the snapshot
+             BenchResult result = runBenchmark([&]() { doNotOptimize(readCSV(appPath, loaded)); });
+             setSnapshotDirectory("");
+             return result;
+         }, "bytes"},
+        {"BM_SplitCSVLine", [&]() {
+             return runBenchmark([&]() {
+                 size_t cells = 0;
+                 for (const string& line : appLines) cells += splitCSVLine(line).size();
+                 doNotOptimize(cells);
+             });
+         }, "bytes"},
+        {"BM_WriteCSV", [&]() {
+             return runBenchmark([&]() { doNotOptimize(writeCSV(dir + "/app_out.csv", app)); });
+         }, "bytes"},
+        {"BM_FindRowByCode/100_lookups", [&]() {
+             return runBenchmark([&]() {
+                 int found = 0;
+                 for (size_t k = 0; k < 100; ++k) found += findRowByCode(stock, dataset.code(k * rows / 100), 0) >= 0;
+                 doNotOptimize(found);
+             });
+         }, ""},
+        {"BM_SheetIndex/build_and_100_lookups", [&]() {
+             return runBenchmark([&]() {
+                 SheetIndex index(stock, 0);
+                 int found = 0;
+                 for (size_t k = 0; k < 100; ++k) found += index.find(dataset.code(k * rows / 100)) >= 0;
+                 doNotOptimize(found);
+             });
+         }, ""},
+        {"BM_SyncAppSheet", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; },
+                                          [&]() { doNotOptimize(syncAppSheet(work, stock, price)); });
+         }, ""},
+        {"BM_SyncAppSheet/cached_keys", [&]() {
+             // Full sync through the sheets' key caches (built once, as the menu keeps them)
+             SheetKeys stockKeys, priceKeys, appKeys;
+             SyncChangeSet cached;
+             cached.stockKeys = &stockKeys;
+             cached.priceKeys = &priceKeys;
+             cached.appKeys = &appKeys;
+             work = app;
+             syncAppSheet(work, stock, price, cached);
+             return runBenchmarkWithSetup([&]() { work = app; cached.invalidate(); },
+                                          [&]() { doNotOptimize(syncAppSheet(work, stock, price, cached)); });
+         }, ""},
+        {"BM_SyncAppSheet/incremental_100_codes", [&]() {
+             // One full sync sets the baseline; every iteration then updates 100 stock totals
+             SheetData stockCopy = stock;
+             work = app;
+             changes.invalidate();
+             syncAppSheet(work, stockCopy, price, changes);
+             SheetIndex stockIndex(stockCopy, 0);
+             int round = 0;
+             return runBenchmarkWithSetup(
+                 [&]() {
+                     round++;
+                     for (size_t k = 0; k < 100; ++k)
+                         updateStock(stockCopy, stockIndex, dataset.code(k * rows / 100), round, &changes);
+                 },
+                 [&]() { doNotOptimize(syncAppSheet(work, stockCopy, price, changes)); });
+         }, ""},
+        {"BM_UpdateStock/per_code", [&]() {
+             SheetData stockCopy = stock;
+             SheetIndex stockIndex(stockCopy, 0);
+             return runBenchmark([&]() {
+                 for (const BulkUpdate& update : delivery)
+                     updateStock(stockCopy, stockIndex, update.code, atoi(update.value.c_str()), &changes);
+             });
+         }, ""},
+        {"BM_UpdateStock/bulk", [&]() {
+             SheetData stockCopy = stock;
+             SheetIndex stockIndex(stockCopy, 0);
+             return runBenchmark([&]() {
+                 doNotOptimize(applyBulkUpdates(stockCopy, stockIndex, BulkTarget::Stock, delivery, &changes));
+             });
+         }, ""},
+        {"BM_ConvertNanToZero", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; }, [&]() { convertNanToZero(work); });
+         }, ""},
+        {"BM_SetHomeNursingStock", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; }, [&]() { setHomeNursingStockTo9000000(work); });
+         }, ""},
+        {"BM_SetMaxStockForSRProducts", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; }, [&]() { setMaxStockForSRProducts(work, stock); });
+         }, ""},
+        {"BM_RowRules/match_1_rule", [&]() {
+             return runBenchmark([&]() { doNotOptimize(oneRule.match(app)); });
+         }, ""},
+        {"BM_RowRules/match_8_rules", [&]() {
+             return runBenchmark([&]() { doNotOptimize(eightRules.match(app)); });
+         }, ""},
+        {"BM_Price/DeleteFirstNRows", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; },
+                                          [&]() { deleteFirstNRowsFromPriceSheet(work, 10); });
+         }, ""},
+        {"BM_Price/UnmergeIJColumns", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() { unmergeIJColumnsInPriceSheet(work); });
+         }, ""},
+        {"BM_Price/MovePColumnToH", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() { movePColumnToHInPriceSheet(work); });
+         }, ""},
+        {"BM_Price/DeleteRepeatedPriceColumn", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() { deleteRepeatedPriceColumn(work); });
+         }, ""},
+        {"BM_Price/DeleteFirstSixColumns", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() { deleteFirstSixColumns(work); });
+         }, ""},
+        {"BM_Price/AllStepsInOrder", [&]() {
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() {
+                 deleteFirstNRowsFromPriceSheet(work, 10);
+                 unmergeIJColumnsInPriceSheet(work);
+                 movePColumnToHInPriceSheet(work);
+                 deleteRepeatedPriceColumn(work);
+                 deleteFirstSixColumns(work);
+             });
+         }, ""},
+        {"BM_Price/CleanupPlan", [&]() {
+             PriceCleanupPlan plan = PriceCleanupPlan::menuSequence();
+             return runBenchmarkWithSetup([&]() { work = priceExport; }, [&]() { plan.apply(work); });
+         }, ""},
+        {"BM_RemoveMultiNumberSkus", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; },
+                                          [&]() { removeRowsWithSkuContainingMultipleNumbers(work); });
+         }, ""},
+        {"BM_SortAppSheet", [&]() {
+             return runBenchmarkWithSetup([&]() { work = app; }, [&]() { sortAppSheet(work); });
+         }, ""},
+    };
+
+    printf("Dataset: %zu rows per sheet in %s (app.csv %.1f MB)\n", rows, dir.c_str(), appBytes / 1e6);
+    printBenchHeader();
+    for (const BenchCase& benchCase : cases) {
+        if (!filter.empty() && benchCase.name.find(filter) == string::npos) continue;
+        // The operations' console messages are not part of the report
+        ostringstream discarded;
+        streambuf* console = cout.rdbuf(discarded.rdbuf());
+        BenchResult result = benchCase.run();
+        cout.rdbuf(console);
+        string counters = benchCase.counters == "bytes" ? throughputCounter(appBytes, result.secondsPerIteration) : "";
+        printBenchLine(benchCase.name + "/" + to_string(rows), result, counters);
+        fflush(stdout);
+    }
+
+    flushLog();
+    error_code ec;
+    filesystem::remove_all(dir, ec);
+    return 0;
+}
@@ -0,0 +1,88 @@
+// Product search: index build time and query latency across the three sheets for exact
+// codes, code prefixes and English/Arabic name fragments (including a misspelling and
+// unfolded Arabic letter forms). Runs on the generated dataset, then again with a made-up
+// word added to every name so that each product has a distinct name. Exits with status 1
+// if a query takes 1 ms or more on average.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. search_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o search_bench
+// Usage: search_bench [rows]
+#include "bench_util.h"
+#include "dataset.h"
+#include "../product_search.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace std;
+
+// Pronounceable word unique to n, e.g. "kavomu"
+static string madeUpWord(size_t n) {
+    static const char consonants[] = "bdfgklmnprstvz";
+    static const char vowels[] = "aeiou";
+    string word;
+    do {
+        word += consonants[n % 14];
+        n /= 14;
+        word += vowels[n % 5];
+        n /= 5;
+    } while (n != 0);
+    return word;
+}
+
+static bool runQueries(const char* label, const SheetData& stock, const SheetData& price, const SheetData& app,
+                       const vector<string>& queries) {
+    ProductSearch search;
+    auto start = chrono::steady_clock::now();
+    search.build(stock, price, app);
+    double buildMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    printf("\n%s: %zu codes, %zu distinct names, built in %.1f ms\n", label, search.codeCount(), search.nameCount(),
+           buildMs);
+    printBenchHeader();
+    bool ok = true;
+    for (const string& query : queries) {
+        size_t hits = 0;
+        int bestSimilarity = 0;
+        BenchResult result = runBenchmark([&]() {
+            vector<SearchHit> found = search.search(query);
+            hits = found.size();
+            bestSimilarity = found.empty() ? 0 : found[0].similarity;
+            doNotOptimize(found);
+        }, 0.2);
+        char counters[64];
+        snprintf(counters, sizeof(counters), "hits=%zu best=%d", hits, bestSimilarity);
+        printBenchLine("BM_Search/\"" + query + "\"", result, counters);
+        if (result.secondsPerIteration >= 1e-3) {
+            printf("FAIL: \"%s\" took %.3f ms\n", query.c_str(), result.secondsPerIteration * 1e3);
+            ok = false;
+        }
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 100000;
+    PharmacyDataset dataset(rows);
+    SheetData stock = buildSheet(dataset, &PharmacyDataset::stockHeader, &PharmacyDataset::stockRow);
+    SheetData price = buildSheet(dataset, &PharmacyDataset::priceHeader, &PharmacyDataset::priceRow);
+    SheetData app = buildSheet(dataset, &PharmacyDataset::appHeader, &PharmacyDataset::appRow);
+
+    vector<string> queries = {dataset.code(rows / 2), dataset.code(rows / 3).substr(0, 5), "١٠٠٠٤٢", "panadol",
+                              "panadl 500", "vitamin c", "بنادول", "اموكسيسلين", "فِيتامين سى", "كريم"};
+    bool ok = runQueries("Generated names", stock, price, app, queries);
+
+    // Distinct names: stock and price rows get the product's word, App rows the word of
+    // the product they list (so one product's rows still share it)
+    for (size_t r = 1; r < stock.size(); ++r) stock[r][1] += " " + madeUpWord(r - 1);
+    for (size_t r = 1; r < price.size(); ++r) price[r][1] += " " + madeUpWord(r - 1);
+    for (size_t r = 1; r < app.size(); ++r) {
+        size_t product = PharmacyDataset::productOf(strtoull(string(app[r][8]).c_str(), nullptr, 10));
+        app[r][1] += " " + madeUpWord(product);
+        app[r][2] += " " + madeUpWord(product);
+    }
+    queries.push_back(madeUpWord(rows / 4));
+    queries.push_back("panadol " + madeUpWord(rows / 5));
+    ok = runQueries("Distinct names", stock, price, app, queries) && ok;
+    printf(ok ? "\nAll queries under 1 ms.\n" : "\nSome queries took 1 ms or more.\n");
+    return ok ? 0 : 1;
+}
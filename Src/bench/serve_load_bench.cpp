@@ -0,0 +1,219 @@
+// Load test for "pharmacy serve": connections send stock and price lookups and product
+// searches (45/45/10) back to back for a fixed time while one more connection updates a
+// stock total and asks for a sync at a fixed interval. Prints the throughput and latency
+// percentiles per request type, and separately for the lookups answered while a sync was
+// running, which should look like the rest.
+// Start the server on a generated dataset first, e.g. from Src/bench:
+//   ./make_dataset 100000 data && ../pharmacy serve --stock data/stock.csv --price data/price.csv
+//       --app data/app.csv --socket /tmp/pharmacy.sock
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. serve_load_bench.cpp -o serve_load_bench
+// Usage: serve_load_bench <socket> [rows] [connections] [seconds] [sync interval ms, 0 = no writer]
+#include "dataset.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+using namespace std;
+using Clock = chrono::steady_clock;
+
+enum RequestKind { Stock, Price, Search, Update, Sync, KindCount };
+static const char* const kKindNames[] = {"stock", "price", "search", "update-stock", "sync"};
+
+struct Sample {
+    RequestKind kind;
+    Clock::time_point start;
+    double ms;
+};
+
+// One blocking connection: sends a request line and reads the whole reply
+class Connection {
+public:
+    explicit Connection(const string& path) {
+        socket_ = socket(AF_UNIX, SOCK_STREAM, 0);
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+        if (socket_ >= 0 && connect(socket_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            close(socket_);
+            socket_ = -1;
+        }
+    }
+    ~Connection() {
+        if (socket_ >= 0) close(socket_);
+    }
+    bool ok() const { return socket_ >= 0; }
+
+    // Returns false if the connection failed; ok is false for an ERR reply
+    bool request(const string& line, bool& ok) {
+        string data = line + "\n";
+        for (size_t sent = 0; sent < data.size();) {
+            ssize_t n = send(socket_, data.data() + sent, data.size() - sent, 0);
+            if (n <= 0) return false;
+            sent += static_cast<size_t>(n);
+        }
+        string first;
+        if (!readLine(first)) return false;
+        ok = first.compare(0, 3, "OK ") == 0;
+        size_t lines = ok ? strtoul(first.c_str() + 3, nullptr, 10) : 0;
+        string rest;
+        for (size_t i = 0; i < lines; ++i) {
+            if (!readLine(rest)) return false;
+        }
+        return true;
+    }
+
+private:
+    bool readLine(string& line) {
+        for (;;) {
+            size_t newline = buffer_.find('\n', start_);
+            if (newline != string::npos) {
+                line.assign(buffer_, start_, newline - start_);
+                start_ = newline + 1;
+                return true;
+            }
+            buffer_.erase(0, start_);
+            start_ = 0;
+            char chunk[16384];
+            ssize_t n = recv(socket_, chunk, sizeof(chunk), 0);
+            if (n <= 0) return false;
+            buffer_.append(chunk, static_cast<size_t>(n));
+        }
+    }
+
+    int socket_ = -1;
+    string buffer_;
+    size_t start_ = 0;
+};
+
+static double percentile(vector<double>& ms, double p) {
+    if (ms.empty()) return 0;
+    size_t k = min(ms.size() - 1, static_cast<size_t>(p * ms.size()));
+    nth_element(ms.begin(), ms.begin() + k, ms.end());
+    return ms[k];
+}
+
+// seconds = 0: no QPS (samples picked out of the run rather than the whole of it)
+static void printLine(const char* name, vector<double> ms, double seconds) {
+    if (ms.empty()) return;
+    double maxMs = *max_element(ms.begin(), ms.end());
+    string qps = seconds > 0 ? to_string(static_cast<long long>(ms.size() / seconds)) : "-";
+    printf("%-22s %9zu %10s %9.3f %9.3f %9.3f %9.3f\n", name, ms.size(), qps.c_str(), percentile(ms, 0.5),
+           percentile(ms, 0.99), percentile(ms, 0.999), maxMs);
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <socket> [rows] [connections] [seconds] [sync interval ms]\n", argv[0]);
+        return 2;
+    }
+    string path = argv[1];
+    size_t rows = argc > 2 ? strtoul(argv[2], nullptr, 10) : 100000;
+    int connections = argc > 3 ? atoi(argv[3]) : 8;
+    double seconds = argc > 4 ? atof(argv[4]) : 5;
+    int syncEveryMs = argc > 5 ? atoi(argv[5]) : 500;
+    PharmacyDataset dataset(rows);
+    const vector<string> queries = {"panadol", "panadl 500", "vitamin c", "بنادول", "اموكسيسلين", "كريم", "10004"};
+
+    atomic<bool> stop{false};
+    atomic<size_t> errors{0}, failures{0};
+    mutex samplesMutex;
+    vector<Sample> samples;
+
+    auto worker = [&](int id, bool writer) {
+        Connection connection(path);
+        if (!connection.ok()) {
+            failures++;
+            return;
+        }
+        vector<Sample> mine;
+        uint64_t state = 0x9E3779B97F4A7C15ULL * (id + 1);
+        auto next = [&state]() {
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            return state;
+        };
+        Clock::time_point nextSync = Clock::now();
+        while (!stop) {
+            RequestKind kind;
+            string line;
+            if (writer) {
+                if (Clock::now() < nextSync) {
+                    kind = Update;
+                    line = "update-stock " + dataset.code(next() % rows) + " " + to_string(next() % 500);
+                    this_thread::sleep_for(chrono::milliseconds(5));
+                } else {
+                    kind = Sync;
+                    line = "sync";
+                }
+            } else {
+                uint64_t r = next();
+                kind = r % 100 < 45 ? Stock : r % 100 < 90 ? Price : Search;
+                if (kind == Search) line = "search " + queries[(r >> 8) % queries.size()];
+                else line = string(kind == Stock ? "stock " : "price ") + dataset.code((r >> 8) % rows);
+            }
+            Clock::time_point start = Clock::now();
+            bool ok = false;
+            if (!connection.request(line, ok)) {
+                failures++;
+                break;
+            }
+            if (!ok) errors++;
+            Clock::time_point end = Clock::now();
+            mine.push_back({kind, start, chrono::duration<double, milli>(end - start).count()});
+            if (kind == Sync) nextSync = end + chrono::milliseconds(syncEveryMs);
+        }
+        lock_guard<mutex> lock(samplesMutex);
+        samples.insert(samples.end(), mine.begin(), mine.end());
+    };
+
+    vector<thread> threads;
+    for (int i = 0; i < connections; ++i) threads.emplace_back(worker, i, false);
+    if (syncEveryMs > 0) threads.emplace_back(worker, connections, true);
+    this_thread::sleep_for(chrono::duration<double>(seconds));
+    stop = true;
+    for (thread& t : threads) t.join();
+    if (failures > 0) {
+        fprintf(stderr, "Error: %zu connections to %s failed\n", failures.load(), path.c_str());
+        return 1;
+    }
+
+    // Lookups that started while a sync was in flight
+    vector<pair<Clock::time_point, Clock::time_point>> syncs;
+    for (const Sample& s : samples) {
+        if (s.kind != Sync) continue;
+        syncs.push_back({s.start, s.start + chrono::duration_cast<Clock::duration>(chrono::duration<double, milli>(s.ms))});
+    }
+    auto duringSync = [&syncs](Clock::time_point t) {
+        for (const auto& sync : syncs) {
+            if (t >= sync.first && t < sync.second) return true;
+        }
+        return false;
+    };
+    vector<double> byKind[KindCount], lookups, lookupsDuringSync;
+    for (const Sample& s : samples) {
+        byKind[s.kind].push_back(s.ms);
+        if (s.kind == Update || s.kind == Sync) continue;
+        lookups.push_back(s.ms);
+        if (duringSync(s.start)) lookupsDuringSync.push_back(s.ms);
+    }
+
+    printf("%d connections for %.1f s on %s", connections, seconds, path.c_str());
+    if (syncEveryMs > 0) printf(", plus one updating stock and syncing every %d ms", syncEveryMs);
+    printf("\n%-22s %9s %10s %9s %9s %9s %9s\n", "Request", "Count", "QPS", "p50 ms", "p99 ms", "p99.9 ms", "max ms");
+    for (int k = 0; k < KindCount; ++k) printLine(kKindNames[k], byKind[k], seconds);
+    printLine("all lookups", lookups, seconds);
+    printLine("lookups during a sync", lookupsDuringSync, 0);
+    printf("ERR replies: %zu\n", errors.load());
+    return 0;
+}
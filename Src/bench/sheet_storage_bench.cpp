@@ -0,0 +1,138 @@
+// Benchmark: sheet storage, the std::vector<std::vector<std::string>> layout SheetData
+// used to be against SheetData's per-sheet arena. A generated App Sheet CSV is loaded
+// into each layout (cell by cell from a CsvView, the way readCSV materializes it), then
+// cleared and loaded again, as a reload after menu option 6 does. Prints the time, the
+// operator new calls and the resident memory of each step. Every layout runs in a child
+// process of its own, so one run's freed heap cannot flatter the other's numbers.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. sheet_storage_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o sheet_storage_bench
+// Usage: sheet_storage_bench [rows]
+#include "bench_util.h"
+#include "dataset.h"
+#include "../csv_view.h"
+#include "../profiler.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <sys/wait.h>
+#include <unistd.h>
+using namespace std;
+using Clock = chrono::steady_clock;
+
+typedef vector<vector<string>> VectorSheet;
+
+struct StepResult {
+    double ms;
+    uint64_t allocations;
+    long long rssDelta; // resident memory change over the step, bytes
+};
+
+struct LayoutResult {
+    StepResult load, clear, reload, destroy;
+    size_t peakRss;
+};
+
+template <class Sheet>
+void loadSheet(const CsvView& view, Sheet& sheet) {
+    sheet.clear();
+    sheet.resize(view.rowCount());
+    for (size_t r = 0; r < view.rowCount(); ++r) {
+        auto& row = sheet[r];
+        size_t n = view.cellCount(r);
+        row.reserve(n);
+        for (size_t c = 0; c < n; ++c) {
+            string_view value = view.cell(r, c);
+            row.emplace_back(value.data(), value.size());
+        }
+    }
+}
+
+template <class Fn>
+StepResult measure(Fn&& fn) {
+    size_t rssBefore = currentRssBytes();
+    uint64_t allocationsBefore = threadAllocationCount();
+    Clock::time_point start = Clock::now();
+    fn();
+    double ms = chrono::duration<double, milli>(Clock::now() - start).count();
+    return {ms, threadAllocationCount() - allocationsBefore,
+            static_cast<long long>(currentRssBytes()) - static_cast<long long>(rssBefore)};
+}
+
+template <class Sheet>
+LayoutResult runLayout(const string& path) {
+    CsvView view;
+    if (!view.open(path)) exit(1);
+    enableProfiling(true); // counts operator new calls
+    LayoutResult result;
+    Sheet* sheet = new Sheet;
+    result.load = measure([&]() { loadSheet(view, *sheet); });
+    result.clear = measure([&]() { sheet->clear(); });
+    result.reload = measure([&]() { loadSheet(view, *sheet); });
+    result.destroy = measure([&]() { delete sheet; });
+    result.peakRss = peakRssBytes();
+    return result;
+}
+
+// Runs one layout in a child process and reads its results back through a pipe
+template <class Sheet>
+bool runInChild(const string& path, LayoutResult& result) {
+    int fds[2];
+    if (pipe(fds) != 0) return false;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        LayoutResult childResult = runLayout<Sheet>(path);
+        ssize_t written = write(fds[1], &childResult, sizeof(childResult));
+        _exit(written == sizeof(childResult) ? 0 : 1);
+    }
+    close(fds[1]);
+    ssize_t got = read(fds[0], &result, sizeof(result));
+    close(fds[0]);
+    int status = 0;
+    waitpid(pid, &status, 0);
+    return pid > 0 && got == sizeof(result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void printStep(const string& name, const StepResult& step, const string& extra = "") {
+    char counters[160];
+    snprintf(counters, sizeof(counters), "allocations=%llu rss_delta=%.1fM%s",
+             static_cast<unsigned long long>(step.allocations), step.rssDelta / 1048576.0, extra.c_str());
+    printBenchLine(name, {step.ms / 1e3, 1}, counters);
+}
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 1000000;
+    const string path = "sheet_storage_bench.csv";
+    PharmacyDataset data(rows);
+    if (!writeGeneratedCsv(path, rows + 1, [&data](size_t r, vector<string>& row) {
+            if (r == 0) data.appHeader(row);
+            else data.appRow(r - 1, row);
+        })) {
+        fprintf(stderr, "Error: Could not write %s\n", path.c_str());
+        return 1;
+    }
+    printf("App Sheet: %zu rows x 28 columns\n", rows);
+    printBenchHeader();
+
+    const char* names[] = {"vector<vector<string>>", "SheetData"};
+    LayoutResult results[2];
+    bool ok = runInChild<VectorSheet>(path, results[0]) && runInChild<SheetData>(path, results[1]);
+    remove(path.c_str());
+    if (!ok) {
+        fprintf(stderr, "Error: A benchmark child failed\n");
+        return 1;
+    }
+    for (int i = 0; i < 2; ++i) {
+        string suffix = string("/") + names[i] + "/" + to_string(rows);
+        char peak[48];
+        snprintf(peak, sizeof(peak), " peak_rss=%.1fM", results[i].peakRss / 1048576.0);
+        printStep("BM_SheetLoad" + suffix, results[i].load, peak);
+        printStep("BM_SheetClear" + suffix, results[i].clear);
+        printStep("BM_SheetReload" + suffix, results[i].reload);
+        printStep("BM_SheetDestroy" + suffix, results[i].destroy);
+    }
+    return 0;
+}
@@ -0,0 +1,54 @@
+// Benchmark: startup load of a generated App Sheet CSV, parsed vs. reloaded from its snapshot.
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. snapshot_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o snapshot_bench
+#include "bench_util.h"
+#include "dataset.h"
+#include "../csv_view.h"
+#include "../snapshot.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 150000;
+    const string csvPath = "snapshot_bench.csv";
+    PharmacyDataset dataset(rows);
+    writeGeneratedCsv(csvPath, rows + 1, [&dataset](size_t r, vector<string>& row) {
+        if (r == 0) dataset.appHeader(row);
+        else dataset.appRow(r - 1, row);
+    });
+
+    setSnapshotDirectory(".");
+    SourceStamp stamp;
+    readSourceStamp(csvPath, stamp);
+    SheetData sheet;
+    CsvView view;
+    view.open(csvPath);
+    view.toSheetData(sheet);
+    writeSnapshot(snapshotPathFor(csvPath), sheet, csvPath, stamp);
+    printf("Input: %zu rows x 28 columns\n", rows);
+    printBenchHeader();
+
+    BenchResult parse = runBenchmark([&]() {
+        CsvView csv;
+        csv.open(csvPath);
+        csv.toSheetData(sheet);
+        doNotOptimize(sheet);
+    });
+    printBenchLine("BM_LoadCsv/" + to_string(rows), parse);
+
+    BenchResult mapOnly = runBenchmark([&]() {
+        SheetSnapshot snapshot;
+        doNotOptimize(snapshot.open(snapshotPathFor(csvPath)));
+    });
+    printBenchLine("BM_OpenSnapshot/" + to_string(rows), mapOnly);
+
+    BenchResult reload = runBenchmark([&]() { doNotOptimize(loadSnapshotFor(csvPath, sheet)); });
+    printBenchLine("BM_LoadSnapshot/" + to_string(rows), reload);
+
+    remove(csvPath.c_str());
+    remove(snapshotPathFor(csvPath).c_str());
+    return 0;
+}
@@ -0,0 +1,68 @@
+// Benchmark: thread scaling of the full App Sheet sync (menu option 5) from 1 to N threads,
+// then the same sync on the column-oriented Sheet batch mode uses (on the shared pool).
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. sync_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o sync_bench
+// Usage: sync_bench [app rows] [max threads]
+#include "bench_util.h"
+#include "dataset.h"
+#include "../logger.h"
+#include "../operations.h"
+#include "../sheet.h"
+#include "../thread_pool.h"
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 200000;
+    unsigned maxThreads = argc > 2 ? static_cast<unsigned>(strtoul(argv[2], nullptr, 10)) : thread::hardware_concurrency();
+    if (maxThreads == 0) maxThreads = 1;
+
+    LoggerOptions logOptions;
+    logOptions.path = "sync_bench.log";
+    configureLogger(logOptions);
+    PharmacyDataset dataset(rows);
+    SheetData stock = buildSheet(dataset, &PharmacyDataset::stockHeader, &PharmacyDataset::stockRow);
+    SheetData price = buildSheet(dataset, &PharmacyDataset::priceHeader, &PharmacyDataset::priceRow);
+    SheetData app = buildSheet(dataset, &PharmacyDataset::appHeader, &PharmacyDataset::appRow);
+    printf("Input: %zu rows per sheet, up to %u threads\n", rows, maxThreads);
+    printBenchHeader();
+
+    // The sync's messages go to a string stream while timing. After the first run the App
+    // Sheet is in sync, so every run does the full join and compare with no cell writes.
+    ostringstream discarded;
+    streambuf* console = cout.rdbuf(discarded.rdbuf());
+    double serialSeconds = 0;
+    vector<BenchResult> results;
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        ThreadPool pool(threads);
+        results.push_back(runBenchmark([&]() {
+            doNotOptimize(syncAppSheet(app, stock, price, pool));
+            discarded.str("");
+        }));
+    }
+    Sheet columns;
+    columns.assign(app, appSheetColumnTypes());
+    BenchResult columnar = runBenchmark([&]() {
+        doNotOptimize(syncAppSheet(columns, stock, price));
+        discarded.str("");
+    });
+    cout.rdbuf(console);
+
+    for (unsigned threads = 1; threads <= maxThreads; ++threads) {
+        const BenchResult& result = results[threads - 1];
+        if (threads == 1) serialSeconds = result.secondsPerIteration;
+        char speedup[48];
+        snprintf(speedup, sizeof(speedup), "speedup=%.2fx", serialSeconds / result.secondsPerIteration);
+        printBenchLine("BM_SyncAppSheet/" + to_string(rows) + "/threads:" + to_string(threads), result, speedup);
+    }
+    printBenchLine("BM_SyncAppSheet/" + to_string(rows) + "/columnar", columnar, "");
+    flushLog();
+    remove("sync_bench.log");
+    return 0;
+}
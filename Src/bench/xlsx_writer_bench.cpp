@@ -0,0 +1,23 @@
+// Benchmark: native XLSX export of a generated App Sheet (menu option 9).
+// Build from Src/bench:
+//   g++ -std=c++17 -O2 -pthread -I.. xlsx_writer_bench.cpp $(ls ../*.cpp | grep -v /main.cpp) -o xlsx_writer_bench
+#include "bench_util.h"
+#include "dataset.h"
+#include "../xlsx_writer.h"
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+using namespace std;
+
+int main(int argc, char** argv) {
+    size_t rows = argc > 1 ? strtoul(argv[1], nullptr, 10) : 50000;
+    PharmacyDataset dataset(rows);
+    SheetData sheet = buildSheet(dataset, &PharmacyDataset::appHeader, &PharmacyDataset::appRow);
+    printf("Input: %zu rows x 28 columns\n", rows);
+    printBenchHeader();
+
+    BenchResult result = runBenchmark([&]() { doNotOptimize(writeXlsx("xlsx_writer_bench.xlsx", sheet)); }, 2.0);
+    printBenchLine("BM_WriteXlsx/" + to_string(rows), result);
+    remove("xlsx_writer_bench.xlsx");
+    return 0;
+}
@@ -0,0 +1,152 @@
+#include "bulk_update.h"
+#include "file_handler.h"
+#include "logger.h"
+#include "profiler.h"
+#include "text_utils.h"
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+namespace {
+
+const int kStockTotalCol = 21; // total column in stockSheet
+const int kPriceValueCol = 8;  // السعر column in priceSheet
+
+// The cell text the single-code update would write for value, or false if value is not
+// a whole number (stock) or a finite number (price)
+bool formatValue(const string& value, BulkTarget target, string& cell) {
+    if (value.empty()) return false;
+    char* end = nullptr;
+    errno = 0;
+    if (target == BulkTarget::Stock) {
+        long long stock = strtoll(value.c_str(), &end, 10);
+        if (*end != '\0' || errno != 0 || stock < INT_MIN || stock > INT_MAX) return false;
+        cell = to_string(static_cast<int>(stock));
+    } else {
+        double price = strtod(value.c_str(), &end);
+        if (*end != '\0' || errno != 0 || !isfinite(price)) return false;
+        cell = to_string(price);
+    }
+    return true;
+}
+
+bool hasDigit(const string& text) {
+    for (char c : text) {
+        if (c >= '0' && c <= '9') return true;
+    }
+    return false;
+}
+
+const char* targetName(BulkTarget target) {
+    return target == BulkTarget::Stock ? "stock" : "price";
+}
+
+// Checks and writes one update; message is the per-code log line when it is applied
+UpdateStatus applyOne(SheetData& sheet, const SheetIndex& index, BulkTarget target, const BulkUpdate& update,
+                      SyncChangeSet* changes, string& message) {
+    string cell;
+    if (update.code.empty() || !formatValue(update.value, target, cell)) return UpdateStatus::Invalid;
+    int col = target == BulkTarget::Stock ? kStockTotalCol : kPriceValueCol;
+    int row = index.find(update.code);
+    if (row == -1 || col >= (int)sheet[row].size()) return UpdateStatus::Unmatched;
+    sheet[row][col] = cell;
+    if (target == BulkTarget::Stock) {
+        message = "Stock updated for code " + update.code + ": new stock = " + cell;
+        if (changes) changes->markStock(update.code);
+    } else {
+        message = "Price updated for الكود " + update.code + ": new السعر = " + cell;
+        if (changes) changes->markPrice(update.code);
+    }
+    return UpdateStatus::Applied;
+}
+
+} // namespace
+
+bool readBulkUpdates(const string& path, vector<BulkUpdate>& updates) {
+    if (path == "-") {
+        readBulkUpdates(cin, updates);
+        return true;
+    }
+    ifstream file(path, ios::binary);
+    if (!file) return false;
+    readBulkUpdates(file, updates);
+    return true;
+}
+
+void readBulkUpdates(istream& in, vector<BulkUpdate>& updates) {
+    PROFILE_SCOPE("readBulkUpdates");
+    string line;
+    size_t lineNumber = 0;
+    bool first = true;
+    while (getline(in, line)) {
+        ++lineNumber;
+        if (lineNumber == 1 && line.compare(0, 3, "\xEF\xBB\xBF") == 0) line.erase(0, 3); // UTF-8 BOM (Excel)
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (trimView(line).empty()) continue;
+        vector<string> fields = splitCSVLine(line);
+        BulkUpdate update;
+        if (!fields.empty()) update.code = string(trimView(fields[0]));
+        if (fields.size() >= 2) update.value = string(trimView(fields[1]));
+        update.line = lineNumber;
+        bool header = first && !hasDigit(update.value);
+        first = false;
+        if (!header) updates.push_back(std::move(update));
+    }
+}
+
+// Every code is resolved through the index (one hash lookup each) and written in input
+// order; the per-code log lines, a summary and the unmatched codes go out as one record set
+BulkUpdateReport applyBulkUpdates(SheetData& sheet, const SheetIndex& index, BulkTarget target,
+                                  const vector<BulkUpdate>& updates, SyncChangeSet* changes) {
+    PROFILE_SCOPE("applyBulkUpdates");
+    profileCount(ProfileCounter::RowsScanned, updates.size());
+    BulkUpdateReport report;
+    vector<string> messages;
+    messages.reserve(updates.size() + 1);
+    string message;
+    for (const BulkUpdate& update : updates) {
+        UpdateStatus status = applyOne(sheet, index, target, update, changes, message);
+        if (status == UpdateStatus::Invalid) {
+            report.invalid.push_back(update);
+        } else if (status == UpdateStatus::Unmatched) {
+            report.unmatched.push_back(update);
+        } else {
+            report.applied++;
+            messages.push_back(std::move(message));
+        }
+    }
+    for (const BulkUpdate& update : report.unmatched) {
+        messages.push_back("Bulk " + string(targetName(target)) + " update: code " + update.code + " not found (line " +
+                           to_string(update.line) + ")");
+    }
+    messages.insert(messages.begin(), "Bulk " + string(targetName(target)) + " update: " + to_string(report.applied) +
+                                          " applied, " + to_string(report.unmatched.size()) + " unmatched, " +
+                                          to_string(report.invalid.size()) + " invalid.");
+    logChanges(messages);
+    profileCount(ProfileCounter::CellsUpdated, report.applied);
+    return report;
+}
+
+UpdateStatus applyUpdate(SheetData& sheet, const SheetIndex& index, BulkTarget target, const BulkUpdate& update,
+                         SyncChangeSet* changes) {
+    string message;
+    UpdateStatus status = applyOne(sheet, index, target, update, changes, message);
+    if (status == UpdateStatus::Applied) logChange(message);
+    return status;
+}
+
+void printBulkUpdateReport(const BulkUpdateReport& report, BulkTarget target) {
+    cout << "Bulk " << targetName(target) << " update: " << report.applied << " applied, " << report.unmatched.size()
+         << " unmatched, " << report.invalid.size() << " invalid.\n";
+    for (const BulkUpdate& update : report.unmatched) {
+        cout << "  Not found: " << update.code << " (line " << update.line << ")\n";
+    }
+    for (const BulkUpdate& update : report.invalid) {
+        cout << "  Invalid: line " << update.line << " (code \"" << update.code << "\", value \"" << update.value
+             << "\")\n";
+    }
+}
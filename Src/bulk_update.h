@@ -0,0 +1,48 @@
+#pragma once
+#include "operations.h"
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+// Bulk stock and price changes, e.g. a morning delivery of a few thousand stock counts:
+// "code,value" lines read from a CSV file or stdin, resolved through one code index and
+// written to the sheet in one batch, with the unmatched codes reported and the changes
+// logged as one record set.
+
+enum class BulkTarget { Stock, Price }; // Stock Sheet total (column 21) or Price Sheet السعر (column 8)
+
+struct BulkUpdate {
+    std::string code;
+    std::string value;
+    size_t line = 0; // 1-based line in the input
+};
+
+struct BulkUpdateReport {
+    size_t applied = 0;
+    std::vector<BulkUpdate> unmatched; // code not in the sheet
+    std::vector<BulkUpdate> invalid;   // value is not a whole number (stock) or a number (price)
+};
+
+// Reads code,value lines (CSV quoting allowed, fields trimmed, blank lines skipped). A
+// first line whose value holds no digit is taken as a header. Lines without a value are
+// kept with an empty one, so they are reported as invalid. path "-" reads stdin. Returns
+// false if the file could not be opened.
+bool readBulkUpdates(const std::string& path, std::vector<BulkUpdate>& updates);
+void readBulkUpdates(std::istream& in, std::vector<BulkUpdate>& updates);
+
+// Applies the updates in input order (a code listed twice ends with its last value) with
+// the same cell format and per-code log text as updateStock / updatePrice. The codes are
+// recorded in changes (if given). Stock updates look codes up in column 0, price updates
+// in column 14 (the Price Sheet as loaded, before clean-price), through index.
+BulkUpdateReport applyBulkUpdates(SheetData& sheet, const SheetIndex& index, BulkTarget target,
+                                  const std::vector<BulkUpdate>& updates, SyncChangeSet* changes = nullptr);
+
+enum class UpdateStatus { Applied, Unmatched, Invalid };
+
+// One update with the same checks and cell text as applyBulkUpdates, logged as its own
+// record (the resident server applies updates one request at a time)
+UpdateStatus applyUpdate(SheetData& sheet, const SheetIndex& index, BulkTarget target, const BulkUpdate& update,
+                         SyncChangeSet* changes = nullptr);
+
+// Prints the counts and every unmatched or invalid line
+void printBulkUpdateReport(const BulkUpdateReport& report, BulkTarget target);
@@ -0,0 +1,11 @@
+#include "console.h"
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+void setupConsoleUtf8() {
+#ifdef _WIN32
+    SetConsoleOutputCP(CP_UTF8);
+    SetConsoleCP(CP_UTF8);
+#endif
+}
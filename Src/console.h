@@ -0,0 +1,5 @@
+#pragma once
+
+// Switches the console to UTF-8 so Arabic text displays correctly. Only Windows
+// consoles need this; elsewhere it does nothing, so the tool builds without windows.h.
+void setupConsoleUtf8();
@@ -0,0 +1,261 @@
+#include "csv_tokenizer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define CSV_TOKENIZER_AVX2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define CSV_TOKENIZER_SSE2
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+using namespace std;
+
+namespace {
+
+// Bitmask of the ',', '"' and '\n' bytes among the first n (<= 64) bytes of p
+inline uint64_t classifyScalar(const char* p, size_t n) {
+    uint64_t mask = 0;
+    for (size_t i = 0; i < n; ++i) {
+        char c = p[i];
+        if (c == ',' || c == '"' || c == '\n') mask |= uint64_t(1) << i;
+    }
+    return mask;
+}
+
+#if defined(CSV_TOKENIZER_AVX2)
+inline uint32_t classify32(__m256i v) {
+    __m256i hits = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')),
+                                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))),
+                                   _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+    return static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+}
+
+// Bitmask of the ',', '"' and '\n' bytes in a 64-byte block
+inline uint64_t classifyBlock(const char* p) {
+    uint64_t lo = classify32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p)));
+    uint64_t hi = classify32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32)));
+    return lo | (hi << 32);
+}
+#elif defined(CSV_TOKENIZER_SSE2)
+inline uint64_t classify16(const char* p) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i hits = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+                                             _mm_cmpeq_epi8(v, _mm_set1_epi8('"'))),
+                                _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+    return static_cast<uint32_t>(_mm_movemask_epi8(hits));
+}
+
+// Bitmask of the ',', '"' and '\n' bytes in a 64-byte block
+inline uint64_t classifyBlock(const char* p) {
+    return classify16(p) | (classify16(p + 16) << 16) | (classify16(p + 32) << 32) | (classify16(p + 48) << 48);
+}
+#else
+// Bitmask of the ',', '"' and '\n' bytes in a 64-byte block
+inline uint64_t classifyBlock(const char* p) {
+    return classifyScalar(p, 64);
+}
+#endif
+
+inline int lowestBit(uint64_t mask) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, mask);
+    return static_cast<int>(index);
+#else
+    return __builtin_ctzll(mask);
+#endif
+}
+
+// Field/row state machine driven by the structural bytes only
+class Tokenizer {
+public:
+    Tokenizer(const char* data, vector<CsvField>& fields, vector<size_t>& rowEnds)
+        : data_(data), fields_(fields), rowEnds_(rowEnds), rowFirstField_(fields.size()) {}
+
+    void onByte(size_t pos) {
+        char c = data_[pos];
+        if (c == '"') {
+            // Quotes toggle the state; a doubled quote closes and reopens, which marks an escape
+            inQuotes_ = !inQuotes_;
+            if (quoteCount_++ == 0) firstQuote_ = pos;
+            lastQuote_ = pos;
+        } else if (inQuotes_) {
+            return; // separators inside quotes are data
+        } else if (c == ',') {
+            endField(pos);
+            fieldStart_ = pos + 1;
+        } else {
+            size_t end = pos;
+            if (end > fieldStart_ && data_[end - 1] == '\r') --end;
+            endRow(end);
+            fieldStart_ = pos + 1;
+        }
+    }
+
+    void finish(size_t size) {
+        if (fieldStart_ < size || fields_.size() > rowFirstField_ || quoteCount_ > 0) endRow(size);
+    }
+
+private:
+    void endField(size_t end) {
+        if (quoteCount_ == 0) {
+            fields_.push_back({fieldStart_, static_cast<uint32_t>(end - fieldStart_), false});
+        } else if (quoteCount_ == 2 && firstQuote_ == fieldStart_ && lastQuote_ + 1 == end) {
+            fields_.push_back({fieldStart_ + 1, static_cast<uint32_t>(end - fieldStart_ - 2), false});
+        } else {
+            fields_.push_back({fieldStart_, static_cast<uint32_t>(end - fieldStart_), true});
+        }
+        quoteCount_ = 0;
+    }
+
+    void endRow(size_t end) {
+        // An empty line is a row with no fields
+        if (fields_.size() > rowFirstField_ || end > fieldStart_ || quoteCount_ > 0) endField(end);
+        rowEnds_.push_back(fields_.size());
+        rowFirstField_ = fields_.size();
+        inQuotes_ = false;
+    }
+
+    const char* data_;
+    vector<CsvField>& fields_;
+    vector<size_t>& rowEnds_;
+    size_t rowFirstField_;
+    size_t fieldStart_ = 0;
+    size_t quoteCount_ = 0;
+    size_t firstQuote_ = 0;
+    size_t lastQuote_ = 0;
+    bool inQuotes_ = false;
+};
+
+} // namespace
+
+// Splits data into fields and rows (see csv_tokenizer.h for the rules)
+void tokenizeCsv(const char* data, size_t size, vector<CsvField>& fields, vector<size_t>& rowEnds) {
+    Tokenizer tokenizer(data, fields, rowEnds);
+    size_t pos = 0;
+    for (; pos + 64 <= size; pos += 64) {
+        uint64_t mask = classifyBlock(data + pos);
+        while (mask != 0) {
+            tokenizer.onByte(pos + lowestBit(mask));
+            mask &= mask - 1;
+        }
+    }
+    uint64_t mask = classifyScalar(data + pos, size - pos);
+    while (mask != 0) {
+        tokenizer.onByte(pos + lowestBit(mask));
+        mask &= mask - 1;
+    }
+    tokenizer.finish(size);
+}
+
+// Below this many bytes per chunk a thread costs more than it saves
+static const size_t kMinParallelChunk = size_t(1) << 20;
+
+// Tokenizes row-aligned chunks on the pool (see csv_tokenizer.h). The tokenizer's quote
+// state is the parity of all quotes before a byte, so a newline ends a row exactly when
+// an even number of quotes precede it.
+void tokenizeCsvParallel(const char* data, size_t size, vector<CsvField>& fields, vector<size_t>& rowEnds,
+                         ThreadPool& pool) {
+    size_t chunks = min<size_t>(pool.size(), size / kMinParallelChunk);
+    if (chunks <= 1) {
+        tokenizeCsv(data, size, fields, rowEnds);
+        return;
+    }
+
+    // Quote count of each equal slice, then move every slice start to the next row start
+    vector<size_t> quotes(chunks);
+    pool.parallelFor(chunks, [&](size_t k) {
+        quotes[k] = count(data + k * size / chunks, data + (k + 1) * size / chunks, '"');
+    });
+    vector<size_t> bounds(chunks + 1, size);
+    bounds[0] = 0;
+    size_t quotesBefore = 0;
+    for (size_t k = 1; k < chunks; ++k) {
+        quotesBefore += quotes[k - 1];
+        size_t pos = k * size / chunks;
+        if (pos <= bounds[k - 1]) { // the previous search already ran past this slice
+            bounds[k] = bounds[k - 1];
+            continue;
+        }
+        bool inQuotes = (quotesBefore & 1) != 0;
+        for (bounds[k] = size; pos < size; ++pos) {
+            if (data[pos] == '"') {
+                inQuotes = !inQuotes;
+            } else if (data[pos] == '\n' && !inQuotes) {
+                bounds[k] = pos + 1;
+                break;
+            }
+        }
+    }
+
+    // Each chunk starts in the state the tokenizer has right after a row, so tokenizing
+    // it on its own gives the same fields, relative to the chunk start
+    vector<vector<CsvField>> chunkFields(chunks);
+    vector<vector<size_t>> chunkRowEnds(chunks);
+    pool.parallelFor(chunks, [&](size_t k) {
+        chunkFields[k].reserve((bounds[k + 1] - bounds[k]) / 8);
+        tokenizeCsv(data + bounds[k], bounds[k + 1] - bounds[k], chunkFields[k], chunkRowEnds[k]);
+    });
+
+    // Stitch in chunk order, shifting offsets and row ends by what precedes each chunk
+    vector<size_t> fieldBase(chunks + 1, fields.size()), rowBase(chunks + 1, rowEnds.size());
+    for (size_t k = 0; k < chunks; ++k) {
+        fieldBase[k + 1] = fieldBase[k] + chunkFields[k].size();
+        rowBase[k + 1] = rowBase[k] + chunkRowEnds[k].size();
+    }
+    fields.resize(fieldBase[chunks]);
+    rowEnds.resize(rowBase[chunks]);
+    pool.parallelFor(chunks, [&](size_t k) {
+        CsvField* outField = fields.data() + fieldBase[k];
+        for (const CsvField& field : chunkFields[k]) {
+            *outField++ = {field.offset + bounds[k], field.length, field.needsUnescape};
+        }
+        size_t* outRowEnd = rowEnds.data() + rowBase[k];
+        for (size_t end : chunkRowEnds[k]) *outRowEnd++ = end + fieldBase[k];
+        vector<CsvField>().swap(chunkFields[k]);
+    });
+}
+
+// Appends the decoded value of a raw field (quotes removed, "" collapsed to ")
+void appendCsvUnescaped(string& out, string_view raw) {
+    bool inQuotes = false;
+    for (size_t i = 0; i < raw.size(); ++i) {
+        char c = raw[i];
+        if (c != '"') {
+            out += c;
+        } else if (inQuotes && i + 1 < raw.size() && raw[i + 1] == '"') {
+            out += '"';
+            ++i;
+        } else {
+            inQuotes = !inQuotes;
+        }
+    }
+}
+
+// Appends a field to a CSV line, quoting it when it holds ',', '"', '\r' or '\n'
+void appendCsvField(string& out, string_view field) {
+    if (field.find_first_of(",\"\r\n") == string_view::npos) {
+        out.append(field.data(), field.size());
+        return;
+    }
+    out += '"';
+    for (char c : field) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// Name of the byte classifier compiled in
+const char* csvTokenizerBackend() {
+#if defined(CSV_TOKENIZER_AVX2)
+    return "avx2";
+#elif defined(CSV_TOKENIZER_SSE2)
+    return "sse2";
+#else
+    return "scalar";
+#endif
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+class ThreadPool;
+
+// One field found by the tokenizer. Plain and simply-quoted fields are exact spans of
+// their value (quotes excluded). Fields with escaped quotes ("") or stray quotes keep
+// the raw bytes and set needsUnescape; decode those with appendCsvUnescaped.
+struct CsvField {
+    uint64_t offset;
+    uint32_t length;
+    bool needsUnescape;
+};
+
+// RFC 4180 tokenizer: fields are separated by ',', rows by '\n' or "\r\n", and quoted
+// fields may hold commas, newlines and doubled quotes. An empty line is a row with no
+// fields and a final newline does not start a new row. Structural bytes are classified
+// 64 at a time with AVX2 or SSE2 when available, with a scalar fallback.
+// Appends to fields and pushes the end index (into fields) of every row to rowEnds.
+void tokenizeCsv(const char* data, size_t size, std::vector<CsvField>& fields, std::vector<size_t>& rowEnds);
+
+// Same result as tokenizeCsv, but the input is split into row-aligned chunks that are
+// tokenized on the pool and stitched back in order. Chunk boundaries are placed on
+// newlines outside quotes, found from the quote count of the preceding bytes.
+void tokenizeCsvParallel(const char* data, size_t size, std::vector<CsvField>& fields,
+                         std::vector<size_t>& rowEnds, ThreadPool& pool);
+
+// Appends the decoded value of a raw field (quotes removed, "" collapsed to ")
+void appendCsvUnescaped(std::string& out, std::string_view raw);
+
+// Appends a field to a CSV line, quoting it when it holds ',', '"', '\r' or '\n'
+void appendCsvField(std::string& out, std::string_view field);
+
+// Name of the byte classifier compiled in ("avx2", "sse2" or "scalar")
+const char* csvTokenizerBackend();
@@ -0,0 +1,72 @@
+#include "csv_view.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include <algorithm>
+using namespace std;
+
+// Rows per task when materializing a large view
+static const size_t kRowsPerTask = 16384;
+
+// Maps and tokenizes the file at path (RFC 4180, see csv_tokenizer.h). Large files are
+// tokenized in row-aligned chunks on the shared pool. Returns true if successful.
+bool CsvView::open(const string& path) {
+    PROFILE_SCOPE("CsvView::open");
+    cells_.clear();
+    rowStart_.clear();
+    unescaped_.clear();
+    file_ = make_shared<MappedFile>();
+    if (!file_->open(path)) return false;
+    profileCount(ProfileCounter::BytesRead, file_->size());
+
+    cells_.reserve(file_->size() / 8);
+    rowStart_.push_back(0);
+    tokenizeCsvParallel(file_->data(), file_->size(), cells_, rowStart_, ThreadPool::shared());
+
+    // Cells with escaped quotes cannot be a plain span, so decode them once here
+    for (size_t r = 0; r < rowCount(); ++r) {
+        for (size_t c = 0; c < cellCount(r); ++c) {
+            const CsvField& field = cells_[rowStart_[r] + c];
+            if (!field.needsUnescape) continue;
+            string value;
+            appendCsvUnescaped(value, string_view(file_->data() + field.offset, field.length));
+            unescaped_[cellKey(r, c)] = std::move(value);
+        }
+    }
+    return true;
+}
+
+// Returns the value of a cell: a span into the mapping, or the decoded copy of a cell
+// with escaped quotes
+string_view CsvView::cell(size_t row, size_t col) const {
+    const CsvField& field = cells_[rowStart_[row] + col];
+    if (field.needsUnescape) return unescaped_.find(cellKey(row, col))->second;
+    return string_view(file_->data() + field.offset, field.length);
+}
+
+// Fills data with the view's rows, as spans into the mapping the sheet adopts. Blocks of
+// rows are filled on the shared pool; every row lands at its own index, so the order is
+// fixed.
+void CsvView::toSheetData(SheetData& data) const {
+    PROFILE_SCOPE("CsvView::toSheetData");
+    data.clear();
+    if (kReplaceableWhileMapped) data.adoptMapping(file_);
+    data.resize(rowCount());
+    size_t tasks = (data.size() + kRowsPerTask - 1) / kRowsPerTask;
+    ThreadPool::shared().parallelFor(tasks, [&](size_t task) {
+        size_t end = min(data.size(), (task + 1) * kRowsPerTask);
+        for (size_t r = task * kRowsPerTask; r < end; ++r) {
+            SheetRow& row = data[r];
+            size_t n = cellCount(r);
+            row.reserve(n);
+            for (size_t c = 0; c < n; ++c) {
+                const CsvField& field = cells_[rowStart_[r] + c];
+                if (kReplaceableWhileMapped && !field.needsUnescape) {
+                    string_view span(file_->data() + field.offset, field.length);
+                    row.push_back(SheetCell::mapped(span, row.get_allocator()));
+                } else {
+                    row.emplace_back(cell(r, c));
+                }
+            }
+        }
+    });
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "csv_tokenizer.h"
+#include "mapped_file.h"
+#include "sheet_data.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Read-only view of a CSV file. The file stays memory mapped and every cell is a span
+// into the mapping; only quoted cells whose escaped quotes have to be decoded are held as
+// strings. readCSV turns it into a SheetData that keeps the mapping and whose cells are
+// the same spans (see toSheetData); the fused price cleanup (option 17, batch clean-price)
+// reads cells from the view itself.
+class CsvView {
+public:
+    // Maps and indexes the file at path. Returns true if successful.
+    bool open(const std::string& path);
+
+    size_t rowCount() const { return rowStart_.empty() ? 0 : rowStart_.size() - 1; }
+    size_t cellCount(size_t row) const { return rowStart_[row + 1] - rowStart_[row]; }
+
+    // Returns the value of a cell
+    std::string_view cell(size_t row, size_t col) const;
+    // The mapped file the cells are spans of
+    std::shared_ptr<const MappedFile> mapping() const { return file_; }
+
+    // Fills data with the view's rows. The sheet keeps the file mapped and its cells read
+    // from it; decoded cells (and every cell, where kReplaceableWhileMapped is false) are
+    // copied into the sheet's arena.
+    void toSheetData(SheetData& data) const;
+
+private:
+    static uint64_t cellKey(size_t row, size_t col) { return (static_cast<uint64_t>(row) << 32) | col; }
+
+    std::shared_ptr<MappedFile> file_; // a new one per open: sheets may still hold the last one
+    std::vector<CsvField> cells_;
+    std::vector<size_t> rowStart_; // index of each row's first cell in cells_, plus an end marker
+    std::unordered_map<uint64_t, std::string> unescaped_; // quoted cells with escaped quotes
+};
@@ -1,56 +1,362 @@
 #include "file_handler.h"
-#include <fstream>
-#include <sstream>
+#include "csv_tokenizer.h"
+#include "csv_view.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <fcntl.h>
 #include <iostream>
+#ifdef _WIN32
+#include <io.h>
+#include <sys/stat.h>
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 using namespace std;
 
 // Reads a CSV file into a 2D vector. Returns true if successful.
-bool readCSV(const string& path, vector<vector<string>>& data) {
-    ifstream file(path.c_str());
-    if (!file.is_open()) {
+// With snapshots on, one taken from the file's current contents is loaded instead of
+// parsing it. Otherwise the file is memory mapped and parsed by CsvView, and the sheet
+// keeps the mapping, its cells reading their text from it until they are written (see
+// SheetCell). With snapshots on, a snapshot is left for the next run, stamped with the
+// file as it was before it was read.
+bool readCSV(const string& path, SheetData& data) {
+    PROFILE_SCOPE("readCSV");
+    if (loadSnapshotFor(path, data)) return true;
+    SourceStamp stamp;
+    bool stamped = snapshotsEnabled() && readSourceStamp(path, stamp);
+    CsvView view;
+    if (!view.open(path)) {
         cerr << "Error: Could not open file " << path << endl;
         return false;
     }
-    data.clear();
-    string line;
-    while (getline(file, line)) {
-        data.push_back(splitCSVLine(line));
+    view.toSheetData(data);
+    if (stamped) saveSnapshotFor(path, data, stamp);
+    return true;
+}
+
+// Same, straight into columns: the rows never exist as SheetData
+bool readCSV(const string& path, Sheet& sheet, const ColumnTypes& types) {
+    PROFILE_SCOPE("readCSV");
+    if (loadSnapshotFor(path, sheet, types)) return true;
+    SourceStamp stamp;
+    bool stamped = snapshotsEnabled() && readSourceStamp(path, stamp);
+    CsvView view;
+    if (!view.open(path)) {
+        cerr << "Error: Could not open file " << path << endl;
+        return false;
+    }
+    sheet.assign(view, types);
+    if (stamped) saveSnapshotFor(path, sheet, stamp);
+    return true;
+}
+
+namespace {
+
+const size_t kWriteBufferBytes = 1 << 20; // formatted bytes handed to each write call
+const size_t kReadChunkBytes = 4 << 20;   // bytes CsvRowReader reads at a time
+
+// The temporary file a save writes before renaming it over target. It takes the target's
+// permissions, so a save does not reset them.
+#ifdef _WIN32
+int createTempFile(const string& path, const string&) {
+    return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+}
+bool writeAll(int fd, const string& data) {
+    return _write(fd, data.data(), static_cast<unsigned>(data.size())) == static_cast<int>(data.size());
+}
+bool syncFile(int fd) { return _commit(fd) == 0; }
+void closeFile(int fd) { _close(fd); }
+// ReplaceFile keeps the replaced file's attributes and ACL; a new file is just moved in place
+bool replaceFile(const string& from, const string& to) {
+    if (ReplaceFileA(to.c_str(), from.c_str(), nullptr, 0, nullptr, nullptr)) return true;
+    return MoveFileExA(from.c_str(), to.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+}
+#else
+int createTempFile(const string& path, const string& target) {
+    struct stat existing;
+    if (stat(target.c_str(), &existing) != 0) return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    mode_t mode = existing.st_mode & 07777;
+    int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, mode & 0777);
+    if (fd < 0) return fd;
+    // Best effort, as a save must not fail over it: the group (which a shared folder relies
+    // on) and the owner when allowed, then the mode again in case the umask dropped bits
+    if (fchown(fd, existing.st_uid, existing.st_gid) != 0) {
+        int groupOnly = fchown(fd, static_cast<uid_t>(-1), existing.st_gid);
+        (void)groupOnly;
+    }
+    fchmod(fd, mode);
+    return fd;
+}
+bool writeAll(int fd, const string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+bool syncFile(int fd) { return fsync(fd) == 0; }
+void closeFile(int fd) { close(fd); }
+bool replaceFile(const string& from, const string& to) {
+    if (rename(from.c_str(), to.c_str()) != 0) return false;
+    // Make the rename itself durable
+    size_t slash = to.find_last_of('/');
+    string dir = slash == string::npos ? "." : (slash == 0 ? "/" : to.substr(0, slash));
+    int dirFd = open(dir.c_str(), O_RDONLY);
+    if (dirFd >= 0) {
+        fsync(dirFd);
+        close(dirFd);
+    }
+    return true;
+}
+#endif
+
+// Row is a sheet row (of a SheetData or a Sheet) or a std::vector<std::string> (CsvRowWriter)
+template <class Row>
+void appendCsvRow(string& buffer, const Row& row) {
+    if (row.size() == 1 && row[0].empty()) {
+        buffer += "\"\""; // a lone empty field, so it does not read back as an empty row
+        return;
+    }
+    for (size_t j = 0; j < row.size(); ++j) {
+        if (j != 0) buffer += ',';
+        appendCsvField(buffer, row[j]);
+    }
+}
+
+// Writes data (a SheetData or a Sheet) to a CSV file. Returns true if successful.
+// Rows are formatted into one reusable buffer that is written with a single call each
+// time it fills. The data goes to a temporary file next to the target, which is synced
+// and then renamed over it, so a crash or a failed write leaves the old file intact.
+template <class Data>
+bool writeCsvFile(const string& path, const Data& data) {
+    string tempPath = path + ".tmp";
+    int fd = createTempFile(tempPath, path);
+    if (fd < 0) {
+        cerr << "Error: Could not open file for writing: " << path << endl;
+        return false;
+    }
+
+    string buffer;
+    buffer.reserve(kWriteBufferBytes + 4096);
+    bool ok = true;
+    uint64_t bytesWritten = 0;
+    for (size_t i = 0; i < data.size() && ok; ++i) {
+        appendCsvRow(buffer, data[i]);
+        if (i != data.size() - 1) buffer += '\n';
+        if (buffer.size() >= kWriteBufferBytes) {
+            ok = writeAll(fd, buffer);
+            bytesWritten += buffer.size();
+            buffer.clear();
+        }
+    }
+    ok = ok && writeAll(fd, buffer) && syncFile(fd);
+    bytesWritten += buffer.size();
+    closeFile(fd);
+    // The rename keeps the size and modification time, so this is the saved file's stamp
+    SourceStamp stamp;
+    bool stamped = ok && snapshotsEnabled() && readSourceStamp(tempPath, stamp);
+    if (!ok || !replaceFile(tempPath, path)) {
+        remove(tempPath.c_str());
+        cerr << "Error: Could not write file: " << path << endl;
+        return false;
     }
-    file.close();
+    profileCount(ProfileCounter::BytesWritten, bytesWritten);
+    profileCount(ProfileCounter::RowsScanned, data.size());
+    // An empty last row has no line of its own and would not read back from the file
+    if (stamped && (data.empty() || !data.back().empty())) saveSnapshotFor(path, data, stamp);
     return true;
 }
 
-// Writes a 2D vector to a CSV file. Returns true if successful.
-bool writeCSV(const string& path, const vector<vector<string>>& data) {
-    ofstream file(path.c_str());
-    if (!file.is_open()) {
+} // namespace
+
+bool writeCSV(const string& path, const SheetData& data) {
+    PROFILE_SCOPE("writeCSV");
+    return writeCsvFile(path, data);
+}
+
+bool writeCSV(const string& path, const Sheet& sheet) {
+    PROFILE_SCOPE("writeCSV");
+    return writeCsvFile(path, sheet);
+}
+
+CsvRowReader::~CsvRowReader() {
+    close();
+}
+
+bool CsvRowReader::open(const string& path) {
+    close();
+    file_ = fopen(path.c_str(), "rb");
+    if (!file_) {
+        cerr << "Error: Could not open file " << path << endl;
+        return false;
+    }
+    buffer_.clear();
+    parsedEnd_ = 0;
+    fields_.clear();
+    rowEnds_.clear();
+    nextRow_ = 0;
+    eof_ = false;
+    failed_ = false;
+    return true;
+}
+
+void CsvRowReader::close() {
+    if (file_) fclose(file_);
+    file_ = nullptr;
+}
+
+// Drops the rows already handed out, reads the next chunk and tokenizes the complete rows
+// in the buffer: everything up to the last newline outside quotes (the rest of the buffer
+// at the end of the file). The buffer always starts on a row, so the quote count from its
+// start tells whether a newline ends a row. A row longer than a chunk makes the buffer grow.
+bool CsvRowReader::fill() {
+    fields_.clear();
+    rowEnds_.clear();
+    nextRow_ = 0;
+    while (rowEnds_.empty()) {
+        buffer_.erase(0, parsedEnd_);
+        parsedEnd_ = 0;
+        if (eof_ || !file_) return false;
+        size_t kept = buffer_.size();
+        buffer_.resize(kept + kReadChunkBytes);
+        size_t n = fread(&buffer_[kept], 1, kReadChunkBytes, file_);
+        buffer_.resize(kept + n);
+        profileCount(ProfileCounter::BytesRead, n);
+        if (n < kReadChunkBytes) {
+            eof_ = true;
+            if (ferror(file_)) {
+                failed_ = true;
+                return false;
+            }
+        }
+        size_t end = 0;
+        if (eof_) {
+            end = buffer_.size();
+        } else {
+            bool quoted = false;
+            for (size_t i = 0; i < buffer_.size(); ++i) {
+                if (buffer_[i] == '"') quoted = !quoted;
+                else if (buffer_[i] == '\n' && !quoted) end = i + 1;
+            }
+        }
+        if (end == 0) continue;
+        tokenizeCsv(buffer_.data(), end, fields_, rowEnds_);
+        parsedEnd_ = end;
+    }
+    return true;
+}
+
+bool CsvRowReader::next(vector<string>& row) {
+    if (nextRow_ >= rowEnds_.size() && !fill()) return false;
+    size_t first = nextRow_ == 0 ? 0 : rowEnds_[nextRow_ - 1];
+    size_t last = rowEnds_[nextRow_++];
+    row.resize(last - first);
+    for (size_t i = first; i < last; ++i) {
+        const CsvField& field = fields_[i];
+        string& cell = row[i - first];
+        if (field.needsUnescape) {
+            cell.clear();
+            appendCsvUnescaped(cell, string_view(buffer_.data() + field.offset, field.length));
+        } else {
+            cell.assign(buffer_, field.offset, field.length);
+        }
+    }
+    return true;
+}
+
+CsvRowWriter::~CsvRowWriter() {
+    if (fd_ < 0) return;
+    closeFile(fd_);
+    remove((path_ + ".tmp").c_str());
+}
+
+bool CsvRowWriter::open(const string& path) {
+    path_ = path;
+    fd_ = createTempFile(path + ".tmp", path);
+    if (fd_ < 0) {
         cerr << "Error: Could not open file for writing: " << path << endl;
         return false;
     }
-    for (size_t i = 0; i < data.size(); ++i) {
-        file << joinCSVLine(data[i]);
-        if (i != data.size() - 1) file << '\n';
+    buffer_.clear();
+    buffer_.reserve(kWriteBufferBytes + 4096);
+    firstRow_ = true;
+    ok_ = true;
+    bytesWritten_ = 0;
+    return true;
+}
+
+bool CsvRowWriter::write(const vector<string>& row) {
+    if (!firstRow_) buffer_ += '\n';
+    firstRow_ = false;
+    appendCsvRow(buffer_, row);
+    if (buffer_.size() >= kWriteBufferBytes) {
+        ok_ = ok_ && writeAll(fd_, buffer_);
+        bytesWritten_ += buffer_.size();
+        buffer_.clear();
+    }
+    return ok_;
+}
+
+bool CsvRowWriter::finish() {
+    if (fd_ < 0) return false;
+    bool ok = ok_ && writeAll(fd_, buffer_) && syncFile(fd_);
+    bytesWritten_ += buffer_.size();
+    closeFile(fd_);
+    fd_ = -1;
+    string tempPath = path_ + ".tmp";
+    if (!ok || !replaceFile(tempPath, path_)) {
+        remove(tempPath.c_str());
+        cerr << "Error: Could not write file: " << path_ << endl;
+        return false;
     }
-    file.close();
+    profileCount(ProfileCounter::BytesWritten, bytesWritten_);
     return true;
 }
 
-// Splits a CSV line into fields.
+// Writes several sheets at the same time. Returns true if every file was written.
+bool writeCSVs(const vector<pair<string, const SheetData*>>& files) {
+    PROFILE_SCOPE("writeCSVs");
+    vector<char> written(files.size(), 0);
+    ThreadPool::shared().parallelFor(files.size(), [&](size_t i) {
+        written[i] = writeCSV(files[i].first, *files[i].second);
+    });
+    return find(written.begin(), written.end(), 0) == written.end();
+}
+
+// Splits a CSV line into fields (RFC 4180 quoting).
 vector<string> splitCSVLine(const string& line) {
+    vector<CsvField> fields;
+    vector<size_t> rowEnds;
+    tokenizeCsv(line.data(), line.size(), fields, rowEnds);
     vector<string> result;
-    stringstream ss(line);
-    string item;
-    while (getline(ss, item, ',')) {
-        result.push_back(item);
+    result.reserve(fields.size());
+    for (const CsvField& field : fields) {
+        if (field.needsUnescape) {
+            result.emplace_back();
+            appendCsvUnescaped(result.back(), string_view(line.data() + field.offset, field.length));
+        } else {
+            result.emplace_back(line, field.offset, field.length);
+        }
     }
     return result;
 }
 
-// Joins fields into a CSV line.
+// Joins fields into a CSV line, quoting fields that need it.
 string joinCSVLine(const vector<string>& fields) {
+    // A lone empty field is written as "" so it does not read back as an empty row
+    if (fields.size() == 1 && fields[0].empty()) return "\"\"";
     string line;
     for (size_t i = 0; i < fields.size(); ++i) {
-        line += fields[i];
+        appendCsvField(line, fields[i]);
         if (i != fields.size() - 1) line += ",";
     }
     return line;
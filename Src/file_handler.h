@@ -1,15 +1,81 @@
 #pragma once
+#include "csv_tokenizer.h"
+#include "sheet.h"
+#include "sheet_data.h"
+#include <cstdint>
+#include <cstdio>
 #include <vector>
 #include <string>
+#include <utility>
 
 // Reads a CSV file into a 2D vector. Returns true if successful.
-bool readCSV(const std::string& path, std::vector<std::vector<std::string>>& data);
+bool readCSV(const std::string& path, SheetData& data);
+// Same into a columnar sheet, keeping the given columns as numbers too
+bool readCSV(const std::string& path, Sheet& sheet, const ColumnTypes& types = ColumnTypes());
 
 // Writes a 2D vector to a CSV file. Returns true if successful.
-bool writeCSV(const std::string& path, const std::vector<std::vector<std::string>>& data);
+// The file is replaced atomically: on failure the previous contents are kept.
+bool writeCSV(const std::string& path, const SheetData& data);
+bool writeCSV(const std::string& path, const Sheet& sheet);
 
-// Splits a CSV line into fields.
+// Writes several sheets (path, data) at the same time. Returns true if every file was written.
+bool writeCSVs(const std::vector<std::pair<std::string, const SheetData*>>& files);
+
+// Splits a CSV line into fields (RFC 4180 quoting).
 std::vector<std::string> splitCSVLine(const std::string& line);
 
-// Joins fields into a CSV line.
+// Joins fields into a CSV line, quoting fields that need it.
 std::string joinCSVLine(const std::vector<std::string>& fields);
+
+// Reads a CSV file one row at a time through a bounded buffer, for files too large to
+// load. Rows come out as readCSV would produce them (same tokenizer), but no snapshot is
+// read or written.
+class CsvRowReader {
+public:
+    CsvRowReader() {}
+    ~CsvRowReader();
+    CsvRowReader(const CsvRowReader&) = delete;
+    CsvRowReader& operator=(const CsvRowReader&) = delete;
+
+    bool open(const std::string& path);
+    void close();
+    // Reads the next row into row. Returns false at the end of the file or on a read
+    // error (see failed()).
+    bool next(std::vector<std::string>& row);
+    bool failed() const { return failed_; }
+
+private:
+    bool fill();
+
+    std::FILE* file_ = nullptr;
+    std::string buffer_;      // whole rows [0, parsedEnd_) and the start of the next ones
+    size_t parsedEnd_ = 0;
+    std::vector<CsvField> fields_;
+    std::vector<size_t> rowEnds_;
+    size_t nextRow_ = 0;
+    bool eof_ = false;
+    bool failed_ = false;
+};
+
+// Writes a CSV file one row at a time in writeCSV's format. Like writeCSV the rows go to
+// a temporary file that finish() syncs and renames over the target; a writer destroyed
+// without finish() removes it.
+class CsvRowWriter {
+public:
+    CsvRowWriter() {}
+    ~CsvRowWriter();
+    CsvRowWriter(const CsvRowWriter&) = delete;
+    CsvRowWriter& operator=(const CsvRowWriter&) = delete;
+
+    bool open(const std::string& path);
+    bool write(const std::vector<std::string>& row);
+    bool finish();
+
+private:
+    std::string path_;
+    int fd_ = -1;
+    std::string buffer_;
+    bool firstRow_ = true;
+    bool ok_ = true;
+    uint64_t bytesWritten_ = 0;
+};
@@ -1,23 +1,299 @@
 #include "logger.h"
-#include <fstream>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
 #include <ctime>
+#include <fcntl.h>
 #include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
 using namespace std;
 
-// Logs a change message to a log file with a timestamp
-void logChange(const string& message) {
-    ofstream logFile("log.txt", ios::app);
-    if (!logFile.is_open()) {
-        cerr << "Error: Could not open log file." << endl;
-        return;
+namespace {
+
+#ifdef _WIN32
+int openLogFile(const string& path) { return _open(path.c_str(), _O_WRONLY | _O_CREAT | _O_APPEND | _O_TEXT, 0644); }
+bool writeLogFile(int fd, const string& data) {
+    return _write(fd, data.data(), static_cast<unsigned>(data.size())) == static_cast<int>(data.size());
+}
+bool syncLogFile(int fd) { return _commit(fd) == 0; }
+void closeLogFile(int fd) { _close(fd); }
+#else
+int openLogFile(const string& path) { return open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644); }
+bool writeLogFile(int fd, const string& data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) return false;
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+bool syncLogFile(int fd) { return fsync(fd) == 0; }
+void closeLogFile(int fd) { close(fd); }
+#endif
+
+// Bounded lock-free multi-producer / single-consumer ring (Vyukov's sequence-number
+// queue). Producers claim a slot with one CAS; only the writer thread dequeues.
+class RecordRing {
+public:
+    static const size_t kCapacity = 4096; // power of two
+
+    RecordRing() : slots_(kCapacity) {
+        for (size_t i = 0; i < kCapacity; ++i) slots_[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    // Returns false if the ring is full
+    bool tryPush(string& record) {
+        size_t pos = enqueuePos_.load(memory_order_relaxed);
+        while (true) {
+            Slot& slot = slots_[pos & (kCapacity - 1)];
+            size_t sequence = slot.sequence.load(memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (enqueuePos_.compare_exchange_weak(pos, pos + 1, memory_order_relaxed)) {
+                    slot.record.swap(record);
+                    slot.sequence.store(pos + 1, memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueuePos_.load(memory_order_relaxed);
+            }
+        }
+    }
+
+    // Appends the next record to out. Single consumer only. Returns false if empty.
+    bool tryPopInto(string& out) {
+        Slot& slot = slots_[dequeuePos_ & (kCapacity - 1)];
+        if (slot.sequence.load(memory_order_acquire) != dequeuePos_ + 1) return false;
+        out += slot.record;
+        slot.record.clear();
+        slot.sequence.store(dequeuePos_ + kCapacity, memory_order_release);
+        ++dequeuePos_;
+        return true;
+    }
+
+private:
+    struct Slot {
+        atomic<size_t> sequence;
+        string record;
+    };
+    vector<Slot> slots_;
+    alignas(64) atomic<size_t> enqueuePos_{0};
+    alignas(64) size_t dequeuePos_ = 0;
+};
+
+// Background writer: drains the ring in batches and writes each batch with one write()
+class AsyncLogger {
+public:
+    AsyncLogger() : writer_(&AsyncLogger::run, this) {}
+
+    ~AsyncLogger() {
+        {
+            lock_guard<mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        writer_.join();
+    }
+
+    void push(string record) {
+        while (!ring_.tryPush(record)) {
+            // Only a full ring makes a caller wait, and only until the writer drains it
+            wake_.notify_one();
+            this_thread::yield();
+        }
+        pushed_.fetch_add(1, memory_order_release);
+        if (writerIdle_.load(memory_order_acquire)) wake_.notify_one();
+    }
+
+    // Waits on durable_, which only moves once the records are synced (or lost), never
+    // just because they were written
+    bool flush() {
+        unique_lock<mutex> lock(mutex_);
+        size_t target = pushed_.load(memory_order_acquire);
+        flushRequested_ = true;
+        wake_.notify_one();
+        flushed_.wait(lock, [&]() { return durable_ >= target; });
+        bool ok = lostThrough_ <= flushedThrough_;
+        flushedThrough_ = max(flushedThrough_, target);
+        return ok;
+    }
+
+    void configure(const LoggerOptions& options) {
+        flush();
+        lock_guard<mutex> lock(mutex_);
+        pendingOptions_ = options;
+        reconfigure_ = true;
     }
-    // Get current time
+
+private:
+    void run() {
+        using Clock = chrono::steady_clock;
+        LoggerOptions options;
+        int fd = -1;
+        string batch;
+        size_t popped = 0, unsyncedRecords = 0;
+        // Records up to popped are written; the last unsyncedRecords of them wait for a sync.
+        // A record that cannot be written, or whose sync fails, is lost: it still counts as
+        // settled so flush() does not wait for it forever, and lostThrough_ reports it.
+        auto settle = [&](bool lost) {
+            lock_guard<mutex> lock(mutex_);
+            durable_ = popped;
+            if (lost) lostThrough_ = popped;
+        };
+        Clock::time_point lastSync = Clock::now();
+
+        while (true) {
+            bool stop, flushNow;
+            {
+                unique_lock<mutex> lock(mutex_);
+                writerIdle_.store(true, memory_order_release);
+                wake_.wait_for(lock, chrono::milliseconds(options.flushIntervalMs), [&]() {
+                    // Signed: a record can be popped before its push is counted
+                    ptrdiff_t backlog = static_cast<ptrdiff_t>(pushed_.load(memory_order_acquire) - popped);
+                    return stopping_ || flushRequested_ || reconfigure_ ||
+                           backlog >= static_cast<ptrdiff_t>(RecordRing::kCapacity / 2);
+                });
+                writerIdle_.store(false, memory_order_release);
+                stop = stopping_;
+                flushNow = flushRequested_;
+                flushRequested_ = false;
+                if (reconfigure_) {
+                    // Records written to the old file are synced before it is closed
+                    if (fd >= 0 && unsyncedRecords > 0) {
+                        if (!syncLogFile(fd)) lostThrough_ = popped;
+                        durable_ = popped;
+                        unsyncedRecords = 0;
+                    }
+                    if (fd >= 0) closeLogFile(fd);
+                    fd = -1;
+                    options = pendingOptions_;
+                    reconfigure_ = false;
+                }
+            }
+
+            size_t records = 0;
+            batch.clear();
+            while (ring_.tryPopInto(batch)) ++records;
+            if (records > 0) {
+                if (fd < 0) fd = openLogFile(options.path);
+                bool ok = fd >= 0 && writeLogFile(fd, batch);
+                if (fd < 0) cerr << "Error: Could not open log file." << endl;
+                else if (!ok) cerr << "Error: Could not write to log file." << endl;
+                popped += records;
+                if (ok) {
+                    unsyncedRecords += records;
+                } else {
+                    // The records written before this batch still get their sync
+                    if (fd >= 0 && unsyncedRecords > 0) syncLogFile(fd);
+                    unsyncedRecords = 0;
+                    settle(true);
+                }
+            }
+
+            bool syncNow = unsyncedRecords > 0 && fd >= 0 &&
+                           (flushNow || stop ||
+                            (options.syncEveryRecords > 0 && unsyncedRecords >= options.syncEveryRecords) ||
+                            (options.syncEveryMs > 0 &&
+                             Clock::now() - lastSync >= chrono::milliseconds(options.syncEveryMs)));
+            if (syncNow) {
+                bool synced = syncLogFile(fd);
+                if (!synced) cerr << "Error: Could not sync log file." << endl;
+                unsyncedRecords = 0;
+                lastSync = Clock::now();
+                settle(!synced);
+            }
+            flushed_.notify_all();
+            if (stop && records == 0) break;
+        }
+        if (fd >= 0) closeLogFile(fd);
+    }
+
+    RecordRing ring_;
+    atomic<size_t> pushed_{0};
+    atomic<bool> writerIdle_{false};
+    mutex mutex_;
+    condition_variable wake_;
+    condition_variable flushed_;
+    size_t durable_ = 0;        // records synced to disk or lost, in push order
+    size_t lostThrough_ = 0;    // durable_ when the last record was lost (0 = none)
+    size_t flushedThrough_ = 0; // highest target a flush() has waited for
+    bool stopping_ = false;
+    bool flushRequested_ = false;
+    bool reconfigure_ = false;
+    LoggerOptions pendingOptions_;
+    thread writer_;
+};
+
+// Created on first use; its destructor drains and syncs the queue when the program exits
+AsyncLogger& logger() {
+    static AsyncLogger instance;
+    return instance;
+}
+
+// Same timestamp layout as ctime(), without its shared static buffer
+string logTimestamp() {
     time_t now = time(0);
-    char* dt = ctime(&now);
-    // Remove newline from ctime
-    string timeStr(dt);
-    if (!timeStr.empty() && timeStr[timeStr.length()-1] == '\n')
-        timeStr.erase(timeStr.length()-1);
-    logFile << "[" << timeStr << "] " << message << endl;
-    logFile.close();
+    tm local;
+#ifdef _WIN32
+    localtime_s(&local, &now);
+#else
+    localtime_r(&now, &local);
+#endif
+    char timeStr[32];
+    strftime(timeStr, sizeof(timeStr), "%a %b %d %H:%M:%S %Y", &local);
+    return timeStr;
+}
+
+} // namespace
+
+// Logs a change message to a log file with a timestamp. The record is formatted here and
+// queued; the background writer appends it to the file.
+void logChange(const string& message) {
+    string timeStr = logTimestamp();
+    string record;
+    record.reserve(message.size() + 32);
+    record += '[';
+    record += timeStr;
+    record += "] ";
+    record += message;
+    record += '\n';
+    logger().push(std::move(record));
+}
+
+// Logs every message as its own line, all in one queued record
+void logChanges(const vector<string>& messages) {
+    if (messages.empty()) return;
+    string prefix = "[" + logTimestamp() + "] ";
+    size_t size = 0;
+    for (const string& message : messages) size += prefix.size() + message.size() + 1;
+    string record;
+    record.reserve(size);
+    for (const string& message : messages) {
+        record += prefix;
+        record += message;
+        record += '\n';
+    }
+    logger().push(std::move(record));
+}
+
+// Applies logger options. Records already queued are written to the previous file first.
+void configureLogger(const LoggerOptions& options) {
+    logger().configure(options);
+}
+
+// Blocks until every record logged so far is written and synced to disk, or lost. Returns
+// false if a record logged since the previous flush was lost.
+bool flushLog() {
+    return logger().flush();
 }
@@ -1,5 +1,26 @@
 #pragma once
+#include <cstddef>
 #include <string>
+#include <vector>
 
 // Logs a change message to a log file
 void logChange(const std::string& message);
+// Logs a set of messages under one timestamp as a single record, so they reach the file
+// together in one write, never interleaved with records from other threads
+void logChanges(const std::vector<std::string>& messages);
+
+// Durability settings for the background log writer
+struct LoggerOptions {
+    std::string path = "log.txt";
+    size_t syncEveryRecords = 0;   // fsync after this many records (0 = never)
+    unsigned syncEveryMs = 0;      // fsync once this much time passed since the last sync (0 = never)
+    unsigned flushIntervalMs = 50; // longest time a record waits in the buffer
+};
+
+// Applies logger options. Records already queued are written to the previous file first.
+void configureLogger(const LoggerOptions& options);
+
+// Blocks until every record logged so far is written and synced to disk, or given up on
+// because the log file could not be opened, written or synced. Returns false if any record
+// logged since the previous flush was lost that way.
+bool flushLog();
@@ -4,9 +4,18 @@
 #include <cstdlib>
 #include <filesystem>
 #include <algorithm>
-#include <windows.h>
 #include "file_handler.h"
 #include "operations.h"
+#include "price_cleanup.h"
+#include "profiler.h"
+#include "logger.h"
+#include "sheet_import.h"
+#include "snapshot.h"
+#include "console.h"
+#include "batch_mode.h"
+#include "bulk_update.h"
+#include "thread_pool.h"
+#include "xlsx_writer.h"
 #include <chrono>
 #include <thread>
 
@@ -35,55 +44,47 @@ using namespace std;
 } */
 
 
-// Function to check if file is HTML or Excel
-bool isConvertibleFile(const string& filePath) {
-    string lowerPath = filePath;
-    transform(lowerPath.begin(), lowerPath.end(), lowerPath.begin(), ::tolower);
-    return lowerPath.find(".html") != string::npos ||
-           lowerPath.find(".htm") != string::npos ||
-           lowerPath.find(".xlsx") != string::npos ||
-           lowerPath.find(".xls") != string::npos;
-}
-
-// Function to convert HTML/Excel to CSV using Python script
-bool convertFileToCsv(const string& inputPath, const string& csvPath) {
-    cout << "Attempting to convert: " << inputPath << " to " << csvPath << endl;
-
-    // Try different Python commands
-    vector<string> pythonCommands = {
-        "python html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\"",
-        "python3 html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\"",
-        "py html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\"",
-        "C:\\Python39\\python.exe html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\"",
-        "C:\\Python310\\python.exe html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\"",
-        "C:\\Python311\\python.exe html_to_csv_converter.py --single-file \"" + inputPath + "\" \"" + csvPath + "\""
-    };
+// Reports a sheet read by readSheet. An imported sheet switches its path to the .csv next
+// to it, which is where it is saved; a failed import asks whether to read the file as CSV.
+bool finishLoad(string& path, SheetData& sheet, const string& sheetName, bool loaded) {
+    if (!isConvertibleFile(path)) return loaded;
 
-    for (const string& command : pythonCommands) {
-        cout << "Trying command: " << command << endl;
-        int result = system(command.c_str());
-        cout << "Command result: " << result << endl;
-        if (result == 0) {
-            cout << "✓ Conversion successful!" << endl;
-            return true;
-        }
+    if (loaded) {
+        path = csvPathFor(path);
+        cout << "✓ " << sheetName << " imported (" << sheet.size() << " rows), will be saved to: " << path << endl;
+        return true;
     }
-
-    cout << "✗ All Python commands failed. Please ensure Python and required libraries are installed:" << endl;
-    cout << "  pip install pandas openpyxl" << endl;
-    return false;
+    cout << "✗ Failed to import " << sheetName << endl;
+    cout << "Do you want to continue with the original file? (y/n): ";
+    char choice;
+    cin >> choice;
+    cin.ignore();
+    if (choice != 'y' && choice != 'Y') {
+        return false;
+    }
+    return readCSV(path, sheet);
 }
 
 void Delay(int t) {
     this_thread::sleep_for(chrono::milliseconds(t));
 }
 
-int main() {
+int main(int argc, char* argv[]) {
 
     // Set console to UTF-8 for proper Arabic text display
-    SetConsoleOutputCP(CP_UTF8);
-    SetConsoleCP(CP_UTF8);
+    setupConsoleUtf8();
 
+    // Any arguments mean a scripted run (e.g. "sync --ops ..."): no menu, prompts or delays
+    if (argc > 1) {
+        return runBatchCommand(argc, argv);
+    }
+
+    // PHARMACY_PROFILE=<trace file> times the session; the report is written on exit (option 8)
+    const char* profilePath = getenv("PHARMACY_PROFILE");
+    if (profilePath != nullptr && *profilePath != '\0') enableProfiling(true);
+    // PHARMACY_SNAPSHOT_DIR=<dir> keeps snapshots of the sheets there (see snapshot.h)
+    const char* snapshotDir = getenv("PHARMACY_SNAPSHOT_DIR");
+    if (snapshotDir != nullptr) setSnapshotDirectory(snapshotDir);
 
     cout << GREEN <<"******************************************************************" << RESET << endl;
     Delay(200);
@@ -109,77 +110,39 @@ int main() {
     getline(cin, appPath);
     //stockPath = stripQuotes(appPath);
 
-    // Check if stock and price files are HTML/Excel and convert them
-    if (isConvertibleFile(stockPath)) {
-        cout << "Detected convertible file for Stock Sheet. Converting to CSV..." << endl;
-        string stockCsvPath = stockPath.substr(0, stockPath.find_last_of('.')) + ".csv";
-        if (convertFileToCsv(stockPath, stockCsvPath)) {
-            cout << "✓ Stock Sheet converted to: " << stockCsvPath << endl;
-            stockPath = stockCsvPath;
-        } else {
-            cout << "✗ Failed to convert Stock Sheet to CSV" << endl;
-            cout << "Do you want to continue with the original file? (y/n): ";
-            char choice;
-            cin >> choice;
-            if (choice != 'y' && choice != 'Y') {
-                return 1;
-            }
-        }
-    }
-
-    if (isConvertibleFile(pricePath)) {
-        cout << "Detected convertible file for Price Sheet. Converting to CSV..." << endl;
-        string priceCsvPath = pricePath.substr(0, pricePath.find_last_of('.')) + ".csv";
-        if (convertFileToCsv(pricePath, priceCsvPath)) {
-            cout << "✓ Price Sheet converted to: " << priceCsvPath << endl;
-            pricePath = priceCsvPath;
-        } else {
-            cout << "✗ Failed to convert Price Sheet to CSV" << endl;
-            cout << "Do you want to continue with the original file? (y/n): ";
-            char choice;
-            cin >> choice;
-            if (choice != 'y' && choice != 'Y') {
-                return 1;
-            }
-        }
+    SheetData stockSheet, priceSheet, appSheet;
+    // Read the three sheets at the same time; results and prompts are then handled in order
+    string* paths[] = {&stockPath, &pricePath, &appPath};
+    SheetData* sheets[] = {&stockSheet, &priceSheet, &appSheet};
+    const char* names[] = {"Stock Sheet", "Price Sheet", "App Sheet"};
+    bool loaded[3] = {false, false, false};
+    for (int i = 0; i < 3; ++i) {
+        if (isConvertibleFile(*paths[i])) cout << "Detected convertible file for " << names[i] << ". Importing..." << endl;
     }
-
-    if (isConvertibleFile(appPath)) {
-        cout << "Detected convertible file for App Sheet. Converting to CSV..." << endl;
-        string appCsvPath = appPath.substr(0, appPath.find_last_of('.')) + ".csv";
-        if (convertFileToCsv(appPath, appCsvPath)) {
-            cout << "✓ App Sheet converted to: " << appCsvPath << endl;
-            appPath = appCsvPath;
-        } else {
-            cout << "✗ Failed to convert App Sheet to CSV" << endl;
-            cout << "Do you want to continue with the original file? (y/n): ";
-            char choice;
-            cin >> choice;
-            if (choice != 'y' && choice != 'Y') {
-                return 1;
-            }
+    ThreadPool::shared().parallelFor(3, [&](size_t i) { loaded[i] = readSheet(*paths[i], *sheets[i]); });
+    for (int i = 0; i < 3; ++i) {
+        if (!finishLoad(*paths[i], *sheets[i], names[i], loaded[i])) {
+            cout << RED << "Failed to load " << names[i] << ". Exiting.\n" << RESET;
+            return 1;
         }
     }
 
 
-    SheetData stockSheet, priceSheet, appSheet;
-    if (!readCSV(stockPath, stockSheet)) {
-        cout << RED << "Failed to load Stock Sheet. Exiting.\n";
-        return 1;
-    }
-    if (!readCSV(pricePath, priceSheet)) {
-        cout << "Failed to load Price Sheet. Exiting.\n";
-        return 1;
-    }
-    if (!readCSV(appPath, appSheet)) {
-        cout << "Failed to load App Sheet. Exiting.\n" << RESET;
-        return 1;
-    }
-
+    // Normalized code columns of each sheet, built on first lookup and kept across options
+    SheetKeys stockKeys, priceKeys, appKeys;
+    // Stock and price updates since the last sync, so option 5 can re-apply just those codes
+    SyncChangeSet syncChanges;
+    syncChanges.stockKeys = &stockKeys;
+    syncChanges.priceKeys = &priceKeys;
+    syncChanges.appKeys = &appKeys;
+    // Code and name search over all three sheets, rebuilt after options that move rows or
+    // rewrite codes and names
+    ProductSearch productSearch;
+    productSearch.build(stockSheet, priceSheet, appSheet);
 
     while (true) {
         cout << YELLOW << "\n--- Pharmacy Product Data Management System ---\n" << RESET;
-        cout << "1. Search for a product by code\n";
+        cout << "1. Search for a product (code, code prefix or name)\n";
         cout << "2. Update stock in Stock Sheet\n";
         cout << "3. Update price in Price Sheet\n";
         cout << "4. Add a new product\n";
@@ -187,7 +150,7 @@ int main() {
         cout << "6. Sort App Sheet by sku & Remove rows with multiple numbers in SKU in App Sheet\n";
         cout << "7. Export App Sheet\n";
         cout << "8. Save All Sheets and Exit\n";
-        cout << "9. Convert App Sheet CSV to XLSX\n";
+        cout << "9. Export App Sheet to XLSX\n";
         cout << "10. Delete first 10 rows from Price Sheet\n";
         cout << "11. Unmerge columns I & J in Price Sheet\n";
         cout << "12. Move P column (الكود) to H column in Price Sheet\n";
@@ -195,28 +158,19 @@ int main() {
         cout << "14. Delete first 6 columns from Price Sheet\n";
         cout << "15. Set home nursing services stock to 9000000 in App Sheet\n";
         cout << "16. Convert all nan values to 0 in App Sheet\n";
+        cout << "17. Clean Price Sheet (options 10-14 in one pass)\n";
+        cout << "18. Bulk update stock or price from a CSV file (code,value lines)\n";
         cout << "Select an option: ";
         int choice;
         cin >> choice;
         cin.ignore();
         switch (choice) {
             case 1: {
-                cout << "Search in which sheet? (1=Stock, 2=Price, 3=App): ";
-                int searchSheet;
-                cin >> searchSheet;
-                cin.ignore();
-                string code;
-                cout << "Enter product code: ";
-                getline(cin, code);
-                if (searchSheet == 1) {
-                    searchProduct(code, stockSheet, SheetData(), SheetData());
-                } else if (searchSheet == 2) {
-                    searchProduct(code, SheetData(), priceSheet, SheetData());
-                } else if (searchSheet == 3) {
-                    searchProduct(code, SheetData(), SheetData(), appSheet);
-                } else {
-                    cout << "Invalid sheet choice.\n";
-                }
+                string query;
+                cout << "Enter product code, code prefix or name: ";
+                getline(cin, query);
+                if (!productSearch.ready()) productSearch.build(stockSheet, priceSheet, appSheet);
+                searchProducts(productSearch, query, stockSheet, priceSheet, appSheet);
                 break;
             }
             case 2: {
@@ -227,7 +181,7 @@ int main() {
                 cout << "Enter new stock amount: ";
                 cin >> newStock;
                 cin.ignore();
-                updateStock(stockSheet, code, newStock);
+                updateStock(stockSheet, stockKeys.index(stockSheet, 0), code, newStock, &syncChanges);
                 break;
             }
             case 3: {
@@ -238,7 +192,7 @@ int main() {
                 cout << "Enter new price: ";
                 cin >> newPrice;
                 cin.ignore();
-                updatePrice(priceSheet, code, newPrice);
+                updatePrice(priceSheet, priceKeys.index(priceSheet, 14), code, newPrice, &syncChanges);
                 break;
             }
             case 4: {
@@ -272,34 +226,14 @@ int main() {
                 break;
             }
             case 5:
-                syncAppSheet(appSheet, stockSheet, priceSheet);
+                syncAppSheet(appSheet, stockSheet, priceSheet, syncChanges);
                 break;
-            case 6:{
-                // Sort App Sheet in-place using Python (Excel/WPS style)
-                string inOut = appPath;
-                vector<string> pythonSortCmds = {
-                    "python sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku",
-                    "python3 sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku",
-                    "py sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku",
-                    "C:\\Python39\\python.exe sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku",
-                    "C:\\Python310\\python.exe sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku",
-                    "C:\\Python311\\python.exe sort_csv_by_column.py \"" + inOut + "\" \"" + inOut + "\" sku"
-                };
-                bool success = false;
-                for (const string& cmd : pythonSortCmds) {
-                    cout << "Trying command: " << cmd << endl;
-                    int result = system(cmd.c_str());
-                    if (result == 0 && readCSV(inOut, appSheet)) {
-                        cout << "App Sheet sorted by SKU (ascending === numerically === with deleting The Offer Rows)...\n";
-                        success = true;
-                        break;
-                    }
-                }
-                if (!success) {
-                    cout << "Sorting failed or could not reload sorted App Sheet.\n";
-                }
+            case 6:
+                // Filter and sort the loaded App Sheet in-process (same rules as sort_csv_by_column.py)
+                removeRowsWithSkuContainingMultipleNumbers(appSheet);
+                sortAppSheet(appSheet);
+                appKeys.invalidate();
                 break;
-            }
             case 7: {
                 string outApp;
                 cout << "Enter export path for App Sheet: ";
@@ -308,60 +242,90 @@ int main() {
                 break;
             }
             case 8:
-                // Save all sheets to their original files
-                writeCSV(stockPath, stockSheet);
-                writeCSV(pricePath, priceSheet);
-                writeCSV(appPath, appSheet);
+                // Save all sheets to their original files, all three at once. Each file is
+                // replaced atomically, so a failed save leaves the previous version in place.
+                if (!writeCSVs({{stockPath, &stockSheet}, {pricePath, &priceSheet}, {appPath, &appSheet}})) {
+                    cout << RED << "✗ One or more sheets could not be saved (see above). The previous files were kept.\n" << RESET;
+                    break;
+                }
                 cout << "All sheets saved. Exiting.\n";
+                flushLog();
+                if (profilingEnabled()) {
+                    printProfileSummary(cout);
+                    if (writeProfileTrace(profilePath)) cout << "Profile trace written to " << profilePath << "\n";
+                }
                 return 0;
             case 9: {
-                // Convert the latest App Sheet CSV (could be the synced one) to XLSX
+                // Export the in-memory App Sheet (including unsaved changes) as XLSX next to its CSV
                 string appXlsxPath = appPath.substr(0, appPath.find_last_of('.')) + ".xlsx";
-                vector<string> pythonCommands = {
-                    "python html_to_csv_converter.py --csv-to-xlsx \"" + appPath + "\" \"" + appXlsxPath + "\"",
-                    "python3 html_to_csv_converter.py --csv-to-xlsx \"" + appPath + "\" \"" + appXlsxPath + "\"",
-                    "py html_to_csv_converter.py --csv-to-xlsx \"" + appPath + "\" \"" + appXlsxPath + "\""
-                };
-                bool converted = false;
-                for (const string& cmd : pythonCommands) {
-                    cout << "Trying command: " << cmd << endl;
-                    int result = system(cmd.c_str());
-                    if (result == 0) {
-                        cout << "✓ App Sheet reconverted to: " << appXlsxPath << endl;
-                        converted = true;
-                        break;
-                    }
-                }
-                if (!converted) {
-                    cout << "✗ Failed to reconvert App Sheet to XLSX" << endl;
+                if (writeXlsx(appXlsxPath, appSheet)) {
+                    cout << "✓ App Sheet exported to: " << appXlsxPath << endl;
+                } else {
+                    cout << "✗ Failed to export App Sheet to XLSX" << endl;
                 }
                 break;
             }
             case 10:
-                deleteFirstNRowsFromPriceSheet(priceSheet, 10);
+                deleteFirstNRowsFromPriceSheet(priceSheet, 10, &priceKeys);
                 break;
             case 11:
-                unmergeIJColumnsInPriceSheet(priceSheet);
+                unmergeIJColumnsInPriceSheet(priceSheet, &priceKeys);
                 break;
             case 12:
-                movePColumnToHInPriceSheet(priceSheet);
+                movePColumnToHInPriceSheet(priceSheet, &priceKeys);
                 break;
             case 13:
-                deleteRepeatedPriceColumn(priceSheet);
+                deleteRepeatedPriceColumn(priceSheet, &priceKeys);
                 break;
             case 14:
-                deleteFirstSixColumns(priceSheet);
+                deleteFirstSixColumns(priceSheet, &priceKeys);
                 break;
             case 15:
                 setHomeNursingStockTo9000000(appSheet);
+                appKeys.columnChanged(27);
                 break;
             case 16:
-                convertNanToZero(appSheet);
+                convertNanToZero(appSheet); // can rewrite codes ("nan" -> "0")
+                appKeys.invalidate();
+                break;
+            case 17:
+                PriceCleanupPlan::menuSequence().apply(priceSheet);
+                priceKeys.invalidate();
                 break;
+            case 18: {
+                cout << "Update which sheet? (1=Stock, 2=Price): ";
+                int sheetChoice;
+                cin >> sheetChoice;
+                cin.ignore();
+                if (sheetChoice != 1 && sheetChoice != 2) {
+                    cout << "Invalid sheet choice.\n";
+                    break;
+                }
+                string path;
+                cout << "Enter path of the code,value CSV file: ";
+                getline(cin, path);
+                vector<BulkUpdate> updates;
+                if (!readBulkUpdates(path, updates)) {
+                    cout << "✗ Failed to read " << path << endl;
+                    break;
+                }
+                BulkTarget target = sheetChoice == 1 ? BulkTarget::Stock : BulkTarget::Price;
+                BulkUpdateReport report = sheetChoice == 1
+                    ? applyBulkUpdates(stockSheet, stockKeys.index(stockSheet, 0), target, updates, &syncChanges)
+                    : applyBulkUpdates(priceSheet, priceKeys.index(priceSheet, 14), target, updates, &syncChanges);
+                printBulkUpdateReport(report, target);
+                break;
+            }
             default:
                 cout << "Invalid option. Try again.\n";
                 break;
         }
+        // Every other option edits the sheets without tracking codes (rows added, sorted or
+        // cleaned), so the next sync has to be a full one
+        bool tracked = choice == 1 || choice == 2 || choice == 3 || choice == 5 || choice == 7 || choice == 8 || choice == 9 ||
+                       choice == 18;
+        if (!tracked) syncChanges.invalidate();
+        if (!tracked && choice != 15) productSearch.invalidate();
     }
     return 0;
 }
@@ -0,0 +1,41 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Whether a file can be replaced (renamed over) while it is mapped. Windows refuses
+// (ERROR_USER_MAPPED_FILE), so a sheet there copies its cells out of the file it was read
+// from instead of keeping it mapped: saving renames the new file over that one.
+#ifdef _WIN32
+const bool kReplaceableWhileMapped = false;
+#else
+const bool kReplaceableWhileMapped = true;
+#endif
+
+// Read-only memory mapping of a whole file. The bytes stay resident for the
+// lifetime of the object so callers can hand out views into them.
+class MappedFile {
+public:
+    MappedFile() {}
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Maps the file at path. Returns true if successful.
+    bool open(const std::string& path);
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool isOpen() const { return open_; }
+
+private:
+    const char* data_ = nullptr;
+    size_t size_ = 0;
+    bool open_ = false;
+#ifdef _WIN32
+    void* fileHandle_ = nullptr;
+    void* mappingHandle_ = nullptr;
+#endif
+};
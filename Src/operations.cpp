@@ -1,11 +1,15 @@
 #include "operations.h"
 #include "file_handler.h"
 #include "logger.h"
+#include "profiler.h"
+#include "row_rules.h"
+#include "text_utils.h"
+#include "thread_pool.h"
 #include <iostream>
 #include <algorithm>
 #include <cctype>
-#include <regex>
-#include <limits>
+#include <cmath>
+#include <cstdlib>
 using namespace std;
 
 #pragma once
@@ -15,29 +19,27 @@ using namespace std;
 #include <algorithm>
 
 using namespace std;
-using SheetData = vector<vector<string>>;
 
 // Utility to trim whitespace and hidden characters from strings
+// (a copy; comparisons use trimView from text_utils.h, which does not allocate)
 string trim(const string& str) {
-    const char* ws = " \t\n\r\f\v";
-    size_t start = str.find_first_not_of(ws);
-    size_t end = str.find_last_not_of(ws);
-    return (start == string::npos) ? "" : str.substr(start, end - start + 1);
+    return string(trimView(str));
 }
 
 // Find a column by header name in first row
 int findColumnByName(const SheetData& sheet, const string& headerName) {
     if (sheet.empty()) return -1;
     for (size_t i = 0; i < sheet[0].size(); ++i) {
-        if (trim(sheet[0][i]) == trim(headerName)) return static_cast<int>(i);
+        if (trimView(sheet[0][i]) == trimView(headerName)) return static_cast<int>(i);
     }
     return -1;
 }
 
 // Find a row by exact code match in a given column
 int findRowByCode(const SheetData& sheet, const string& code, int codeCol = 0) {
+    string_view wanted = trimView(code);
     for (size_t i = 0; i < sheet.size(); ++i) {
-        if (sheet[i].size() > codeCol && trim(sheet[i][codeCol]) == trim(code))
+        if (sheet[i].size() > codeCol && trimView(sheet[i][codeCol]) == wanted)
             return static_cast<int>(i);
     }
     return -1;
@@ -45,6 +47,7 @@ int findRowByCode(const SheetData& sheet, const string& code, int codeCol = 0) {
 
 // Helper: Normalize all rows to the header length
 void normalizeAppSheetRowsToHeader(SheetData& appSheet) {
+    PROFILE_SCOPE("normalizeAppSheetRowsToHeader");
     if (appSheet.empty()) return;
     size_t headerLen = appSheet[0].size();
     for (size_t i = 1; i < appSheet.size(); ++i) {
@@ -58,12 +61,19 @@ void normalizeAppSheetRowsToHeader(SheetData& appSheet) {
 
 // Search for a product in all sheets using integer indices
 void searchProduct(const string& code, const SheetData& stockSheet, const SheetData& priceSheet, const SheetData& appSheet) {
+    searchProduct(code, stockSheet, SheetIndex(stockSheet, 0), priceSheet, SheetIndex(priceSheet, 15),
+                  appSheet, SheetIndex(appSheet, 8));
+}
+
+// Search for a product in all sheets through prebuilt code indexes
+void searchProduct(const string& code, const SheetData& stockSheet, const SheetIndex& stockIndex,
+                   const SheetData& priceSheet, const SheetIndex& priceIndex,
+                   const SheetData& appSheet, const SheetIndex& appIndex) {
     cout << "\n--- Search Results for code: " << code << " ---\n";
 
     if (!stockSheet.empty()) {
-        int codeCol = 0; // code column in stockSheet
         int totalCol = 21; // total column in stockSheet
-        int rowIdx = findRowByCode(stockSheet, code, codeCol);
+        int rowIdx = stockIndex.find(code);
 
         if (rowIdx != -1 && totalCol < (int)stockSheet[rowIdx].size()) {
             cout << "Stock Sheet: Row " << rowIdx << "\n";
@@ -75,9 +85,8 @@ void searchProduct(const string& code, const SheetData& stockSheet, const SheetD
     }
 
     if (!priceSheet.empty()) {
-        int codeCol = 15; // الكود column in priceSheet
         int priceCol = 8; // السعر column in priceSheet
-        int rowIdx = findRowByCode(priceSheet, code, codeCol);
+        int rowIdx = priceIndex.find(code);
 
         if (rowIdx != -1 && priceCol < (int)priceSheet[rowIdx].size()) {
             cout << "Price Sheet: Row " << rowIdx << "\n";
@@ -89,10 +98,9 @@ void searchProduct(const string& code, const SheetData& stockSheet, const SheetD
     }
 
     if (!appSheet.empty()) {
-        int skuCol = 8; // sku column in appSheet
         int priceCol = 9; // price column in appSheet
         int stockCol = 27; // stock column in appSheet
-        int rowIdx = findRowByCode(appSheet, code, skuCol);
+        int rowIdx = appIndex.find(code);
 
         if (rowIdx != -1 && priceCol < (int)appSheet[rowIdx].size() && stockCol < (int)appSheet[rowIdx].size()) {
             cout << "App Sheet: Row " << rowIdx << "\n";
@@ -104,14 +112,57 @@ void searchProduct(const string& code, const SheetData& stockSheet, const SheetD
     }
 }
 
+// Cell of a row, or "" if the row is shorter
+static const SheetCell& cellOrEmpty(const SheetRow& row, int col) {
+    static const SheetCell empty;
+    return col < (int)row.size() ? row[col] : empty;
+}
+
+// Print the ranked hits of a product search, one line per row found
+void searchProducts(const ProductSearch& search, const string& query, const SheetData& stockSheet,
+                    const SheetData& priceSheet, const SheetData& appSheet, size_t limit) {
+    PROFILE_SCOPE("searchProducts");
+    vector<SearchHit> hits = search.search(query, limit);
+    cout << "\n--- Search Results for: " << query << " ---\n";
+    if (hits.empty()) {
+        cout << "No products found.\n";
+        return;
+    }
+    for (const SearchHit& hit : hits) {
+        string match = hit.kind == SearchHit::ExactCode ? "code" : hit.kind == SearchHit::CodePrefix ? "code prefix"
+                       : "name " + to_string(hit.similarity / 10) + "%";
+        if (hit.sheet == SearchSheet::Stock) {
+            const SheetRow& row = stockSheet[hit.row];
+            cout << "Stock Sheet: Row " << hit.row << " (" << match << ") " << cellOrEmpty(row, 0) << ", "
+                 << cellOrEmpty(row, 1) << ", Total = " << cellOrEmpty(row, 21) << "\n";
+        } else if (hit.sheet == SearchSheet::Price) {
+            const SheetRow& row = priceSheet[hit.row];
+            cout << "Price Sheet: Row " << hit.row << " (" << match << ") " << cellOrEmpty(row, 15) << ", "
+                 << cellOrEmpty(row, 1) << ", Price = " << cellOrEmpty(row, 8) << "\n";
+        } else {
+            const SheetRow& row = appSheet[hit.row];
+            cout << "App Sheet: Row " << hit.row << " (" << match << ") " << cellOrEmpty(row, 8) << ", "
+                 << cellOrEmpty(row, 1) << ", Price = " << cellOrEmpty(row, 9) << ", Stock = " << cellOrEmpty(row, 27) << "\n";
+        }
+    }
+    if (hits.size() == limit) cout << "(first " << limit << " results shown)\n";
+}
+
 // Update stock in stock sheet using your specified index
-void updateStock(SheetData& stockSheet, const string& code, int newStock) {
-    int codeCol = 0; // code column
+void updateStock(SheetData& stockSheet, const string& code, int newStock, SyncChangeSet* changes) {
+    updateStock(stockSheet, SheetIndex(stockSheet, 0), code, newStock, changes);
+}
+
+// Update stock in stock sheet through a prebuilt code index (code column 0)
+void updateStock(SheetData& stockSheet, const SheetIndex& stockIndex, const string& code, int newStock,
+                 SyncChangeSet* changes) {
+    PROFILE_SCOPE("updateStock");
     int totalCol = 21; // total column
-    int idx = findRowByCode(stockSheet, code, codeCol);
+    int idx = stockIndex.find(code);
     if (idx != -1 && totalCol < (int)stockSheet[idx].size()) {
         stockSheet[idx][totalCol] = to_string(newStock);
         logChange("Stock updated for code " + code + ": new stock = " + to_string(newStock));
+        if (changes) changes->markStock(trim(code));
         cout << "Stock updated.\n";
     } else {
         cout << "Product not found in stock sheet.\n";
@@ -119,13 +170,20 @@ void updateStock(SheetData& stockSheet, const string& code, int newStock) {
 }
 
 // Update price in price sheet using integer indices
-void updatePrice(SheetData& priceSheet, const string& code, double newPrice) {
-    int codeCol = 14; // الكود column
+void updatePrice(SheetData& priceSheet, const string& code, double newPrice, SyncChangeSet* changes) {
+    updatePrice(priceSheet, SheetIndex(priceSheet, 14), code, newPrice, changes);
+}
+
+// Update price in price sheet through a prebuilt code index (الكود column 14)
+void updatePrice(SheetData& priceSheet, const SheetIndex& priceIndex, const string& code, double newPrice,
+                 SyncChangeSet* changes) {
+    PROFILE_SCOPE("updatePrice");
     int priceCol = 8; // السعر column
-    int idx = findRowByCode(priceSheet, code, codeCol);
+    int idx = priceIndex.find(code);
     if (idx != -1 && priceCol < (int)priceSheet[idx].size()) {
         priceSheet[idx][priceCol] = to_string(newPrice);
         logChange("Price updated for الكود " + code + ": new السعر = " + to_string(newPrice));
+        if (changes) changes->markPrice(trim(code));
         cout << "Price updated.\n";
     } else {
         cout << "Product not found in price sheet.\n";
@@ -139,114 +197,411 @@ void addProduct(SheetData& sheet, const vector<string>& productRow) {
     cout << "Product added.\n";
 }
 
+// Column layout of the sync (fixed positions, see syncAppSheet)
+static const int kPriceCodeCol = 14;  // الكود column in pricesheet
+static const int kPriceValueCol = 8;  // السعر column in pricesheet
+static const int kStockCodeCol = 0;   // code column in stockSheet
+static const int kStockTotalCol = 21; // total column in stockSheet
+static const int kAppSkuCol = 8;      // sku column in appSheet
+static const int kAppPriceCol = 9;    // price column in appSheet
+static const int kAppMaxStockCol = 25; // max stock column in appSheet
+static const int kAppStockCol = 27;   // stock column in appSheet
+
+// Keyword rules over App Sheet rows (see RowRules). A rule set reads each cell once however
+// many rules it holds, so a new category rule is one more add() here, not another pass.
+static const RowRules& homeNursingRules() {
+    static const RowRules rules = []() {
+        RowRules set;
+        set.add({"home nursing services", -1, kAppStockCol, "9000000"}); // any cell, any case
+        return set;
+    }();
+    return rules;
+}
+
+// Rows whose sku holds #S#R (exact case), the only ones setMaxStockForSRProducts can match
+static const RowRules& srSkuRules() {
+    static const RowRules rules = []() {
+        RowRules set;
+        set.add({"#S#R", kAppSkuCol, kAppMaxStockCol, "1", true});
+        return set;
+    }();
+    return rules;
+}
+
+// VLOOKUP of a sku in a lookup sheet: the trimmed value the App Sheet cell holding current
+// should get, or an empty view if the sku is not there, its value is empty or the cell
+// already holds it
+static string_view lookedUpValue(const NormalizedKey& sku, const SheetData& sheet, const SheetIndex& index,
+                                 int valueCol, string_view current) {
+    int row = index.find(sku);
+    if (row == -1 || valueCol >= (int)sheet[row].size()) return string_view();
+    string_view value = trimView(sheet[row][valueCol]);
+    return value == current ? string_view() : value;
+}
+
+// VLOOKUP of one App Sheet row in the Price Sheet. Returns the number of cells updated.
+static int syncAppRowPrice(SheetRow& appRow, const NormalizedKey& sku, const SheetData& priceSheet,
+                           const SheetIndex& priceIndex) {
+    string_view newPrice = lookedUpValue(sku, priceSheet, priceIndex, kPriceValueCol, appRow[kAppPriceCol]);
+    if (newPrice.empty()) return 0;
+    appRow[kAppPriceCol].assign(newPrice.data(), newPrice.size());
+    return 1;
+}
+
+// VLOOKUP of one App Sheet row in the Stock Sheet. Returns the number of cells updated.
+static int syncAppRowStock(SheetRow& appRow, const NormalizedKey& sku, const SheetData& stockSheet,
+                           const SheetIndex& stockIndex) {
+    string_view newStock = lookedUpValue(sku, stockSheet, stockIndex, kStockTotalCol, appRow[kAppStockCol]);
+    if (newStock.empty()) return 0;
+    appRow[kAppStockCol].assign(newStock.data(), newStock.size());
+    return 1;
+}
+
+static void reportFullSync(int updatedCount, size_t rows) {
+    profileCount(ProfileCounter::RowsScanned, rows);
+    profileCount(ProfileCounter::CellsUpdated, updatedCount);
+    logChange("App Sheet synchronized using VLOOKUP from Stock and Price Sheets - " + to_string(updatedCount) + " cells updated.");
+    cout << "App Sheet synchronized. Updated " << updatedCount << " cells.\n";
+}
+
+// Full sync through prebuilt indexes of the Price and Stock Sheets. App rows are split
+// into fixed blocks that the pool's threads claim one at a time; a row's lookups only
+// write that row's price and stock cells, and the indexes are only read, so blocks never
+// share data. Each block counts its own updates and the counts are summed in block order
+// after the loop, so the result and messages match a serial run. The skus come from the
+// App Sheet's cached keys when appIndex is given and are normalized per row otherwise.
+static void syncAllAppRows(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet,
+                           const SheetIndex& stockIndex, const SheetIndex& priceIndex, const SheetIndex* appIndex,
+                           ThreadPool& pool) {
+    const size_t rowsPerBlock = 4096;
+    size_t blocks = (appSheet.size() + rowsPerBlock - 1) / rowsPerBlock;
+    vector<int> blockCounts(blocks, 0);
+    pool.parallelFor(blocks, [&](size_t block) {
+        PROFILE_SCOPE("syncAppSheet/block");
+        int updatedCount = 0;
+        NormalizedKey rowKey;
+        size_t end = min(appSheet.size(), (block + 1) * rowsPerBlock);
+        for (size_t i = max<size_t>(1, block * rowsPerBlock); i < end; ++i) { // skip header
+            if ((int)appSheet[i].size() <= max(kAppSkuCol, max(kAppPriceCol, kAppStockCol))) continue;
+            if (!appIndex) rowKey = NormalizedKey::of(appSheet[i][kAppSkuCol]);
+            const NormalizedKey& sku = appIndex ? appIndex->key(i) : rowKey;
+            if (sku.kind == NormalizedKey::Text && sku.text.empty()) continue;
+            updatedCount += syncAppRowPrice(appSheet[i], sku, priceSheet, priceIndex);
+            updatedCount += syncAppRowStock(appSheet[i], sku, stockSheet, stockIndex);
+        }
+        blockCounts[block] = updatedCount;
+    });
+    int updatedCount = 0;
+    for (int count : blockCounts) updatedCount += count;
+    reportFullSync(updatedCount, appSheet.size());
+    // Call the new function for #S#R products
+    setMaxStockForSRProducts(appSheet, stockSheet);
+}
+
 // Synchronize App Sheet with Stock and Price Sheets using VLOOKUP-like logic
-void syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet) {
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet) {
+    return syncAppSheet(appSheet, stockSheet, priceSheet, ThreadPool::shared());
+}
+
+// Same sync with the app rows spread over the given pool's threads
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet, ThreadPool& pool) {
+    PROFILE_SCOPE("syncAppSheet");
     if (appSheet.empty() || stockSheet.empty() || priceSheet.empty()) {
         cout << "Error: One or more sheets are empty. Cannot synchronize.\n";
-        return;
+        return false;
     }
 
-    // Find column indices dynamically
-    int priceCodeCol = 14; // الكود column in pricesheet
-    int priceValueCol = 8; // السعر column in pricesheet
-    int stockCodeCol = 0; // code column in stockSheet
-    int stockTotalCol = 21; // total column in stockSheet
-    int appSkuCol = 8; // sku column in appSheet
-    int appPriceCol = 9; // price column in appSheet
-    int appStockCol = 27; // stock column in appSheet
+    // Index both lookup sheets once so the join is O(N+M) instead of a scan per app row
+    syncAllAppRows(appSheet, stockSheet, priceSheet, SheetIndex(stockSheet, kStockCodeCol),
+                   SheetIndex(priceSheet, kPriceCodeCol), nullptr, pool);
+    return true;
+}
 
-    if (priceCodeCol == -1 || priceValueCol == -1) {
-        cout << "Error: Could not find الكود or السعر columns in Price Sheet.\n";
-        return;
+// The same sync over a columnar App Sheet: each row reads the sku column and compares with
+// the price and stock columns. Blocks of rows run on the pool but only collect the new
+// values (views into the lookup sheets); they are written after the loop, block by block,
+// as a column takes one writer at a time.
+bool syncAppSheet(Sheet& appSheet, const SheetData& stockSheet, const SheetData& priceSheet) {
+    PROFILE_SCOPE("syncAppSheet");
+    if (appSheet.empty() || stockSheet.empty() || priceSheet.empty()) {
+        cout << "Error: One or more sheets are empty. Cannot synchronize.\n";
+        return false;
     }
-
+    SheetIndex stockIndex(stockSheet, kStockCodeCol), priceIndex(priceSheet, kPriceCodeCol);
+    struct Update {
+        size_t row;
+        int col;
+        string_view value;
+    };
+    const size_t rowsPerBlock = 4096;
+    size_t lastCol = max(kAppSkuCol, max(kAppPriceCol, kAppStockCol));
+    size_t blocks = (appSheet.rowCount() + rowsPerBlock - 1) / rowsPerBlock;
+    vector<vector<Update>> blockUpdates(blocks);
+    ThreadPool::shared().parallelFor(blocks, [&](size_t block) {
+        PROFILE_SCOPE("syncAppSheet/block");
+        vector<Update>& updates = blockUpdates[block];
+        size_t end = min(appSheet.rowCount(), (block + 1) * rowsPerBlock);
+        for (size_t i = max<size_t>(1, block * rowsPerBlock); i < end; ++i) { // skip header
+            if (appSheet.rowWidth(i) <= lastCol) continue;
+            NormalizedKey sku = NormalizedKey::of(appSheet.text(i, kAppSkuCol));
+            if (sku.kind == NormalizedKey::Text && sku.text.empty()) continue;
+            string_view price = lookedUpValue(sku, priceSheet, priceIndex, kPriceValueCol, appSheet.text(i, kAppPriceCol));
+            if (!price.empty()) updates.push_back({i, kAppPriceCol, price});
+            string_view stock = lookedUpValue(sku, stockSheet, stockIndex, kStockTotalCol, appSheet.text(i, kAppStockCol));
+            if (!stock.empty()) updates.push_back({i, kAppStockCol, stock});
+        }
+    });
     int updatedCount = 0;
-    for (size_t i = 1; i < appSheet.size(); ++i) { // skip header
-        if (appSheet[i].size() <= max(appSkuCol, max(appPriceCol, appStockCol))) continue;
-        string sku = trim(appSheet[i][appSkuCol]);
-        if (sku.empty()) continue;
-
-        // VLOOKUP in Price Sheet
-        int priceRow = findRowByCode(priceSheet, sku, priceCodeCol);
-        if (priceRow != -1 && priceValueCol < (int)priceSheet[priceRow].size()) {
-            string newPrice = trim(priceSheet[priceRow][priceValueCol]);
-            if (!newPrice.empty() && newPrice != appSheet[i][appPriceCol]) {
-                appSheet[i][appPriceCol] = newPrice;
-                updatedCount++;
-            }
+    for (const vector<Update>& updates : blockUpdates) {
+        for (const Update& update : updates) appSheet.setText(update.row, update.col, update.value);
+        updatedCount += static_cast<int>(updates.size());
+    }
+    reportFullSync(updatedCount, appSheet.rowCount());
+    setMaxStockForSRProducts(appSheet, stockSheet);
+    return true;
+}
+
+void SyncChangeSet::invalidate() {
+    baseline = false;
+    stockCodes.clear();
+    priceCodes.clear();
+    stockIndex = SheetIndex();
+    priceIndex = SheetIndex();
+    appRows.clear();
+}
+
+// The sync's code indexes: the sheets' cached ones if the change set has the caches,
+// otherwise the ones it built for its baseline
+static const SheetIndex& stockLookup(SyncChangeSet& changes, const SheetData& stockSheet) {
+    return changes.stockKeys ? changes.stockKeys->index(stockSheet, kStockCodeCol) : changes.stockIndex;
+}
+static const SheetIndex& priceLookup(SyncChangeSet& changes, const SheetData& priceSheet) {
+    return changes.priceKeys ? changes.priceKeys->index(priceSheet, kPriceCodeCol) : changes.priceIndex;
+}
+
+// Incremental sync. After a full sync every App Sheet row holds the values its sku looks
+// up, and the tracked updates only change stock totals and prices (never codes or row
+// order), so only the rows whose sku was updated can differ from a full sync's result.
+// The #S#R rule depends on codes alone; it is re-applied to the changed #S#R codes.
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet,
+                  SyncChangeSet& changes) {
+    PROFILE_SCOPE("syncAppSheet/incremental");
+    if (!changes.baseline) {
+        if (appSheet.empty() || stockSheet.empty() || priceSheet.empty()) {
+            cout << "Error: One or more sheets are empty. Cannot synchronize.\n";
+            return false;
+        }
+        changes.invalidate();
+        if (!changes.stockKeys) changes.stockIndex = SheetIndex(stockSheet, kStockCodeCol);
+        if (!changes.priceKeys) changes.priceIndex = SheetIndex(priceSheet, kPriceCodeCol);
+        syncAllAppRows(appSheet, stockSheet, priceSheet, stockLookup(changes, stockSheet), priceLookup(changes, priceSheet),
+                       changes.appKeys ? &changes.appKeys->index(appSheet, kAppSkuCol) : nullptr, ThreadPool::shared());
+        for (size_t i = 1; i < appSheet.size(); ++i) {
+            if (appSheet[i].size() <= kAppSkuCol) continue;
+            string sku(trimView(appSheet[i][kAppSkuCol]));
+            if (!sku.empty()) changes.appRows[sku].push_back(static_cast<int>(i));
         }
+        changes.baseline = true;
+        return true;
+    }
 
-        // VLOOKUP in Stock Sheet
-        int stockRow = findRowByCode(stockSheet, sku, stockCodeCol);
-        if (stockRow != -1 && stockTotalCol < (int)stockSheet[stockRow].size()) {
-            string newStock = trim(stockSheet[stockRow][stockTotalCol]);
-            if (!newStock.empty() && newStock != appSheet[i][appStockCol]) {
-                appSheet[i][appStockCol] = newStock;
-                updatedCount++;
+    int updatedCount = 0, maxStockCount = 0;
+    size_t lastCol = max(kAppSkuCol, max(kAppPriceCol, kAppStockCol));
+    const SheetIndex& priceIndex = priceLookup(changes, priceSheet);
+    for (const string& code : changes.priceCodes) {
+        auto rows = changes.appRows.find(code);
+        if (rows == changes.appRows.end()) continue;
+        NormalizedKey key = NormalizedKey::of(code);
+        for (int i : rows->second) {
+            if (appSheet[i].size() > lastCol) updatedCount += syncAppRowPrice(appSheet[i], key, priceSheet, priceIndex);
+        }
+    }
+    const SheetIndex& stockIndex = stockLookup(changes, stockSheet);
+    for (const string& code : changes.stockCodes) {
+        auto rows = changes.appRows.find(code);
+        if (rows == changes.appRows.end()) continue;
+        NormalizedKey key = NormalizedKey::of(code);
+        bool sr = code.find("#S#R") != string::npos && stockIndex.find(key) > 0;
+        for (int i : rows->second) {
+            if (appSheet[i].size() > lastCol) updatedCount += syncAppRowStock(appSheet[i], key, stockSheet, stockIndex);
+            if (sr && appSheet[i].size() > kAppMaxStockCol) {
+                appSheet[i][kAppMaxStockCol] = "1";
+                maxStockCount++;
             }
         }
     }
-    logChange("App Sheet synchronized using VLOOKUP from Stock and Price Sheets - " + to_string(updatedCount) + " cells updated.");
-    cout << "App Sheet synchronized. Updated " << updatedCount << " cells.\n";
-    // Call the new function for #S#R products
-    setMaxStockForSRProducts(appSheet, stockSheet);
+    size_t codeCount = changes.stockCodes.size() + changes.priceCodes.size();
+    changes.stockCodes.clear();
+    changes.priceCodes.clear();
+    profileCount(ProfileCounter::CellsUpdated, updatedCount + maxStockCount);
+    logChange("App Sheet synchronized incrementally for " + to_string(codeCount) + " changed codes - " +
+              to_string(updatedCount) + " cells updated, max stock set for " + to_string(maxStockCount) + " #S#R rows.");
+    cout << "App Sheet synchronized (" << codeCount << " changed codes). Updated " << updatedCount << " cells.\n";
+    return true;
 }
 
-/**
+// Digits in a SKU as Python's \\d / str.isdigit see them: ASCII digits plus the
+// Arabic-Indic (U+0660-0669) and Extended Arabic-Indic (U+06F0-06F9) digits.
+// Returns the byte length of the digit at s[i], or 0 if there is none.
+static size_t skuDigitLength(string_view s, size_t i) {
+    unsigned char c = s[i];
+    if (c >= '0' && c <= '9') return 1;
+    if (i + 1 < s.size()) {
+        unsigned char next = s[i + 1];
+        if (c == 0xD9 && next >= 0xA0 && next <= 0xA9) return 2;
+        if (c == 0xDB && next >= 0xB0 && next <= 0xB9) return 2;
+    }
+    return 0;
+}
+
+// Counts the separate digit groups and the total number of digits in a SKU
+static void countSkuDigits(string_view sku, int& groups, int& digits) {
+    groups = 0;
+    digits = 0;
+    bool inGroup = false;
+    for (size_t i = 0; i < sku.size();) {
+        size_t len = skuDigitLength(sku, i);
+        if (len > 0) {
+            if (!inGroup) groups++;
+            inGroup = true;
+            digits++;
+            i += len;
+        } else {
+            inGroup = false;
+            i++;
+        }
+    }
+}
+
+// Parses a SKU the way pandas.to_numeric(errors='coerce') does: the whole text (surrounding
+// whitespace allowed) must be a decimal number, otherwise it is NaN
+static bool parseSkuNumber(string_view sku, double& value) {
+    string text(trimView(sku));
+    if (text.empty() || text.find_first_of("xX") != string::npos) return false;
+    char* end = nullptr;
+    value = strtod(text.c_str(), &end);
+    return end == text.c_str() + text.size() && !std::isnan(value);
+}
+
+// Sort App Sheet rows (header preserved) by SKU the way sort_csv_by_column.py did:
+// numerically ascending, ties broken by the SKU text, non-numeric SKUs last (ordered
+// by text), and equal keys keep their current order.
 void sortAppSheet(SheetData& appSheet) {
+    PROFILE_SCOPE("sortAppSheet");
     if (appSheet.size() <= 1) {
         cout << "App Sheet is empty or has only header row. Nothing to sort.\n";
         return;
     }
-    int skuCol = 8; // or use dynamic detection if needed
-
-    // Clean all SKUs: remove all non-digit characters
+    int skuCol = findColumnByName(appSheet, "sku");
+    if (skuCol == -1) skuCol = 8; // sku column in appSheet
+
+    // Precompute one key per row. Plain SKUs of up to 6 ASCII digits (nearly all of them)
+    // are packed into integers and radix sorted. Among equal values the low bits order
+    // the text the way string comparison does: more leading zeros first ("012" < "12"),
+    // except for zero itself where the shorter text wins ("0" < "00").
+    struct Key { double value; size_t row; };
+    vector<pair<uint32_t, size_t>> packed;
+    vector<Key> numeric, text;
+    packed.reserve(appSheet.size());
     for (size_t i = 1; i < appSheet.size(); ++i) {
-        if (appSheet[i].size() > skuCol) {
-            string& s = appSheet[i][skuCol];
-            string digits;
-            for (char c : s) if (isdigit(c)) digits += c;
-            s = digits;
+        static const SheetCell empty;
+        const SheetCell& sku = (int)appSheet[i].size() > skuCol ? appSheet[i][skuCol] : empty;
+        bool plain = !sku.empty() && sku.size() <= 6 &&
+                     all_of(sku.begin(), sku.end(), [](char c) { return c >= '0' && c <= '9'; });
+        double value = 0;
+        if (plain) {
+            uint32_t number = 0;
+            for (char c : sku) number = number * 10 + static_cast<uint32_t>(c - '0');
+            uint32_t tieBreak = static_cast<uint32_t>(number == 0 ? sku.size() - 1 : 6 - sku.size());
+            packed.push_back({number * 8 + tieBreak, i});
+        } else if (parseSkuNumber(sku, value)) {
+            numeric.push_back({value, i});
+        } else {
+            text.push_back({0, i});
         }
     }
 
-    // Now sort numerically, treating blanks as very large numbers
-    sort(appSheet.begin() + 1, appSheet.end(), [skuCol](const vector<string>& a, const vector<string>& b) {
-        double skuA = (a.size() > skuCol && !a[skuCol].empty()) ? stod(a[skuCol]) : std::numeric_limits<double>::max();
-        double skuB = (b.size() > skuCol && !b[skuCol].empty()) ? stod(b[skuCol]) : std::numeric_limits<double>::max();
-        return skuA < skuB;
+    // Two stable 12-bit counting passes cover the whole packed key range (< 2^23)
+    vector<pair<uint32_t, size_t>> buffer(packed.size());
+    for (int shift = 0; shift < 24; shift += 12) {
+        vector<size_t> counts(4097, 0);
+        for (const auto& entry : packed) counts[((entry.first >> shift) & 0xFFF) + 1]++;
+        for (size_t b = 1; b < counts.size(); ++b) counts[b] += counts[b - 1];
+        for (const auto& entry : packed) buffer[counts[(entry.first >> shift) & 0xFFF]++] = entry;
+        packed.swap(buffer);
+    }
+
+    auto skuOf = [&](size_t row) -> const SheetCell& {
+        static const SheetCell empty;
+        return (int)appSheet[row].size() > skuCol ? appSheet[row][skuCol] : empty;
+    };
+    stable_sort(numeric.begin(), numeric.end(), [&](const Key& a, const Key& b) {
+        if (a.value != b.value) return a.value < b.value;
+        return skuOf(a.row) < skuOf(b.row);
+    });
+    stable_sort(text.begin(), text.end(), [&](const Key& a, const Key& b) {
+        return skuOf(a.row) < skuOf(b.row);
     });
 
-    logChange("App Sheet sorted by sku (final robust numeric, header preserved).");
-    cout << "App Sheet sorted in ascending order by sku (final robust numeric, header row preserved).\n";
+    // Merge the packed and general numeric runs, then append the non-numeric rows
+    vector<size_t> order;
+    order.reserve(appSheet.size() - 1);
+    size_t p = 0, n = 0;
+    while (p < packed.size() || n < numeric.size()) {
+        bool takePacked = n == numeric.size();
+        if (!takePacked && p < packed.size()) {
+            double packedValue = packed[p].first / 8;
+            const Key& other = numeric[n];
+            takePacked = packedValue < other.value ||
+                         (packedValue == other.value && skuOf(packed[p].second) < skuOf(other.row));
+        }
+        order.push_back(takePacked ? packed[p++].second : numeric[n++].row);
+    }
+    for (const Key& key : text) order.push_back(key.row);
+
+    // Reordered within the sheet's arena, so the rows move without copying their cells
+    SheetData::Rows sorted(appSheet.rows().get_allocator());
+    sorted.reserve(appSheet.size());
+    sorted.push_back(std::move(appSheet[0]));
+    for (size_t row : order) sorted.push_back(std::move(appSheet[row]));
+    appSheet.rows().swap(sorted);
+
+    logChange("App Sheet sorted by sku (numeric, header preserved).");
+    cout << "App Sheet sorted in ascending order by sku (numerically, header row preserved).\n";
 }
 
-// Remove any row where SKU column contains two or more separate numbers (sequences of digits)
+// Remove any row whose SKU contains two or more separate numbers (sequences of digits)
+// or more than 6 digits in total, as sort_csv_by_column.py did. Blank lines are dropped
+// and rows are normalized to the header length, like the pandas round-trip.
 void removeRowsWithSkuContainingMultipleNumbers(SheetData& appSheet) {
-    int skuCol = 8; // sku column in appSheet
+    PROFILE_SCOPE("removeRowsWithSkuContainingMultipleNumbers");
+    if (appSheet.empty()) return;
+    int skuCol = findColumnByName(appSheet, "sku");
+    if (skuCol == -1) skuCol = 8; // sku column in appSheet
+
+    appSheet.erase(remove_if(appSheet.begin() + 1, appSheet.end(),
+                             [](const SheetRow& row) { return row.empty(); }),
+                   appSheet.end());
     // Normalize all rows to header length to prevent shifting/corruption
     normalizeAppSheetRowsToHeader(appSheet);
-    std::regex numberPattern(R"(\d+)");
-    auto hasMultipleNumbers = [skuCol, &numberPattern](const vector<string>& row) {
-        if (row.size() <= skuCol) return false;
-        auto sku = row[skuCol];
-        auto numbers_begin = std::sregex_iterator(sku.begin(), sku.end(), numberPattern);
-        auto numbers_end = std::sregex_iterator();
-        int count = std::distance(numbers_begin, numbers_end);
-        return count >= 2;
+
+    auto shouldRemove = [skuCol](const SheetRow& row) {
+        if ((int)row.size() <= skuCol) return false;
+        int groups = 0, digits = 0;
+        countSkuDigits(row[skuCol], groups, digits);
+        return groups >= 2 || digits > 6;
     };
     size_t before = appSheet.size();
     // Only erase from data rows, not header
-    appSheet.erase(remove_if(appSheet.begin() + 1, appSheet.end(), hasMultipleNumbers), appSheet.end());
+    appSheet.erase(remove_if(appSheet.begin() + 1, appSheet.end(), shouldRemove), appSheet.end());
     size_t after = appSheet.size();
     if (before != after) {
-        logChange("Rows with multiple numbers in SKU removed from App Sheet.");
-        cout << (before - after) << " row(s) with multiple numbers in SKU removed from App Sheet.\n";
+        logChange("Rows with multiple numbers or more than 6 digits in SKU removed from App Sheet.");
+        cout << (before - after) << " row(s) with multiple numbers or more than 6 digits in SKU removed from App Sheet.\n";
     } else {
         cout << "No rows with multiple numbers in SKU removed from App Sheet.\n";
     }
 }
-**/
 
 // Export a sheet to a new file
 void exportSheet(const SheetData& sheet, const string& path) {
@@ -258,25 +613,29 @@ void exportSheet(const SheetData& sheet, const string& path) {
 }
 
 // Deletes the first N rows from the price sheet (excluding header)
-void deleteFirstNRowsFromPriceSheet(SheetData& priceSheet, int n) {
+void deleteFirstNRowsFromPriceSheet(SheetData& priceSheet, int n, SheetKeys* keys) {
+    PROFILE_SCOPE("deleteFirstNRowsFromPriceSheet");
     if (priceSheet.size() == 0) {
         cout << "Price sheet is empty.\n";
         return;
     }
     int toDelete = min(n, (int)priceSheet.size());
     priceSheet.erase(priceSheet.begin(), priceSheet.begin() + toDelete);
+    if (keys) keys->rowsErased(0, toDelete);
     logChange("Deleted first " + to_string(toDelete) + " rows from price sheet (including header).");
     cout << "Deleted first " << toDelete << " rows from price sheet.\n";
 }
 
 // Unmerges columns I & J in the price sheet
-void unmergeIJColumnsInPriceSheet(SheetData& priceSheet) {
+void unmergeIJColumnsInPriceSheet(SheetData& priceSheet, SheetKeys* keys) {
+    PROFILE_SCOPE("unmergeIJColumnsInPriceSheet");
+    profileCount(ProfileCounter::RowsScanned, priceSheet.size());
     // Columns I (8) and J (9) (0-based)
     for (size_t i = 1; i < priceSheet.size(); ++i) {
         if (priceSheet[i].size() > 9) {
             // If I and J are merged (e.g., "val1|val2"), split by '|' or other delimiter
-            string& colI = priceSheet[i][8];
-            string& colJ = priceSheet[i][9];
+            SheetCell& colI = priceSheet[i][8];
+            SheetCell& colJ = priceSheet[i][9];
             size_t delim = colI.find('|');
             if (delim != string::npos) {
                 colJ = colI.substr(delim + 1);
@@ -284,24 +643,33 @@ void unmergeIJColumnsInPriceSheet(SheetData& priceSheet) {
             }
         }
     }
+    if (keys) {
+        keys->columnChanged(8);
+        keys->columnChanged(9);
+    }
     logChange("Unmerged columns I & J in price sheet.");
     cout << "Unmerged columns I & J in price sheet.\n";
 }
 
 // Moves the P column (referring to الكود) to the H column in the price sheet
-void movePColumnToHInPriceSheet(SheetData& priceSheet) {
+void movePColumnToHInPriceSheet(SheetData& priceSheet, SheetKeys* keys) {
+    PROFILE_SCOPE("movePColumnToHInPriceSheet");
+    profileCount(ProfileCounter::RowsScanned, priceSheet.size());
     // Column P (15), H (7) (0-based)
     for (size_t i = 1; i < priceSheet.size(); ++i) {
         if (priceSheet[i].size() > 15 && priceSheet[i].size() > 7) {
             priceSheet[i][7] = priceSheet[i][15];
         }
     }
+    if (keys) keys->columnChanged(7);
     logChange("Moved P column (الكود) to H column in price sheet.");
     cout << "Moved P column (الكود) to H column in price sheet.\n";
 }
 
 // Delete the repeated السعر column (index 9) from the price sheet
-void deleteRepeatedPriceColumn(SheetData& priceSheet) {
+void deleteRepeatedPriceColumn(SheetData& priceSheet, SheetKeys* keys) {
+    PROFILE_SCOPE("deleteRepeatedPriceColumn");
+    profileCount(ProfileCounter::RowsScanned, priceSheet.size());
     int priceColToDelete = 9; // السعر column to delete
 
     for (size_t i = 0; i < priceSheet.size(); ++i) {
@@ -309,12 +677,15 @@ void deleteRepeatedPriceColumn(SheetData& priceSheet) {
             priceSheet[i].erase(priceSheet[i].begin() + priceColToDelete);
         }
     }
+    if (keys) keys->columnsErased(priceColToDelete, 1);
     logChange("Deleted repeated السعر column (index 9) from price sheet.");
     cout << "Deleted repeated السعر column (index 9) from price sheet.\n";
 }
 
 // Delete the first 6 columns from the price sheet
-void deleteFirstSixColumns(SheetData& priceSheet) {
+void deleteFirstSixColumns(SheetData& priceSheet, SheetKeys* keys) {
+    PROFILE_SCOPE("deleteFirstSixColumns");
+    profileCount(ProfileCounter::RowsScanned, priceSheet.size());
     int columnsToDelete = 6; // Number of columns to delete from the beginning
 
     for (size_t i = 0; i < priceSheet.size(); ++i) {
@@ -325,89 +696,128 @@ void deleteFirstSixColumns(SheetData& priceSheet) {
             priceSheet[i].clear();
         }
     }
+    if (keys) keys->columnsErased(0, columnsToDelete);
     logChange("Deleted first 6 columns from price sheet.");
     cout << "Deleted first 6 columns from price sheet.\n";
 }
 
+static void reportHomeNursing(int updatedCount) {
+    profileCount(ProfileCounter::CellsUpdated, updatedCount);
+    logChange("Set stock to 9000000 for " + to_string(updatedCount) + " home nursing services rows in App Sheet.");
+    cout << "Updated " << updatedCount << " home nursing services rows with stock = 9000000.\n";
+}
+
 // Set all stock values for "home nursing services" to 9000000 in App Sheet
 void setHomeNursingStockTo9000000(SheetData& appSheet) {
-    int stockCol = 27; // stock column in appSheet
-    int updatedCount = 0;
-
-    for (size_t i = 1; i < appSheet.size(); ++i) { // skip header, start from row 1
-        if (appSheet[i].size() > stockCol) {
-            // Check if this row contains "home nursing services" (case insensitive)
-            bool isHomeNursing = false;
-            for (const string& cell : appSheet[i]) {
-                string lowerCell = cell;
-                transform(lowerCell.begin(), lowerCell.end(), lowerCell.begin(), ::tolower);
-                if (lowerCell.find("home nursing services") != string::npos) {
-                    isHomeNursing = true;
-                    break;
-                }
-            }
+    PROFILE_SCOPE("setHomeNursingStockTo9000000");
+    reportHomeNursing(homeNursingRules().apply(appSheet)[0]);
+}
 
-            if (isHomeNursing) {
-                appSheet[i][stockCol] = "9000000";
-                updatedCount++;
-            }
-        }
-    }
+void setHomeNursingStockTo9000000(Sheet& appSheet) {
+    PROFILE_SCOPE("setHomeNursingStockTo9000000");
+    reportHomeNursing(homeNursingRules().apply(appSheet)[0]);
+}
 
-    logChange("Set stock to 9000000 for " + to_string(updatedCount) + " home nursing services rows in App Sheet.");
-    cout << "Updated " << updatedCount << " home nursing services rows with stock = 9000000.\n";
+static void reportNanToZero(int convertedCount) {
+    profileCount(ProfileCounter::CellsUpdated, convertedCount);
+    logChange("Converted " + to_string(convertedCount) + " nan/empty values to 0 in App Sheet.");
+    cout << "Converted " << convertedCount << " nan/empty values to 0 in App Sheet.\n";
 }
 
 // Convert all "nan" values to "0" in App Sheet
 void convertNanToZero(SheetData& appSheet) {
+    PROFILE_SCOPE("convertNanToZero");
+    profileCount(ProfileCounter::RowsScanned, appSheet.size());
     int convertedCount = 0;
+    const WordMatcher& missing = missingValueWords();
 
     for (size_t i = 0; i < appSheet.size(); ++i) {
         for (size_t j = 0; j < appSheet[i].size(); ++j) {
-            string& cell = appSheet[i][j];
-            string lowerCell = cell;
-            transform(lowerCell.begin(), lowerCell.end(), lowerCell.begin(), ::tolower);
-
+            SheetCell& cell = appSheet[i][j];
             // Check for various forms of "nan"
-            if (lowerCell == "nan" || lowerCell == "n/a" || lowerCell == "na" ||
-                lowerCell == "null" || lowerCell == "undefined" || lowerCell == "") {
+            if (missing.matches(cell)) {
                 cell = "0";
                 convertedCount++;
             }
         }
     }
+    reportNanToZero(convertedCount);
+}
 
-    logChange("Converted " + to_string(convertedCount) + " nan/empty values to 0 in App Sheet.");
-    cout << "Converted " << convertedCount << " nan/empty values to 0 in App Sheet.\n";
+// Column by column, each on the pool (a column is only written by its own task). In a
+// numeric column the cells that parsed as numbers are skipped without reading their text.
+void convertNanToZero(Sheet& appSheet) {
+    PROFILE_SCOPE("convertNanToZero");
+    profileCount(ProfileCounter::RowsScanned, appSheet.rowCount());
+    const WordMatcher& missing = missingValueWords();
+    vector<int> counts(appSheet.columnCount(), 0);
+    ThreadPool::shared().parallelFor(appSheet.columnCount(), [&](size_t c) {
+        const SheetColumn& column = appSheet.column(c);
+        bool numeric = column.type != ColumnType::Text;
+        int count = 0;
+        for (size_t i = 0; i < appSheet.rowCount(); ++i) {
+            if ((numeric && column.hasValue[i]) || !appSheet.hasCell(i, c) || !missing.matches(column.text.get(i))) continue;
+            appSheet.setText(i, c, "0");
+            count++;
+        }
+        counts[c] = count;
+    });
+    int convertedCount = 0;
+    for (int count : counts) convertedCount += count;
+    reportNanToZero(convertedCount);
 }
 
-// Set max stock quantity in app sheet (column 25) for products with #S#R in their code
-void setMaxStockForSRProducts(SheetData& appSheet, const SheetData& stockSheet) {
+// Codes in the Stock Sheet holding #S#R, each counted as often as it appears
+static unordered_map<string, int> srStockCodes(const SheetData& stockSheet) {
     int stockCodeCol = 0; // code column in stockSheet
-    int appSkuCol = 8;    // sku column in appSheet
-    int maxStockCol = 25; // max stock column in appSheet
-    int updatedCount = 0;
-    // Collect all codes in stockSheet with #S#R
-    std::vector<std::string> srCodes;
+    unordered_map<string, int> srCodes;
     for (size_t i = 1; i < stockSheet.size(); ++i) { // skip header
         if (stockSheet[i].size() > stockCodeCol) {
-            const std::string& code = stockSheet[i][stockCodeCol];
-            if (code.find("#S#R") != std::string::npos) {
-                srCodes.push_back(trim(code));
-            }
+            const SheetCell& code = stockSheet[i][stockCodeCol];
+            if (code.find("#S#R") != std::string::npos) srCodes[string(trimView(code))]++;
         }
     }
-    // For each code, find the matching row in appSheet and set max stock
-    for (const auto& code : srCodes) {
+    return srCodes;
+}
+
+static void reportMaxStock(int updatedCount) {
+    profileCount(ProfileCounter::CellsUpdated, updatedCount);
+    logChange("Set max stock for #S#R products in App Sheet for " + std::to_string(updatedCount) + " rows.");
+    std::cout << "Updated max stock for #S#R products in App Sheet for " << updatedCount << " rows.\n";
+}
+
+// Set max stock quantity in app sheet (column 25) for products with #S#R in their code
+void setMaxStockForSRProducts(SheetData& appSheet, const SheetData& stockSheet) {
+    PROFILE_SCOPE("setMaxStockForSRProducts");
+    int updatedCount = 0;
+    unordered_map<string, int> srCodes = srStockCodes(stockSheet);
+    // A matching sku holds #S#R too, so one scan of the sku column finds every candidate row
+    if (!srCodes.empty()) {
+        vector<uint64_t> candidates = srSkuRules().match(appSheet);
         for (size_t i = 1; i < appSheet.size(); ++i) {
-            if (appSheet[i].size() > maxStockCol && appSheet[i].size() > appSkuCol) {
-                if (trim(appSheet[i][appSkuCol]) == code) {
-                    appSheet[i][maxStockCol] = "1";
-                    updatedCount++;
-                }
-            }
+            if (!candidates[i] || appSheet[i].size() <= kAppMaxStockCol) continue;
+            auto it = srCodes.find(string(trimView(appSheet[i][kAppSkuCol])));
+            if (it == srCodes.end()) continue;
+            appSheet[i][kAppMaxStockCol] = "1";
+            updatedCount += it->second;
         }
     }
-    logChange("Set max stock for #S#R products in App Sheet for " + std::to_string(updatedCount) + " rows.");
-    std::cout << "Updated max stock for #S#R products in App Sheet for " << updatedCount << " rows.\n";
+    reportMaxStock(updatedCount);
+}
+
+void setMaxStockForSRProducts(Sheet& appSheet, const SheetData& stockSheet) {
+    PROFILE_SCOPE("setMaxStockForSRProducts");
+    int updatedCount = 0;
+    unordered_map<string, int> srCodes = srStockCodes(stockSheet);
+    if (!srCodes.empty()) {
+        vector<uint64_t> candidates = srSkuRules().match(appSheet);
+        for (size_t i = 1; i < appSheet.rowCount(); ++i) {
+            if (!candidates[i] || appSheet.rowWidth(i) <= kAppMaxStockCol) continue;
+            auto it = srCodes.find(string(trimView(appSheet.text(i, kAppSkuCol))));
+            if (it == srCodes.end()) continue;
+            appSheet.setText(i, kAppMaxStockCol, "1");
+            updatedCount += it->second;
+        }
+    }
+    reportMaxStock(updatedCount);
 }
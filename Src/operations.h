@@ -1,23 +1,77 @@
 #pragma once
+#include "product_search.h"
+#include "sheet.h"
+#include "sheet_data.h"
+#include "sheet_index.h"
 #include <string>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
 
-// Search for a product by code in a given sheet
-typedef std::vector<std::vector<std::string>> SheetData;
+class ThreadPool;
+
+// Codes changed through updateStock / updatePrice since the last sync, together with the
+// lookups a full sync leaves behind (code indexes and a reverse index of sku -> App Sheet
+// rows). While the baseline holds, the next sync only revisits the App Sheet rows of the
+// changed codes. Any other change to the sheets must call invalidate().
+struct SyncChangeSet {
+    bool baseline = false; // a full sync ran and only tracked updates happened since
+    std::unordered_set<std::string> stockCodes;
+    std::unordered_set<std::string> priceCodes;
+    SheetIndex stockIndex;
+    SheetIndex priceIndex;
+    std::unordered_map<std::string, std::vector<int>> appRows;
+    // Key caches of the sheets (optional, not owned). When set, the sync looks codes up
+    // through them instead of building its own indexes.
+    SheetKeys* stockKeys = nullptr;
+    SheetKeys* priceKeys = nullptr;
+    SheetKeys* appKeys = nullptr;
 
+    void markStock(const std::string& code) { stockCodes.insert(code); }
+    void markPrice(const std::string& code) { priceCodes.insert(code); }
+    // The sheets changed in a way the set does not track: the next sync is a full one
+    void invalidate();
+};
+
+// Search for a product by code in a given sheet
 void searchProduct(const std::string& code, const SheetData& stockSheet, const SheetData& priceSheet, const SheetData& appSheet);
-void updateStock(SheetData& stockSheet, const std::string& code, int newStock);
-void updatePrice(SheetData& priceSheet, const std::string& code, double newPrice);
+void searchProduct(const std::string& code, const SheetData& stockSheet, const SheetIndex& stockIndex,
+                   const SheetData& priceSheet, const SheetIndex& priceIndex,
+                   const SheetData& appSheet, const SheetIndex& appIndex);
+// Search all three sheets for a code, a code prefix or part of a product name (Arabic or
+// English) and print the ranked hits
+void searchProducts(const ProductSearch& search, const std::string& query, const SheetData& stockSheet,
+                    const SheetData& priceSheet, const SheetData& appSheet, size_t limit = 20);
+// The update functions record the code in changes (if given) when the update succeeds
+void updateStock(SheetData& stockSheet, const std::string& code, int newStock, SyncChangeSet* changes = nullptr);
+void updateStock(SheetData& stockSheet, const SheetIndex& stockIndex, const std::string& code, int newStock,
+                 SyncChangeSet* changes = nullptr);
+void updatePrice(SheetData& priceSheet, const std::string& code, double newPrice, SyncChangeSet* changes = nullptr);
+void updatePrice(SheetData& priceSheet, const SheetIndex& priceIndex, const std::string& code, double newPrice,
+                 SyncChangeSet* changes = nullptr);
 void addProduct(SheetData& sheet, const std::vector<std::string>& productRow);
-void syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet);
+// Returns false if the sync could not run (an empty sheet or missing columns)
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet);
+// Same sync with the App Sheet rows split across the pool's threads (the overload above
+// uses the shared pool). Results and messages do not depend on the thread count.
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet, ThreadPool& pool);
+// Incremental sync: applies only the codes in changes when its baseline holds, otherwise
+// runs the full sync and sets the baseline. Both leave the App Sheet in the same state.
+bool syncAppSheet(SheetData& appSheet, const SheetData& stockSheet, const SheetData& priceSheet, SyncChangeSet& changes);
+// Same full sync over a columnar App Sheet (batch mode keeps it columnar, see Sheet)
+bool syncAppSheet(Sheet& appSheet, const SheetData& stockSheet, const SheetData& priceSheet);
 void sortAppSheet(SheetData& appSheet);
 void removeRowsWithSkuContainingMultipleNumbers(SheetData& appSheet);
 void exportSheet(const SheetData& sheet, const std::string& path);
-void deleteFirstNRowsFromPriceSheet(SheetData& priceSheet, int n);
-void unmergeIJColumnsInPriceSheet(SheetData& priceSheet);
-void movePColumnToHInPriceSheet(SheetData& priceSheet);
-void deleteRepeatedPriceColumn(SheetData& priceSheet);
-void deleteFirstSixColumns(SheetData& priceSheet);
+// The price cleanup steps report their row and column moves to keys (if given)
+void deleteFirstNRowsFromPriceSheet(SheetData& priceSheet, int n, SheetKeys* keys = nullptr);
+void unmergeIJColumnsInPriceSheet(SheetData& priceSheet, SheetKeys* keys = nullptr);
+void movePColumnToHInPriceSheet(SheetData& priceSheet, SheetKeys* keys = nullptr);
+void deleteRepeatedPriceColumn(SheetData& priceSheet, SheetKeys* keys = nullptr);
+void deleteFirstSixColumns(SheetData& priceSheet, SheetKeys* keys = nullptr);
 void setHomeNursingStockTo9000000(SheetData& appSheet);
+void setHomeNursingStockTo9000000(Sheet& appSheet);
 void convertNanToZero(SheetData& appSheet);
+void convertNanToZero(Sheet& appSheet);
 void setMaxStockForSRProducts(SheetData& appSheet, const SheetData& stockSheet);
+void setMaxStockForSRProducts(Sheet& appSheet, const SheetData& stockSheet);
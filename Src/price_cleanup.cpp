@@ -0,0 +1,234 @@
+#include "price_cleanup.h"
+#include "csv_view.h"
+#include "logger.h"
+#include <algorithm>
+#include <iostream>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+// Takes the value of one output cell from a loaded row. Cells no other output reads are
+// moved (and cut in place for the '|' parts) instead of copied.
+SheetCell takeCell(SheetRow& src, const CellSource& source) {
+    SheetCell& cell = src[source.col];
+    if (source.part == CellPart::Whole) return source.lastUse ? std::move(cell) : cell;
+
+    size_t bar = cell.find('|');
+    if (source.part == CellPart::BeforeBar) {
+        if (bar == string::npos) return source.lastUse ? std::move(cell) : cell;
+        if (!source.lastUse) return cell.substr(0, bar);
+        cell.resize(bar);
+        return std::move(cell);
+    }
+    if (bar == string::npos) return source.lastUse ? std::move(src[source.fallback]) : src[source.fallback];
+    if (!source.lastUse) return cell.substr(bar + 1);
+    cell.erase(0, bar + 1);
+    return std::move(cell);
+}
+
+// Same for a row of a CsvView, whose cells are spans into the mapped file
+string_view viewCell(const CsvView& view, size_t row, const CellSource& source) {
+    string_view cell = view.cell(row, source.col);
+    if (source.part == CellPart::Whole) return cell;
+
+    size_t bar = cell.find('|');
+    if (source.part == CellPart::BeforeBar) return cell.substr(0, bar);
+    if (bar == string_view::npos) return view.cell(row, source.fallback);
+    return cell.substr(bar + 1);
+}
+
+} // namespace
+
+// Options 10-14 in menu order
+PriceCleanupPlan PriceCleanupPlan::menuSequence() {
+    PriceCleanupPlan plan;
+    plan.deleteFirstRows(10).unmergeIJColumns().movePColumnToH().deleteRepeatedPrice().deleteFirstSixColumns();
+    return plan;
+}
+
+PriceCleanupPlan& PriceCleanupPlan::deleteFirstRows(int n) {
+    steps_.push_back({StepKind::DeleteFirstRows, max(n, 0)});
+    return *this;
+}
+
+PriceCleanupPlan& PriceCleanupPlan::unmergeIJColumns() {
+    steps_.push_back({StepKind::UnmergeIJ, 0});
+    return *this;
+}
+
+PriceCleanupPlan& PriceCleanupPlan::movePColumnToH() {
+    steps_.push_back({StepKind::MovePToH, 0});
+    return *this;
+}
+
+PriceCleanupPlan& PriceCleanupPlan::deleteRepeatedPrice() {
+    steps_.push_back({StepKind::DeleteRepeatedPrice, 0});
+    return *this;
+}
+
+PriceCleanupPlan& PriceCleanupPlan::deleteFirstSixColumns() {
+    steps_.push_back({StepKind::DeleteFirstSix, 0});
+    return *this;
+}
+
+// Runs the steps over a row of symbolic cells (initially cell c = source column c),
+// applying each step's row and width conditions exactly as the individual operation does.
+bool PriceCleanupPlan::projectRow(size_t row, size_t rowCount, size_t width, RowProjection& out) const {
+    out.clear();
+    for (size_t c = 0; c < width; ++c) out.push_back({static_cast<int>(c), CellPart::Whole, -1, false});
+
+    size_t pos = row, remaining = rowCount; // position of the row in the sheet as each step sees it
+    for (const Step& step : steps_) {
+        switch (step.kind) {
+        case StepKind::DeleteFirstRows: {
+            size_t toDelete = min(static_cast<size_t>(step.count), remaining);
+            if (pos < toDelete) return false;
+            pos -= toDelete;
+            remaining -= toDelete;
+            break;
+        }
+        case StepKind::UnmergeIJ:
+            // Cell 9 is always a whole cell here: an AfterBar cell is only created at 9 by this
+            // step, which leaves cell 8 as BeforeBar (no '|' left, so repeating it is a no-op)
+            if (pos >= 1 && out.size() > 9 && out[8].part == CellPart::Whole) {
+                out[9] = {out[8].col, CellPart::AfterBar, out[9].col, false};
+                out[8].part = CellPart::BeforeBar;
+            }
+            break;
+        case StepKind::MovePToH:
+            if (pos >= 1 && out.size() > 15) out[7] = out[15];
+            break;
+        case StepKind::DeleteRepeatedPrice:
+            if (out.size() > 9) out.erase(out.begin() + 9);
+            break;
+        case StepKind::DeleteFirstSix:
+            if (out.size() > 6) out.erase(out.begin(), out.begin() + 6);
+            else out.clear();
+            break;
+        }
+    }
+
+    vector<int> reads(width, 0);
+    for (const CellSource& source : out) {
+        reads[source.col]++;
+        if (source.part == CellPart::AfterBar) reads[source.fallback]++;
+    }
+    for (CellSource& source : out) {
+        source.lastUse = reads[source.col] == 1 &&
+                         (source.part != CellPart::AfterBar || reads[source.fallback] == 1);
+    }
+    return true;
+}
+
+// Rows from firstBodyRow on are past every deleted row and every header a step skips,
+// so they all share one projection per row width
+size_t PriceCleanupPlan::firstBodyRow(size_t rowCount, size_t& keptRows) const {
+    size_t first = 1;
+    keptRows = rowCount;
+    for (const Step& step : steps_) {
+        if (step.kind != StepKind::DeleteFirstRows) continue;
+        size_t toDelete = min(static_cast<size_t>(step.count), keptRows);
+        first += toDelete;
+        keptRows -= toDelete;
+    }
+    return first;
+}
+
+// Returns the projection for a row, or nullptr if the plan deletes it
+const RowProjection* PriceCleanupPlan::projectionFor(size_t row, size_t rowCount, size_t width,
+                                                     ProjectionCache& cache) const {
+    if (row < cache.firstBodyRow) {
+        return projectRow(row, rowCount, width, cache.head) ? &cache.head : nullptr;
+    }
+    auto it = cache.byWidth.find(width);
+    if (it == cache.byWidth.end()) {
+        it = cache.byWidth.emplace(width, RowProjection()).first;
+        projectRow(row, rowCount, width, it->second);
+    }
+    return &it->second;
+}
+
+// Cleans a loaded sheet in place. Each row is rebuilt in a scratch row (in the sheet's
+// arena) that then trades places with it, so the old row's storage is reused for the next
+// row; kept rows are compacted towards the front as they go.
+void PriceCleanupPlan::apply(SheetData& priceSheet) const {
+    size_t rowCount = priceSheet.size(), keptRows = 0;
+    ProjectionCache cache;
+    cache.firstBodyRow = firstBodyRow(rowCount, keptRows);
+
+    SheetRow scratch = priceSheet.newRow();
+    size_t kept = 0;
+    for (size_t r = 0; r < rowCount; ++r) {
+        SheetRow& src = priceSheet[r];
+        const RowProjection* projection = projectionFor(r, rowCount, src.size(), cache);
+        if (projection == nullptr) continue;
+        scratch.clear();
+        scratch.reserve(projection->size());
+        for (const CellSource& source : *projection) scratch.push_back(takeCell(src, source));
+        src.swap(scratch);
+        if (kept != r) priceSheet[kept].swap(src);
+        kept++;
+    }
+    priceSheet.resize(kept);
+    report(rowCount);
+}
+
+// Reads a CSV file and cleans it while building the rows. Returns true if successful.
+bool PriceCleanupPlan::readCSV(const string& path, SheetData& priceSheet) const {
+    CsvView view;
+    if (!view.open(path)) {
+        cerr << "Error: Could not open file " << path << endl;
+        return false;
+    }
+    size_t rowCount = view.rowCount(), keptRows = 0;
+    ProjectionCache cache;
+    cache.firstBodyRow = firstBodyRow(rowCount, keptRows);
+
+    priceSheet.clear();
+    priceSheet.reserve(keptRows);
+    for (size_t r = 0; r < rowCount; ++r) {
+        const RowProjection* projection = projectionFor(r, rowCount, view.cellCount(r), cache);
+        if (projection == nullptr) continue;
+        SheetRow& row = priceSheet.emplace_back();
+        row.reserve(projection->size());
+        for (const CellSource& source : *projection) row.emplace_back(viewCell(view, r, source));
+    }
+    report(rowCount);
+    return true;
+}
+
+// Logs and prints each step's message as the individual operations do
+void PriceCleanupPlan::report(size_t rowCount) const {
+    for (const Step& step : steps_) {
+        switch (step.kind) {
+        case StepKind::DeleteFirstRows: {
+            if (rowCount == 0) {
+                cout << "Price sheet is empty.\n";
+                break;
+            }
+            size_t toDelete = min(static_cast<size_t>(step.count), rowCount);
+            rowCount -= toDelete;
+            logChange("Deleted first " + to_string(toDelete) + " rows from price sheet (including header).");
+            cout << "Deleted first " << toDelete << " rows from price sheet.\n";
+            break;
+        }
+        case StepKind::UnmergeIJ:
+            logChange("Unmerged columns I & J in price sheet.");
+            cout << "Unmerged columns I & J in price sheet.\n";
+            break;
+        case StepKind::MovePToH:
+            logChange("Moved P column (الكود) to H column in price sheet.");
+            cout << "Moved P column (الكود) to H column in price sheet.\n";
+            break;
+        case StepKind::DeleteRepeatedPrice:
+            logChange("Deleted repeated السعر column (index 9) from price sheet.");
+            cout << "Deleted repeated السعر column (index 9) from price sheet.\n";
+            break;
+        case StepKind::DeleteFirstSix:
+            logChange("Deleted first 6 columns from price sheet.");
+            cout << "Deleted first 6 columns from price sheet.\n";
+            break;
+        }
+    }
+}
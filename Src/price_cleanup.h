@@ -0,0 +1,68 @@
+#pragma once
+#include "sheet_data.h"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Part of a source cell that ends up in an output cell
+enum class CellPart {
+    Whole,     // the whole source cell
+    BeforeBar, // text before the first '|' (the whole cell if it has none)
+    AfterBar   // text after the first '|'; the fallback column if the cell has none
+};
+
+// Where one output cell of a cleaned row comes from
+struct CellSource {
+    int col;
+    CellPart part;
+    int fallback;  // AfterBar only
+    bool lastUse;  // no other output cell reads col (or uses it as a fallback)
+};
+typedef std::vector<CellSource> RowProjection;
+
+// Declarative form of the price sheet cleanup (menu options 10-14). The steps are
+// composed into one column projection per row shape, so the sheet is rebuilt in a
+// single pass with one allocation per row instead of one pass (and one front erase
+// per row) per step. Results, counts and messages match running the steps in order.
+class PriceCleanupPlan {
+public:
+    // Options 10-14 in menu order
+    static PriceCleanupPlan menuSequence();
+
+    PriceCleanupPlan& deleteFirstRows(int n);  // option 10
+    PriceCleanupPlan& unmergeIJColumns();      // option 11
+    PriceCleanupPlan& movePColumnToH();        // option 12
+    PriceCleanupPlan& deleteRepeatedPrice();   // option 13
+    PriceCleanupPlan& deleteFirstSixColumns(); // option 14
+
+    // Composes the steps for row `row` (of `rowCount`) with `width` cells.
+    // Returns false if the plan deletes the row.
+    bool projectRow(size_t row, size_t rowCount, size_t width, RowProjection& out) const;
+
+    // Cleans a loaded sheet in place
+    void apply(SheetData& priceSheet) const;
+
+    // Reads a CSV file and cleans it while building the rows, so the raw layout is
+    // never materialized. Returns true if successful.
+    bool readCSV(const std::string& path, SheetData& priceSheet) const;
+
+private:
+    enum class StepKind { DeleteFirstRows, UnmergeIJ, MovePToH, DeleteRepeatedPrice, DeleteFirstSix };
+    struct Step {
+        StepKind kind;
+        int count;
+    };
+
+    struct ProjectionCache {
+        size_t firstBodyRow = 0;
+        std::unordered_map<size_t, RowProjection> byWidth;
+        RowProjection head;
+    };
+    size_t firstBodyRow(size_t rowCount, size_t& keptRows) const;
+    const RowProjection* projectionFor(size_t row, size_t rowCount, size_t width, ProjectionCache& cache) const;
+
+    // Logs and prints each step's message as the individual operations do
+    void report(size_t rowCount) const;
+
+    std::vector<Step> steps_;
+};
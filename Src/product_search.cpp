@@ -0,0 +1,316 @@
+#include "product_search.h"
+#include "profiler.h"
+#include "text_utils.h"
+#include <algorithm>
+#include <numeric>
+using namespace std;
+
+namespace {
+
+const uint32_t kInvalid = 0xFFFFFFFF;
+const uint32_t kWordBreak = ' ';
+const uint32_t kDropped = 0;
+
+// Next code point of text at i (advancing i), or kInvalid for a byte that does not start
+// a well-formed UTF-8 sequence (i then moves past that byte only)
+uint32_t decodeUtf8(string_view text, size_t& i) {
+    unsigned char lead = static_cast<unsigned char>(text[i++]);
+    if (lead < 0x80) return lead;
+    int extra = lead >= 0xF0 && lead < 0xF5 ? 3 : lead >= 0xE0 ? 2 : lead >= 0xC2 && lead < 0xE0 ? 1 : -1;
+    if (extra < 0 || i + extra > text.size()) return kInvalid;
+    uint32_t cp = lead & (0x3F >> extra);
+    for (int k = 0; k < extra; ++k) {
+        unsigned char next = static_cast<unsigned char>(text[i + k]);
+        if ((next & 0xC0) != 0x80) return kInvalid;
+        cp = (cp << 6) | (next & 0x3F);
+    }
+    i += extra;
+    return cp;
+}
+
+void appendUtf8(string& out, uint32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Arabic-Indic and extended Arabic-Indic digits as ASCII, other code points unchanged
+uint32_t foldDigit(uint32_t cp) {
+    if (cp >= 0x0660 && cp <= 0x0669) return '0' + (cp - 0x0660);
+    if (cp >= 0x06F0 && cp <= 0x06F9) return '0' + (cp - 0x06F0);
+    return cp;
+}
+
+// Search form of one code point: the folded letter or digit, kDropped or kWordBreak
+uint32_t foldForSearch(uint32_t cp) {
+    if (cp == kInvalid) return kWordBreak;
+    if (cp < 0x80) {
+        char c = asciiLower(static_cast<char>(cp));
+        return (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') ? static_cast<uint32_t>(c) : kWordBreak;
+    }
+    cp = foldDigit(cp);
+    if (cp < 0x80) return cp;
+    switch (cp) {
+        case 0x0622: case 0x0623: case 0x0625: case 0x0671: return 0x0627; // alef forms -> ا
+        case 0x0624: return 0x0648;                                         // ؤ -> و
+        case 0x0626: case 0x0649: return 0x064A;                            // ئ ى -> ي
+        case 0x0629: return 0x0647;                                         // ة -> ه
+        case 0x0640: return kDropped;                                       // tatweel
+        case 0x060C: case 0x061B: case 0x061F: case 0x066A: case 0x066B: case 0x066C: case 0x06D4:
+        case 0x00A0: return kWordBreak;                                     // Arabic punctuation, no-break space
+    }
+    if ((cp >= 0x064B && cp <= 0x065F) || cp == 0x0670) return kDropped; // harakat, superscript alef
+    if (cp >= 0x2000 && cp <= 0x206F) return kWordBreak;                 // general punctuation and spaces
+    return cp;
+}
+
+// Distinct trigrams of a normalized text, each word padded with a space on both sides so
+// short words and word starts have trigrams too. Three 21-bit code points per key.
+vector<uint64_t> trigramsOf(string_view normalized) {
+    vector<uint64_t> grams;
+    vector<uint32_t> padded;
+    auto addWord = [&]() {
+        if (padded.size() < 2) return; // no word since the last break
+        padded.push_back(kWordBreak);
+        for (size_t k = 0; k + 2 < padded.size(); ++k) {
+            grams.push_back((uint64_t(padded[k]) << 42) | (uint64_t(padded[k + 1]) << 21) | padded[k + 2]);
+        }
+        padded.assign(1, kWordBreak);
+    };
+    padded.assign(1, kWordBreak);
+    size_t i = 0;
+    while (i < normalized.size()) {
+        uint32_t cp = decodeUtf8(normalized, i);
+        if (cp == kWordBreak) addWord();
+        else padded.push_back(cp);
+    }
+    addWord();
+    sort(grams.begin(), grams.end());
+    grams.erase(unique(grams.begin(), grams.end()), grams.end());
+    return grams;
+}
+
+bool isMissing(string_view cell) {
+    return missingValueWords().matches(trimView(cell));
+}
+
+} // namespace
+
+string normalizeSearchText(string_view text) {
+    string out;
+    out.reserve(text.size());
+    bool pendingBreak = false;
+    size_t i = 0;
+    while (i < text.size()) {
+        uint32_t cp = foldForSearch(decodeUtf8(text, i));
+        if (cp == kDropped) continue;
+        if (cp == kWordBreak) {
+            pendingBreak = !out.empty();
+            continue;
+        }
+        if (pendingBreak) out += ' ';
+        pendingBreak = false;
+        appendUtf8(out, cp);
+    }
+    return out;
+}
+
+string normalizeSearchCode(string_view code) {
+    string_view trimmed = trimView(code);
+    string out;
+    out.reserve(trimmed.size());
+    size_t i = 0;
+    while (i < trimmed.size()) {
+        size_t start = i;
+        uint32_t cp = decodeUtf8(trimmed, i);
+        if (cp == kInvalid) {
+            out += trimmed[start];
+            continue;
+        }
+        cp = foldDigit(cp);
+        if (cp < 0x80) out += asciiLower(static_cast<char>(cp));
+        else out.append(trimmed.substr(start, i - start));
+    }
+    return out;
+}
+
+void ProductSearch::build(const SheetData& stockSheet, const SheetData& priceSheet, const SheetData& appSheet) {
+    PROFILE_SCOPE("ProductSearch::build");
+    invalidate();
+    addCodes(stockSheet, SearchSheet::Stock, 0);
+    addCodes(priceSheet, SearchSheet::Price, 15);
+    addCodes(appSheet, SearchSheet::App, 8);
+    stable_sort(codes_.begin(), codes_.end(), [](const CodeEntry& a, const CodeEntry& b) { return a.code < b.code; });
+
+    // Keys are views into names_, which is reserved for every name cell so it never moves
+    names_.reserve(stockSheet.size() + priceSheet.size() + 2 * appSheet.size());
+    unordered_map<string_view, uint32_t> nameIds;
+    nameIds.reserve(names_.capacity());
+    addNames(stockSheet, SearchSheet::Stock, 1, nameIds);
+    addNames(priceSheet, SearchSheet::Price, 1, nameIds);
+    addNames(appSheet, SearchSheet::App, 1, nameIds);
+    addNames(appSheet, SearchSheet::App, 2, nameIds);
+    // The Arabic name pass revisits App rows, so each name's rows are put back in sheet and
+    // row order and the names renumbered by their first row; search() breaks ties on id
+    auto rowBefore = [](const RowRef& a, const RowRef& b) {
+        return a.sheet != b.sheet ? a.sheet < b.sheet : a.row < b.row;
+    };
+    for (vector<RowRef>& rows : nameRows_) sort(rows.begin(), rows.end(), rowBefore);
+    vector<uint32_t> order(names_.size());
+    iota(order.begin(), order.end(), 0);
+    sort(order.begin(), order.end(),
+         [&](uint32_t a, uint32_t b) { return rowBefore(nameRows_[a].front(), nameRows_[b].front()); });
+    vector<string> names(names_.size());
+    vector<vector<RowRef>> nameRows(names_.size());
+    for (uint32_t id = 0; id < order.size(); ++id) {
+        names[id] = std::move(names_[order[id]]);
+        nameRows[id] = std::move(nameRows_[order[id]]);
+    }
+    names_ = std::move(names);
+    nameRows_ = std::move(nameRows);
+    trigrams_.reserve(names_.size());
+    for (uint32_t id = 0; id < names_.size(); ++id) {
+        for (uint64_t gram : trigramsOf(names_[id])) trigrams_[gram].push_back(id);
+    }
+    profileCount(ProfileCounter::RowsScanned, stockSheet.size() + priceSheet.size() + appSheet.size());
+    ready_ = true;
+}
+
+void ProductSearch::invalidate() {
+    codes_.clear();
+    names_.clear();
+    nameRows_.clear();
+    trigrams_.clear();
+    ready_ = false;
+}
+
+void ProductSearch::addCodes(const SheetData& sheet, SearchSheet which, int col) {
+    for (size_t i = 1; i < sheet.size(); ++i) { // skip header
+        if ((int)sheet[i].size() <= col || isMissing(sheet[i][col])) continue;
+        codes_.push_back({normalizeSearchCode(sheet[i][col]), {which, static_cast<int>(i)}});
+    }
+}
+
+void ProductSearch::addNames(const SheetData& sheet, SearchSheet which, int col,
+                             unordered_map<string_view, uint32_t>& nameIds) {
+    for (size_t i = 1; i < sheet.size(); ++i) { // skip header
+        if ((int)sheet[i].size() <= col || isMissing(sheet[i][col])) continue;
+        string name = normalizeSearchText(sheet[i][col]);
+        if (name.empty()) continue;
+        auto known = nameIds.find(name);
+        uint32_t id;
+        if (known != nameIds.end()) {
+            id = known->second;
+        } else {
+            id = static_cast<uint32_t>(names_.size());
+            names_.push_back(std::move(name));
+            nameRows_.emplace_back();
+            nameIds.emplace(names_.back(), id);
+        }
+        nameRows_[id].push_back({which, static_cast<int>(i)});
+    }
+}
+
+vector<SearchHit> ProductSearch::search(string_view query, size_t limit) const {
+    vector<SearchHit> hits;
+    // One hit per row: a row found by its code is not listed again for its name
+    auto addHit = [&](SearchHit::Kind kind, const RowRef& ref, int similarity) {
+        for (const SearchHit& hit : hits) {
+            if (hit.sheet == ref.sheet && hit.row == ref.row) return;
+        }
+        hits.push_back({kind, ref.sheet, ref.row, similarity});
+    };
+
+    // Codes starting with the query are one contiguous run of the sorted array, and an
+    // exact match sorts first in it
+    string code = normalizeSearchCode(query);
+    if (!code.empty()) {
+        auto it = lower_bound(codes_.begin(), codes_.end(), code,
+                              [](const CodeEntry& entry, const string& key) { return entry.code < key; });
+        for (; it != codes_.end() && hits.size() < limit && it->code.compare(0, code.size(), code) == 0; ++it) {
+            addHit(it->code.size() == code.size() ? SearchHit::ExactCode : SearchHit::CodePrefix, it->ref, 1000);
+        }
+    }
+
+    // A query of digits only is a code; matching it against names would only find sizes
+    // such as "1000mg"
+    string text = normalizeSearchText(query);
+    bool hasLetter = any_of(text.begin(), text.end(), [](char c) { return c != ' ' && (c < '0' || c > '9'); });
+    if (hits.size() >= limit || !hasLetter) return hits;
+    vector<uint64_t> grams = trigramsOf(text);
+
+    // Count the query trigrams each name shares; names holding at least half of them are
+    // kept. Such a name is in at least one of the (count - needed + 1) shortest posting
+    // lists, so only those lists add names; the longer ones just add to names already
+    // found, probing for each of them when that is cheaper than walking the list. The
+    // counters are per thread and only the touched ones are cleared afterwards, so a query
+    // does not pay for the size of the index.
+    size_t needed = (grams.size() + 1) / 2;
+    vector<pair<const uint32_t*, const uint32_t*>> lists;
+    for (uint64_t gram : grams) {
+        auto postings = trigrams_.find(gram);
+        if (postings == trigrams_.end()) lists.emplace_back(nullptr, nullptr);
+        else lists.emplace_back(postings->second.data(), postings->second.data() + postings->second.size());
+    }
+    sort(lists.begin(), lists.end(), [](const auto& a, const auto& b) { return a.second - a.first < b.second - b.first; });
+    thread_local vector<uint16_t> shared;
+    if (shared.size() < names_.size()) shared.resize(names_.size(), 0);
+    vector<uint32_t> touched;
+    size_t seedLists = grams.size() - needed + 1;
+    for (size_t l = 0; l < lists.size(); ++l) {
+        const uint32_t* first = lists[l].first;
+        const uint32_t* last = lists[l].second;
+        if (l < seedLists) {
+            for (const uint32_t* p = first; p != last; ++p) {
+                if (shared[*p]++ == 0) touched.push_back(*p);
+            }
+        } else if (touched.size() * 16 < size_t(last - first)) {
+            for (uint32_t id : touched) shared[id] += binary_search(first, last, id);
+        } else {
+            for (const uint32_t* p = first; p != last; ++p) shared[*p] += shared[*p] != 0;
+        }
+    }
+    struct Candidate {
+        uint32_t id;
+        int similarity;
+        size_t lengthGap;
+    };
+    vector<Candidate> candidates;
+    for (uint32_t id : touched) {
+        size_t count = shared[id];
+        shared[id] = 0;
+        if (count < needed) continue;
+        size_t length = names_[id].size();
+        candidates.push_back({id, static_cast<int>(count * 1000 / grams.size()),
+                              length > text.size() ? length - text.size() : text.size() - length});
+    }
+    // Every name has at least one row, so the best limit names normally fill the hits; the
+    // rest are only ordered if rows already listed leave room
+    auto better = [](const Candidate& a, const Candidate& b) {
+        if (a.similarity != b.similarity) return a.similarity > b.similarity;
+        if (a.lengthGap != b.lengthGap) return a.lengthGap < b.lengthGap;
+        return a.id < b.id; // ids follow each name's first row, so this is sheet and row order
+    };
+    size_t best = min(limit, candidates.size());
+    partial_sort(candidates.begin(), candidates.begin() + best, candidates.end(), better);
+    for (size_t c = 0; c < candidates.size() && hits.size() < limit; ++c) {
+        if (c == best) sort(candidates.begin() + best, candidates.end(), better);
+        for (const RowRef& ref : nameRows_[candidates[c].id]) {
+            if (hits.size() >= limit) break;
+            addHit(SearchHit::Name, ref, candidates[c].similarity);
+        }
+    }
+    return hits;
+}
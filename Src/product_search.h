@@ -0,0 +1,69 @@
+#pragma once
+#include "sheet_data.h"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Search form of a product name: UTF-8 decoded, ASCII letters lowercased, Arabic
+// diacritics and tatweel dropped, alef/hamza forms, taa marbuta and alef maqsura folded
+// (أ إ آ ٱ -> ا, ؤ -> و, ئ ى -> ي, ة -> ه), Arabic-Indic digits turned into ASCII ones, and
+// everything else that is not a letter or digit (including invalid bytes) treated as a
+// word break. Words come out separated by single spaces.
+std::string normalizeSearchText(std::string_view text);
+// Search form of a code: trimmed, ASCII letters lowercased and Arabic-Indic digits turned
+// into ASCII ones; punctuation such as "#S#R" or "/" is kept.
+std::string normalizeSearchCode(std::string_view code);
+
+enum class SearchSheet : uint8_t { Stock, Price, App };
+
+struct SearchHit {
+    enum Kind : uint8_t { ExactCode, CodePrefix, Name };
+    Kind kind;
+    SearchSheet sheet;
+    int row;
+    int similarity; // Name hits: query trigrams found in the name, per mille (1000 for codes)
+};
+
+// In-memory product search over the three sheets, built once after loading: a sorted
+// array of codes answers exact and prefix lookups with two binary searches, and a trigram
+// index over the name columns finds names that share most of the query's trigrams, so a
+// part of a name or a misspelt one still matches. Names are indexed once per distinct
+// normalized text, as the same product name repeats across the sheets.
+// Columns: Stock code 0 and name 1, Price الكود 15 and name 1, App sku 8 and names 1
+// (English) and 2 (Arabic). The index holds row numbers, so anything that adds, removes
+// or reorders rows, or rewrites codes or names, must call invalidate() and build() again.
+class ProductSearch {
+public:
+    void build(const SheetData& stockSheet, const SheetData& priceSheet, const SheetData& appSheet);
+    bool ready() const { return ready_; }
+    void invalidate();
+
+    // Hits ranked exact code first, then code prefix (in code order), then names by
+    // similarity (ties: closest length, then sheet and row). At most limit hits, one per row.
+    // Queries made only of digits are matched against codes only.
+    std::vector<SearchHit> search(std::string_view query, size_t limit = 20) const;
+
+    size_t codeCount() const { return codes_.size(); }
+    size_t nameCount() const { return names_.size(); }
+
+private:
+    struct RowRef {
+        SearchSheet sheet;
+        int row;
+    };
+    struct CodeEntry {
+        std::string code;
+        RowRef ref;
+    };
+    void addCodes(const SheetData& sheet, SearchSheet which, int col);
+    void addNames(const SheetData& sheet, SearchSheet which, int col,
+                  std::unordered_map<std::string_view, uint32_t>& nameIds);
+
+    std::vector<CodeEntry> codes_;                                // sorted by code, then sheet and row
+    std::vector<std::string> names_;                              // distinct normalized names
+    std::vector<std::vector<RowRef>> nameRows_;                   // rows holding each name, in sheet and row order
+    std::unordered_map<uint64_t, std::vector<uint32_t>> trigrams_; // trigram -> names holding it, ascending
+    bool ready_ = false;
+};
@@ -0,0 +1,226 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+atomic<bool> gProfilingEnabled{false};
+
+// Allocations made by this thread while profiling was on (counted in profiler_alloc.cpp)
+extern thread_local uint64_t gThreadAllocations;
+extern atomic<uint64_t> gProcessAllocations;
+
+namespace {
+
+const size_t kMaxTraceEvents = 1 << 20; // per thread; later scopes still count in the summary
+const char* const kCounterNames[] = {"rows_scanned", "cells_updated", "bytes_read", "bytes_written"};
+
+struct ScopeStats {
+    uint64_t calls = 0;
+    int64_t totalNs = 0;
+    int64_t maxNs = 0;
+    uint64_t allocations = 0;
+    uint64_t counters[kProfileCounterCount] = {};
+};
+
+struct TraceEvent {
+    const char* name;
+    int64_t startNs;
+    int64_t durationNs;
+    uint64_t allocations;
+    uint64_t counters[kProfileCounterCount];
+};
+
+// What one thread recorded. Only that thread writes to it; the reports read it afterwards.
+struct ThreadProfile {
+    unsigned id = 0;
+    ProfileScope* open = nullptr;
+    unordered_map<const char*, ScopeStats> stats;
+    vector<TraceEvent> events;
+    uint64_t droppedEvents = 0;
+};
+
+struct ProfileRegistry {
+    mutex guard;
+    vector<shared_ptr<ThreadProfile>> threads;
+    chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+};
+
+ProfileRegistry& registry() {
+    static ProfileRegistry instance;
+    return instance;
+}
+
+ThreadProfile& threadProfile() {
+    thread_local shared_ptr<ThreadProfile> profile;
+    if (!profile) {
+        profile = make_shared<ThreadProfile>();
+        ProfileRegistry& reg = registry();
+        lock_guard<mutex> lock(reg.guard);
+        profile->id = static_cast<unsigned>(reg.threads.size()) + 1;
+        reg.threads.push_back(profile);
+    }
+    return *profile;
+}
+
+int64_t nowNs() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - registry().epoch).count();
+}
+
+void appendJsonString(string& out, const char* text) {
+    out += '"';
+    for (const char* p = text; *p != '\0'; ++p) {
+        unsigned char c = static_cast<unsigned char>(*p);
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += *p;
+        } else if (c < 0x20) {
+            char escaped[8];
+            snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            out += escaped;
+        } else {
+            out += *p;
+        }
+    }
+    out += '"';
+}
+
+} // namespace
+
+void enableProfiling(bool enabled) {
+    registry(); // fixes the trace epoch before the first scope
+    gProfilingEnabled.store(enabled, memory_order_relaxed);
+}
+
+uint64_t threadAllocationCount() { return gThreadAllocations; }
+
+uint64_t processAllocationCount() { return gProcessAllocations.load(memory_order_relaxed); }
+
+void addToOpenScope(ProfileCounter counter, uint64_t amount) {
+    ProfileScope* scope = threadProfile().open;
+    if (scope != nullptr) scope->counters_[static_cast<int>(counter)] += amount;
+}
+
+void ProfileScope::begin(const char* name) {
+    ThreadProfile& profile = threadProfile();
+    name_ = name;
+    parent_ = profile.open;
+    profile.open = this;
+    allocationsAtStart_ = gThreadAllocations;
+    startNs_ = nowNs();
+}
+
+void ProfileScope::end() {
+    int64_t durationNs = nowNs() - startNs_;
+    uint64_t allocations = gThreadAllocations - allocationsAtStart_;
+    ThreadProfile& profile = threadProfile();
+    profile.open = parent_;
+
+    ScopeStats& stats = profile.stats[name_];
+    stats.calls++;
+    stats.totalNs += durationNs;
+    stats.maxNs = max(stats.maxNs, durationNs);
+    stats.allocations += allocations;
+    for (int i = 0; i < kProfileCounterCount; ++i) stats.counters[i] += counters_[i];
+
+    if (profile.events.size() < kMaxTraceEvents) {
+        TraceEvent event{name_, startNs_, durationNs, allocations, {}};
+        copy(std::begin(counters_), std::end(counters_), event.counters);
+        profile.events.push_back(event);
+    } else {
+        profile.droppedEvents++;
+    }
+}
+
+// Per-scope table, slowest total first. Scopes of the same name are merged across threads.
+void printProfileSummary(ostream& out) {
+    map<string, ScopeStats> merged;
+    uint64_t dropped = 0;
+    {
+        ProfileRegistry& reg = registry();
+        lock_guard<mutex> lock(reg.guard);
+        for (const auto& thread : reg.threads) {
+            dropped += thread->droppedEvents;
+            for (const auto& entry : thread->stats) {
+                ScopeStats& total = merged[entry.first];
+                total.calls += entry.second.calls;
+                total.totalNs += entry.second.totalNs;
+                total.maxNs = max(total.maxNs, entry.second.maxNs);
+                total.allocations += entry.second.allocations;
+                for (int i = 0; i < kProfileCounterCount; ++i) total.counters[i] += entry.second.counters[i];
+            }
+        }
+    }
+    vector<pair<string, ScopeStats>> rows(merged.begin(), merged.end());
+    stable_sort(rows.begin(), rows.end(), [](const auto& a, const auto& b) { return a.second.totalNs > b.second.totalNs; });
+
+    ios state(nullptr);
+    state.copyfmt(out);
+    out << "\n--- Profile summary ---\n"
+        << left << setw(44) << "Scope" << right << setw(9) << "Calls" << setw(12) << "Total ms" << setw(11) << "Mean ms"
+        << setw(11) << "Max ms" << setw(12) << "Rows" << setw(12) << "Cells" << setw(13) << "Bytes read" << setw(13)
+        << "Bytes wrote" << setw(12) << "Allocs" << "\n";
+    out << fixed << setprecision(3);
+    for (const auto& row : rows) {
+        const ScopeStats& s = row.second;
+        out << left << setw(44) << row.first << right << setw(9) << s.calls << setw(12) << s.totalNs / 1e6 << setw(11)
+            << s.totalNs / 1e6 / s.calls << setw(11) << s.maxNs / 1e6;
+        for (int i = 0; i < kProfileCounterCount; ++i) out << setw(i < 2 ? 12 : 13) << s.counters[i];
+        out << setw(12) << s.allocations << "\n";
+    }
+    if (dropped > 0) out << "(" << dropped << " scopes beyond the trace limit are in the table but not in the trace)\n";
+    out.copyfmt(state);
+}
+
+// Chrome trace format: one complete ("X") event per scope, timestamps in microseconds
+bool writeProfileTrace(const string& path) {
+    FILE* file = fopen(path.c_str(), "wb");
+    if (file == nullptr) return false;
+    string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    char number[160];
+    ProfileRegistry& reg = registry();
+    lock_guard<mutex> lock(reg.guard);
+    for (const auto& thread : reg.threads) {
+        for (const TraceEvent& event : thread->events) {
+            json += first ? "\n{\"name\":" : ",\n{\"name\":";
+            first = false;
+            appendJsonString(json, event.name);
+            snprintf(number, sizeof(number), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{", thread->id,
+                     event.startNs / 1e3, event.durationNs / 1e3);
+            json += number;
+            snprintf(number, sizeof(number), "\"allocations\":%llu", static_cast<unsigned long long>(event.allocations));
+            json += number;
+            for (int i = 0; i < kProfileCounterCount; ++i) {
+                if (event.counters[i] == 0) continue;
+                snprintf(number, sizeof(number), ",\"%s\":%llu", kCounterNames[i], static_cast<unsigned long long>(event.counters[i]));
+                json += number;
+            }
+            json += "}}";
+            if (json.size() >= (1 << 20)) {
+                fwrite(json.data(), 1, json.size(), file);
+                json.clear();
+            }
+        }
+    }
+    json += "\n]}\n";
+    fwrite(json.data(), 1, json.size(), file);
+    return fclose(file) == 0;
+}
+
+void resetProfile() {
+    ProfileRegistry& reg = registry();
+    lock_guard<mutex> lock(reg.guard);
+    for (const auto& thread : reg.threads) {
+        thread->stats.clear();
+        thread->events.clear();
+        thread->droppedEvents = 0;
+    }
+}
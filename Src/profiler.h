@@ -0,0 +1,86 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+// Hot-path instrumentation: scoped timers with per-scope counters, reported as a summary
+// table and as a Chrome trace (chrome://tracing, Perfetto). Profiling is off until
+// enableProfiling(true); while off, a scope or a counter costs one relaxed atomic load
+// and nothing more. Building with -DPHARMACY_NO_PROFILING removes the scopes entirely.
+//
+// Times are inclusive (a scope's time contains its nested scopes). Counters are added to
+// the innermost open scope of the calling thread only. Allocations (operator new calls)
+// are counted per thread and process-wide while profiling is on; scopes report the
+// per-thread count inclusively.
+
+enum class ProfileCounter {
+    RowsScanned,
+    CellsUpdated,
+    BytesRead,
+    BytesWritten,
+    Count
+};
+const int kProfileCounterCount = static_cast<int>(ProfileCounter::Count);
+
+extern std::atomic<bool> gProfilingEnabled;
+
+inline bool profilingEnabled() { return gProfilingEnabled.load(std::memory_order_relaxed); }
+
+// Turns recording on or off. Data recorded so far is kept.
+void enableProfiling(bool enabled);
+
+// operator new calls made by the calling thread while profiling was on
+uint64_t threadAllocationCount();
+
+// operator new calls made by every thread while profiling was on, the pool workers included
+uint64_t processAllocationCount();
+
+// Adds to a counter of the innermost open scope on this thread (ignored outside any scope)
+void addToOpenScope(ProfileCounter counter, uint64_t amount);
+inline void profileCount(ProfileCounter counter, uint64_t amount) {
+    if (profilingEnabled()) addToOpenScope(counter, amount);
+}
+
+// Times the enclosing block. Use through PROFILE_SCOPE with a string literal name.
+class ProfileScope {
+public:
+    explicit ProfileScope(const char* name) {
+        if (profilingEnabled()) begin(name);
+    }
+    ~ProfileScope() {
+        if (name_ != nullptr) end();
+    }
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    friend void addToOpenScope(ProfileCounter counter, uint64_t amount);
+    void begin(const char* name);
+    void end();
+
+    const char* name_ = nullptr;
+    ProfileScope* parent_ = nullptr;
+    int64_t startNs_ = 0;
+    uint64_t allocationsAtStart_ = 0;
+    uint64_t counters_[kProfileCounterCount] = {};
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#ifdef PHARMACY_NO_PROFILING
+#define PROFILE_SCOPE(name) ((void)0)
+#else
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#endif
+
+// Reports. Call them when no instrumented work is running on other threads.
+
+// Per-scope table (calls, total/mean/max time, counters), slowest total first
+void printProfileSummary(std::ostream& out);
+
+// Writes every recorded scope as a Chrome trace event file. Returns true if successful.
+bool writeProfileTrace(const std::string& path);
+
+// Drops everything recorded so far
+void resetProfile();
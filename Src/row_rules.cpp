@@ -0,0 +1,207 @@
+#include "row_rules.h"
+#include "profiler.h"
+#include "text_utils.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <deque>
+using namespace std;
+
+namespace {
+
+const size_t kRowsPerBlock = 4096;
+
+uint64_t lowBits(size_t count) {
+    return count >= 64 ? ~0ull : (1ull << count) - 1;
+}
+
+} // namespace
+
+PatternSet::PatternSet() {
+    build();
+}
+
+int PatternSet::add(string_view pattern, bool caseSensitive) {
+    if (pattern.empty() || (int)patterns_.size() >= kMaxPatterns) return -1;
+    patterns_.push_back({string(pattern), caseSensitive});
+    build();
+    return static_cast<int>(patterns_.size()) - 1;
+}
+
+// Trie of the folded patterns, then the failure links filled in breadth-first so every
+// state has a transition for every byte and scanning never backtracks
+void PatternSet::build() {
+    array<int32_t, 256> none;
+    none.fill(-1);
+    next_.assign(1, none);
+    output_.assign(1, 0);
+    caseSensitive_ = 0;
+    shortest_ = patterns_.empty() ? 0 : patterns_[0].text.size();
+    for (size_t id = 0; id < patterns_.size(); ++id) {
+        int32_t state = 0;
+        for (char c : patterns_[id].text) {
+            unsigned char byte = static_cast<unsigned char>(asciiLower(c));
+            if (next_[state][byte] < 0) {
+                next_[state][byte] = static_cast<int32_t>(next_.size());
+                next_.push_back(none);
+                output_.push_back(0);
+            }
+            state = next_[state][byte];
+        }
+        output_[state] |= 1ull << id;
+        shortest_ = min(shortest_, patterns_[id].text.size());
+        if (patterns_[id].caseSensitive) caseSensitive_ |= 1ull << id;
+    }
+
+    vector<int32_t> fail(next_.size(), 0);
+    deque<int32_t> queue;
+    for (int byte = 0; byte < 256; ++byte) {
+        int32_t child = next_[0][byte];
+        if (child < 0) {
+            next_[0][byte] = 0;
+        } else {
+            queue.push_back(child);
+        }
+    }
+    while (!queue.empty()) {
+        int32_t state = queue.front();
+        queue.pop_front();
+        output_[state] |= output_[fail[state]];
+        for (int byte = 0; byte < 256; ++byte) {
+            int32_t child = next_[state][byte];
+            if (child < 0) {
+                next_[state][byte] = next_[fail[state]][byte];
+            } else {
+                fail[child] = next_[fail[state]][byte];
+                queue.push_back(child);
+            }
+        }
+    }
+
+    // Upper-case letters take the lower-case transitions, so scanning needs no folding
+    for (auto& transitions : next_) {
+        for (int byte = 'A'; byte <= 'Z'; ++byte) transitions[byte] = transitions[byte - 'A' + 'a'];
+    }
+    for (int byte = 0; byte < 256; ++byte) startByte_[byte] = next_[0][byte] != 0;
+}
+
+uint64_t PatternSet::scan(string_view text, uint64_t wanted) const {
+    wanted &= lowBits(patterns_.size());
+    if (wanted == 0 || text.size() < shortest_) return 0; // most cells are shorter than any pattern
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(text.data());
+    size_t length = text.size();
+    uint64_t found = 0;
+    int32_t state = 0;
+    for (size_t i = 0; i < length; ++i) {
+        // From the root, skip straight to the next byte that can start a pattern
+        if (state == 0) {
+            while (i < length && !startByte_[bytes[i]]) ++i;
+            if (i == length) break;
+        }
+        state = next_[state][bytes[i]];
+        uint64_t hits = output_[state] & wanted & ~found;
+        if (hits == 0) continue;
+
+        uint64_t exact = hits & caseSensitive_;
+        found |= hits & ~exact;
+        for (int id = 0; exact != 0; ++id, exact >>= 1) {
+            if (!(exact & 1)) continue;
+            const string& pattern = patterns_[id].text;
+            if (text.compare(i + 1 - pattern.size(), pattern.size(), pattern) == 0) found |= 1ull << id;
+        }
+        if (found == wanted) break;
+    }
+    return found;
+}
+
+bool RowRules::add(const RowRule& rule) {
+    if (patterns_.add(rule.pattern, rule.caseSensitive) < 0) return false;
+    uint64_t bit = 1ull << rules_.size();
+    if (rule.column < 0) {
+        anyCellRules_ |= bit;
+    } else {
+        if ((size_t)rule.column >= columnRules_.size()) columnRules_.resize(rule.column + 1, 0);
+        columnRules_[rule.column] |= bit;
+    }
+    rules_.push_back(rule);
+    return true;
+}
+
+// Each row's cells are scanned left to right for the rules not yet matched, and the row
+// is done once every rule has matched
+vector<uint64_t> RowRules::match(const SheetData& sheet, size_t firstRow) const {
+    PROFILE_SCOPE("RowRules::match");
+    profileCount(ProfileCounter::RowsScanned, sheet.size());
+    vector<uint64_t> matches(sheet.size(), 0);
+    if (rules_.empty()) return matches;
+    uint64_t all = lowBits(rules_.size());
+    size_t blocks = (sheet.size() + kRowsPerBlock - 1) / kRowsPerBlock;
+    ThreadPool::shared().parallelFor(blocks, [&](size_t block) {
+        size_t end = min(sheet.size(), (block + 1) * kRowsPerBlock);
+        for (size_t i = max(firstRow, block * kRowsPerBlock); i < end; ++i) {
+            const SheetRow& row = sheet[i];
+            size_t width = anyCellRules_ ? row.size() : min(row.size(), columnRules_.size());
+            uint64_t found = 0;
+            for (size_t c = 0; c < width && found != all; ++c) {
+                uint64_t wanted = columnRules(c) & ~found;
+                if (wanted) found |= patterns_.scan(row[c], wanted);
+            }
+            matches[i] = found;
+        }
+    });
+    return matches;
+}
+
+// Within each block of rows the columns are scanned one after another, each a run of
+// lengths and offsets in a row: a cell shorter than every pattern is skipped on its
+// length alone, and a row's cells are skipped once all of its rules have matched
+vector<uint64_t> RowRules::match(const Sheet& sheet, size_t firstRow) const {
+    PROFILE_SCOPE("RowRules::match");
+    profileCount(ProfileCounter::RowsScanned, sheet.rowCount());
+    vector<uint64_t> matches(sheet.rowCount(), 0);
+    if (rules_.empty()) return matches;
+    size_t width = anyCellRules_ ? sheet.columnCount() : min(sheet.columnCount(), columnRules_.size());
+    size_t blocks = (sheet.rowCount() + kRowsPerBlock - 1) / kRowsPerBlock;
+    ThreadPool::shared().parallelFor(blocks, [&](size_t block) {
+        size_t begin = max(firstRow, block * kRowsPerBlock);
+        size_t end = min(sheet.rowCount(), (block + 1) * kRowsPerBlock);
+        for (size_t c = 0; c < width; ++c) {
+            uint64_t rules = columnRules(c);
+            if (!rules) continue;
+            const StringColumn& column = sheet.column(c).text;
+            for (size_t i = begin; i < end; ++i) {
+                uint64_t wanted = rules & ~matches[i];
+                if (!wanted || column.length(i) < patterns_.shortest() || !sheet.hasCell(i, c)) continue;
+                matches[i] |= patterns_.scan(column.get(i), wanted);
+            }
+        }
+    });
+    return matches;
+}
+
+vector<int> RowRules::apply(SheetData& sheet, size_t firstRow) const {
+    vector<uint64_t> matches = match(sheet, firstRow);
+    vector<int> counts(rules_.size(), 0);
+    for (size_t i = firstRow; i < sheet.size(); ++i) {
+        uint64_t found = matches[i];
+        for (size_t r = 0; found != 0; ++r, found >>= 1) {
+            if (!(found & 1) || (int)sheet[i].size() <= rules_[r].target) continue;
+            sheet[i][rules_[r].target] = rules_[r].value;
+            counts[r]++;
+        }
+    }
+    return counts;
+}
+
+vector<int> RowRules::apply(Sheet& sheet, size_t firstRow) const {
+    vector<uint64_t> matches = match(sheet, firstRow);
+    vector<int> counts(rules_.size(), 0);
+    for (size_t i = firstRow; i < sheet.rowCount(); ++i) {
+        uint64_t found = matches[i];
+        for (size_t r = 0; found != 0; ++r, found >>= 1) {
+            if (!(found & 1) || (int)sheet.rowWidth(i) <= rules_[r].target) continue;
+            sheet.setText(i, rules_[r].target, rules_[r].value);
+            counts[r]++;
+        }
+    }
+    return counts;
+}
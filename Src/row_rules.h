@@ -0,0 +1,88 @@
+#pragma once
+#include "sheet.h"
+#include "sheet_data.h"
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Set of up to 64 patterns searched for together in one pass over a text (Aho-Corasick).
+// The automaton runs over ASCII-lowercased bytes, so patterns match case-insensitively
+// like containsIgnoreCase; a case-sensitive pattern is checked against the original bytes
+// where the folded search found it. Adding a pattern rebuilds the automaton, which is
+// meant to happen once when the rules are set up.
+class PatternSet {
+public:
+    static const int kMaxPatterns = 64;
+
+    PatternSet();
+
+    // Adds a non-empty pattern and returns its id (its bit in scan's result), or -1 if the
+    // pattern is empty or the set is full
+    int add(std::string_view pattern, bool caseSensitive = false);
+    size_t size() const { return patterns_.size(); }
+    // Length of the shortest pattern: no shorter text can match
+    size_t shortest() const { return shortest_; }
+
+    // Bit i is set when pattern i occurs in text. Only the patterns in wanted are looked
+    // for, and the scan stops as soon as all of them have been found.
+    uint64_t scan(std::string_view text, uint64_t wanted = ~0ull) const;
+
+private:
+    struct Pattern {
+        std::string text;
+        bool caseSensitive;
+    };
+    void build();
+
+    std::vector<Pattern> patterns_;
+    std::vector<std::array<int32_t, 256>> next_; // complete transition table per state
+    std::vector<uint64_t> output_;               // patterns ending at each state
+    uint64_t caseSensitive_ = 0;                 // patterns checked against the original bytes
+    size_t shortest_ = 0;                        // length of the shortest pattern
+    bool startByte_[256];                        // bytes that leave the root state
+};
+
+// "If a cell of the row contains pattern, set column target to value": the searched cell is
+// column (or any cell of the row when column is -1). Rows narrower than target are matched
+// but not changed, as the operations never widen a row.
+struct RowRule {
+    std::string pattern;
+    int column = -1;
+    int target = 0;
+    std::string value;
+    bool caseSensitive = false;
+};
+
+// Row rules evaluated together: every cell the rules look at is read once, whatever the
+// number of rules, so another category rule adds no pass over the sheet. Rows are split into
+// blocks run on the pool; a row's rules only read and write that row.
+class RowRules {
+public:
+    // Returns false if there are already PatternSet::kMaxPatterns rules
+    bool add(const RowRule& rule);
+    size_t size() const { return rules_.size(); }
+    const RowRule& rule(size_t i) const { return rules_[i]; }
+
+    // Bit i of result[row] is set when rule i matches the row. Rows before firstRow (the
+    // header) are left at 0.
+    std::vector<uint64_t> match(const SheetData& sheet, size_t firstRow = 1) const;
+    // Same over a columnar sheet, one column at a time
+    std::vector<uint64_t> match(const Sheet& sheet, size_t firstRow = 1) const;
+
+    // Sets the target cell of every matching rule (in rule order) and returns the number of
+    // rows each rule changed
+    std::vector<int> apply(SheetData& sheet, size_t firstRow = 1) const;
+    std::vector<int> apply(Sheet& sheet, size_t firstRow = 1) const;
+
+private:
+    uint64_t columnRules(size_t col) const {
+        return anyCellRules_ | (col < columnRules_.size() ? columnRules_[col] : 0);
+    }
+
+    std::vector<RowRule> rules_;
+    PatternSet patterns_;               // pattern i belongs to rule i
+    uint64_t anyCellRules_ = 0;         // rules with column -1
+    std::vector<uint64_t> columnRules_; // rules searching one column, by column
+};
@@ -0,0 +1,421 @@
+#include "server.h"
+#include "batch_mode.h"
+#include "bulk_update.h"
+#include "file_handler.h"
+#include "logger.h"
+#include "operations.h"
+#include "product_search.h"
+#include "sheet_import.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include <iostream>
+#include <string>
+#include <vector>
+using namespace std;
+
+#ifdef _WIN32
+
+int runServeCommand(int, char*[]) {
+    cerr << "Error: serve needs Unix domain sockets and is not available in Windows builds\n";
+    return BatchUsageError;
+}
+
+#else
+
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <unordered_map>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t kMaxRequestBytes = 64 * 1024;
+const size_t kSearchLimit = 20;
+
+struct ServeOptions {
+    string stockPath, pricePath, appPath, logPath, snapshotDir;
+    string socketPath = "pharmacy.sock";
+};
+
+// Sheets and lookups shared by the client threads. Lookups and searches hold mutex
+// shared; updates hold it exclusive for the one cell they write (and the occasional
+// compaction of its sheet, see compactIfGrown). A sync holds it shared while it works on
+// a copy of the App Sheet and exclusive only to swap the copy in, so lookups keep being
+// answered while it runs (updates wait for it).
+struct ServerState {
+    shared_mutex mutex;
+    std::mutex syncMutex; // one sync or save at a time: they share the change set and the pool
+    SheetData stockSheet, priceSheet, appSheet;
+    SheetIndex stockIndex, priceIndex; // Stock code 0, Price الكود 14 (no rows are added or removed)
+    ProductSearch search;
+    SyncChangeSet changes;
+    string stockPath, pricePath, appPath; // where save writes the sheets
+    size_t stockArenaBytes = 0, priceArenaBytes = 0; // at load or the last compaction
+    atomic<size_t> requests{0};
+};
+
+// Open connections and their threads. A socket is closed only after its thread is
+// joined, so its number cannot be reused while it is still listed.
+struct ClientList {
+    std::mutex mutex;
+    unordered_map<int, thread> threads; // by socket
+    vector<int> finished;               // sockets whose thread has returned
+};
+
+// Joins the threads of the connections that have ended and closes their sockets
+void reapClients(ClientList& clients) {
+    vector<pair<int, thread>> ended;
+    {
+        lock_guard<std::mutex> lock(clients.mutex);
+        for (int client : clients.finished) {
+            auto entry = clients.threads.find(client);
+            ended.emplace_back(client, std::move(entry->second));
+            clients.threads.erase(entry);
+        }
+        clients.finished.clear();
+    }
+    for (auto& entry : ended) {
+        entry.second.join();
+        close(entry.first);
+    }
+}
+
+atomic<bool> gStopRequested{false};
+
+void onStopSignal(int) {
+    gStopRequested = true;
+}
+
+bool parseOptions(int argc, char* argv[], ServeOptions& options) {
+    for (int i = 2; i < argc; ++i) {
+        string arg = argv[i];
+        string* target = nullptr;
+        if (arg == "--stock") target = &options.stockPath;
+        else if (arg == "--price") target = &options.pricePath;
+        else if (arg == "--app") target = &options.appPath;
+        else if (arg == "--socket") target = &options.socketPath;
+        else if (arg == "--log") target = &options.logPath;
+        else if (arg == "--snapshot-dir") target = &options.snapshotDir;
+        else {
+            cerr << "Error: Unknown option " << arg << "\n";
+            return false;
+        }
+        if (i + 1 >= argc) {
+            cerr << "Error: " << arg << " needs a value\n";
+            return false;
+        }
+        *target = argv[++i];
+    }
+    if (options.stockPath.empty() || options.pricePath.empty() || options.appPath.empty()) {
+        cerr << "Error: serve needs --stock, --price and --app\n";
+        return false;
+    }
+    if (options.socketPath.empty() || options.socketPath.size() >= sizeof(sockaddr_un().sun_path)) {
+        cerr << "Error: --socket needs a path shorter than " << sizeof(sockaddr_un().sun_path) << " bytes\n";
+        return false;
+    }
+    return true;
+}
+
+// Cell of a row as one reply field: "" if the row is shorter, tabs and line breaks as spaces
+string field(const SheetRow& row, int col) {
+    if (col >= (int)row.size()) return string();
+    string text(row[col]);
+    for (char& c : text) {
+        if (c == '\t' || c == '\n' || c == '\r') c = ' ';
+    }
+    return text;
+}
+
+string trimmed(const string& text) {
+    size_t first = text.find_first_not_of(" \t\r");
+    if (first == string::npos) return string();
+    size_t last = text.find_last_not_of(" \t\r");
+    return text.substr(first, last - first + 1);
+}
+
+string lookupReply(const SheetData& sheet, int row, int codeCol, int valueCol) {
+    if (row == -1) return "ERR code not found\n";
+    const SheetRow& cells = sheet[row];
+    return "OK 1\n" + field(cells, codeCol) + '\t' + field(cells, 1) + '\t' + field(cells, valueCol) + '\n';
+}
+
+string searchReply(ServerState& state, const string& query) {
+    if (query.empty()) return "ERR search needs a query\n";
+    shared_lock<shared_mutex> lock(state.mutex);
+    vector<SearchHit> hits = state.search.search(query, kSearchLimit);
+    string reply = "OK " + to_string(hits.size()) + "\n";
+    for (const SearchHit& hit : hits) {
+        const char* match = hit.kind == SearchHit::ExactCode ? "code" : hit.kind == SearchHit::CodePrefix ? "prefix" : "name";
+        string prefix = to_string(hit.row) + '\t' + match + '\t' + to_string(hit.similarity) + '\t';
+        if (hit.sheet == SearchSheet::Stock) {
+            const SheetRow& row = state.stockSheet[hit.row];
+            reply += "stock\t" + prefix + field(row, 0) + '\t' + field(row, 1) + "\t\t" + field(row, 21) + '\n';
+        } else if (hit.sheet == SearchSheet::Price) {
+            const SheetRow& row = state.priceSheet[hit.row];
+            reply += "price\t" + prefix + field(row, 15) + '\t' + field(row, 1) + '\t' + field(row, 8) + "\t\n";
+        } else {
+            const SheetRow& row = state.appSheet[hit.row];
+            reply += "app\t" + prefix + field(row, 8) + '\t' + field(row, 1) + '\t' + field(row, 9) + '\t' +
+                     field(row, 27) + '\n';
+        }
+    }
+    return reply;
+}
+
+// Updates edit the Stock and Price Sheets in place, and a value that outgrows its cell
+// leaves the old text in the sheet's arena. Once the arena has doubled since the sheet was
+// loaded or last compacted, the sheet is copied into a fresh one (the App Sheet needs none:
+// every sync replaces it with a fresh copy). Called holding mutex exclusive; the indexes
+// and the change set keep copies of the codes, not views.
+void compactIfGrown(SheetData& sheet, size_t& arenaBytes) {
+    if (sheet.arena().bytesReserved() <= 2 * arenaBytes) return;
+    sheet.compact();
+    arenaBytes = sheet.arena().bytesReserved();
+}
+
+// "CODE VALUE": the value is the last word, so codes may hold spaces
+string updateReply(ServerState& state, const string& args, BulkTarget target) {
+    size_t split = args.find_last_of(" \t");
+    if (split == string::npos) return "ERR usage: update-" + string(target == BulkTarget::Stock ? "stock" : "price") +
+                                      " CODE VALUE\n";
+    BulkUpdate update;
+    update.code = trimmed(args.substr(0, split));
+    update.value = args.substr(split + 1);
+    UpdateStatus status;
+    {
+        unique_lock<shared_mutex> lock(state.mutex);
+        bool stock = target == BulkTarget::Stock;
+        SheetData& sheet = stock ? state.stockSheet : state.priceSheet;
+        status = applyUpdate(sheet, stock ? state.stockIndex : state.priceIndex, target, update, &state.changes);
+        if (status == UpdateStatus::Applied) {
+            compactIfGrown(sheet, stock ? state.stockArenaBytes : state.priceArenaBytes);
+        }
+    }
+    if (status == UpdateStatus::Invalid) return "ERR invalid value " + update.value + "\n";
+    if (status == UpdateStatus::Unmatched) return "ERR code not found\n";
+    return "OK 0\n";
+}
+
+string syncReply(ServerState& state) {
+    lock_guard<std::mutex> syncLock(state.syncMutex);
+    SheetData appSheet;
+    {
+        // Updates wait until the copy is synced; lookups and searches go on reading the
+        // current App Sheet
+        shared_lock<shared_mutex> lock(state.mutex);
+        appSheet = state.appSheet;
+        if (!syncAppSheet(appSheet, state.stockSheet, state.priceSheet, state.changes)) {
+            return "ERR the sheets could not be synchronized\n";
+        }
+    }
+    {
+        unique_lock<shared_mutex> lock(state.mutex);
+        state.appSheet.swap(appSheet);
+    }
+    return "OK 0\n"; // the previous App Sheet is freed here, outside the lock
+}
+
+string saveReply(ServerState& state) {
+    lock_guard<std::mutex> syncLock(state.syncMutex);
+    shared_lock<shared_mutex> lock(state.mutex);
+    if (!writeCSVs({{state.stockPath, &state.stockSheet}, {state.pricePath, &state.priceSheet},
+                    {state.appPath, &state.appSheet}})) {
+        return "ERR one or more sheets could not be saved\n";
+    }
+    return "OK 0\n";
+}
+
+string handleRequest(ServerState& state, const string& line, bool& quit) {
+    state.requests++;
+    string request = trimmed(line);
+    size_t space = request.find_first_of(" \t");
+    string command = request.substr(0, space);
+    string args = space == string::npos ? string() : trimmed(request.substr(space + 1));
+    if (command == "stock" || command == "price") {
+        bool stock = command == "stock";
+        shared_lock<shared_mutex> lock(state.mutex);
+        return stock ? lookupReply(state.stockSheet, state.stockIndex.find(args), 0, 21)
+                     : lookupReply(state.priceSheet, state.priceIndex.find(args), 14, 8);
+    }
+    if (command == "search") return searchReply(state, args);
+    if (command == "update-stock") return updateReply(state, args, BulkTarget::Stock);
+    if (command == "update-price") return updateReply(state, args, BulkTarget::Price);
+    if (command == "sync") return syncReply(state);
+    if (command == "save") return saveReply(state);
+    if (command == "ping") return "OK 0\n";
+    if (command == "quit") {
+        quit = true;
+        return "OK 0\n";
+    }
+    return "ERR unknown request " + command + "\n";
+}
+
+bool sendAll(int socket, const string& data) {
+    size_t sent = 0;
+    while (sent < data.size()) {
+        ssize_t n = send(socket, data.data() + sent, data.size() - sent, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        sent += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+// Answers the requests of one connection in order until the client closes it, sends quit
+// or the server stops. Pipelined requests are answered as they are read.
+void serveClient(ServerState& state, int socket) {
+    string buffer;
+    size_t start = 0;
+    char chunk[4096];
+    bool quit = false;
+    while (!quit) {
+        size_t newline;
+        while (!quit && (newline = buffer.find('\n', start)) != string::npos) {
+            string reply = handleRequest(state, buffer.substr(start, newline - start), quit);
+            start = newline + 1;
+            if (!sendAll(socket, reply)) quit = true;
+        }
+        if (quit) break;
+        buffer.erase(0, start);
+        start = 0;
+        if (buffer.size() > kMaxRequestBytes) {
+            sendAll(socket, "ERR request too long\n");
+            break;
+        }
+        ssize_t n = recv(socket, chunk, sizeof(chunk), 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        buffer.append(chunk, static_cast<size_t>(n));
+    }
+}
+
+// Binds the socket path. A socket file left behind by a server that did not stop cleanly
+// is replaced; one that still accepts connections, or any other kind of file, is not.
+int openListener(const string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    struct stat info;
+    if (lstat(path.c_str(), &info) == 0) {
+        if (!S_ISSOCK(info.st_mode)) {
+            cerr << "Error: " << path << " exists and is not a socket\n";
+            return -1;
+        }
+        int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+        bool inUse = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        if (probe >= 0) close(probe);
+        if (inUse) {
+            cerr << "Error: Another server is listening on " << path << "\n";
+            return -1;
+        }
+        unlink(path.c_str());
+    }
+    int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0 || bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 ||
+        listen(listener, SOMAXCONN) != 0) {
+        cerr << "Error: Could not listen on " << path << ": " << strerror(errno) << "\n";
+        if (listener >= 0) close(listener);
+        return -1;
+    }
+    return listener;
+}
+
+bool loadSheets(const ServeOptions& options, ServerState& state) {
+    const string* paths[] = {&options.stockPath, &options.pricePath, &options.appPath};
+    SheetData* sheets[] = {&state.stockSheet, &state.priceSheet, &state.appSheet};
+    const char* names[] = {"Stock Sheet", "Price Sheet", "App Sheet"};
+    bool loaded[3] = {false, false, false};
+    ThreadPool::shared().parallelFor(3, [&](size_t i) { loaded[i] = readSheet(*paths[i], *sheets[i]); });
+    for (int i = 0; i < 3; ++i) {
+        if (!loaded[i]) {
+            cerr << "Error: Failed to load " << names[i] << " from " << *paths[i] << "\n";
+            return false;
+        }
+        cout << names[i] << " loaded (" << sheets[i]->size() << " rows) from " << *paths[i] << "\n";
+    }
+    // Copy the cells out of the files they were read from: the server saves over those
+    // files for as long as it runs, and a mapped one would keep its old contents on disk
+    ThreadPool::shared().parallelFor(3, [&](size_t i) { sheets[i]->compact(); });
+    state.stockIndex = SheetIndex(state.stockSheet, 0);
+    state.priceIndex = SheetIndex(state.priceSheet, 14);
+    state.search.build(state.stockSheet, state.priceSheet, state.appSheet);
+    state.stockArenaBytes = state.stockSheet.arena().bytesReserved();
+    state.priceArenaBytes = state.priceSheet.arena().bytesReserved();
+    state.stockPath = csvPathFor(options.stockPath);
+    state.pricePath = csvPathFor(options.pricePath);
+    state.appPath = csvPathFor(options.appPath);
+    return true;
+}
+
+} // namespace
+
+int runServeCommand(int argc, char* argv[]) {
+    ServeOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        cerr << "Run pharmacy --help for the options.\n";
+        return BatchUsageError;
+    }
+    if (!options.logPath.empty()) {
+        LoggerOptions logOptions;
+        logOptions.path = options.logPath;
+        configureLogger(logOptions);
+    }
+
+    setSnapshotDirectory(options.snapshotDir);
+
+    ServerState state;
+    if (!loadSheets(options, state)) return BatchLoadError;
+    int listener = openListener(options.socketPath);
+    if (listener < 0) return BatchServeError;
+
+    signal(SIGPIPE, SIG_IGN); // a client that hangs up only ends its own connection
+    signal(SIGINT, onStopSignal);
+    signal(SIGTERM, onStopSignal);
+    logChange("Server started on " + options.socketPath + ".");
+    cout << "Serving on " << options.socketPath << " (Ctrl+C to stop)\n" << flush;
+
+    ClientList clients;
+    while (!gStopRequested) {
+        reapClients(clients);
+        pollfd waiting = {listener, POLLIN, 0};
+        if (poll(&waiting, 1, 250) <= 0) continue;
+        int client = accept(listener, nullptr, nullptr);
+        if (client < 0) continue;
+        // Listed before the thread can report itself finished
+        lock_guard<std::mutex> lock(clients.mutex);
+        clients.threads.emplace(client, thread([&state, &clients, client]() {
+                                    serveClient(state, client);
+                                    lock_guard<std::mutex> lock(clients.mutex);
+                                    clients.finished.push_back(client);
+                                }));
+    }
+
+    close(listener);
+    unlink(options.socketPath.c_str());
+    {
+        // Wake every connection out of recv
+        lock_guard<std::mutex> lock(clients.mutex);
+        for (auto& entry : clients.threads) shutdown(entry.first, SHUT_RDWR);
+    }
+    // Only this thread changes the map, so the threads are joined without the lock
+    for (auto& entry : clients.threads) {
+        entry.second.join();
+        close(entry.first);
+    }
+    cout << "Server stopped after " << state.requests << " requests.\n";
+    logChange("Server stopped after " + to_string(state.requests) + " requests.");
+    flushLog();
+    return BatchOk;
+}
+
+#endif
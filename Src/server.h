@@ -0,0 +1,21 @@
+#pragma once
+
+// Resident server mode for the POS terminals, e.g.
+//   pharmacy serve --stock s.csv --price p.csv --app a.csv --socket /run/pharmacy.sock
+// Loads the three sheets once, keeps them and their code and search indexes in memory and
+// answers local clients over a Unix domain socket, one request per line:
+//   ping                      -> OK 0
+//   stock CODE                -> OK 1, then: code  name  total
+//   price CODE                -> OK 1, then: الكود  name  السعر
+//   search QUERY              -> OK n, then per hit: sheet  row  match  similarity  code  name  price  stock
+//   update-stock CODE VALUE   -> OK 0 (the Stock Sheet total, as menu option 2)
+//   update-price CODE VALUE   -> OK 0 (the Price Sheet السعر, as menu option 3)
+//   sync                      -> OK 0 (menu option 5, incremental after the first one)
+//   save                      -> OK 0 (all three sheets written back, as menu option 8)
+//   quit                      -> closes the connection
+// Fields are tab separated. Errors come back as one line, "ERR message". Lookups and
+// searches never wait for a sync: it runs on a copy of the App Sheet that is swapped in
+// at the end.
+
+// Runs "serve" until SIGINT or SIGTERM and returns a BatchExitCode
+int runServeCommand(int argc, char* argv[]);
@@ -0,0 +1,194 @@
+#include "sheet.h"
+#include "csv_view.h"
+#include "mapped_file.h"
+#include "profiler.h"
+#include "snapshot.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+using namespace std;
+
+namespace {
+
+const size_t kRowsPerTask = 16384; // rows per task when filling a sheet from a file
+
+// Digits with an optional sign, nothing else
+bool parseInt64(string_view text, int64_t& value) {
+    if (text.empty()) return false;
+    from_chars_result result = from_chars(text.data(), text.data() + text.size(), value);
+    return result.ec == errc() && result.ptr == text.data() + text.size();
+}
+
+// A decimal number as the sheets write it ("12", "-3.5", ".5"). Words strtod would also
+// take (nan, inf) and spaces are not numbers here.
+bool parseDouble(string_view text, double& value) {
+    char buf[64];
+    if (text.empty() || text.size() >= sizeof(buf)) return false;
+    char first = text[0] == '-' && text.size() > 1 ? text[1] : text[0];
+    if (!(first >= '0' && first <= '9') && first != '.') return false;
+    memcpy(buf, text.data(), text.size());
+    buf[text.size()] = '\0';
+    char* end = nullptr;
+    value = strtod(buf, &end);
+    return end == buf + text.size();
+}
+
+} // namespace
+
+uint64_t StringColumn::append(string_view value) {
+    if (hasLast_ && string_view(arena_.data() + lastOffset_, lastLength_) == value) return lastOffset_;
+    lastOffset_ = arena_.size();
+    lastLength_ = static_cast<uint32_t>(value.size());
+    hasLast_ = true;
+    arena_.append(value.data(), value.size());
+    return lastOffset_;
+}
+
+void StringColumn::push(string_view value) {
+    offsets_.push_back(append(value) | kOwned);
+    lengths_.push_back(static_cast<uint32_t>(value.size()));
+}
+
+void StringColumn::set(size_t row, string_view value) {
+    offsets_[row] = append(value) | kOwned;
+    lengths_[row] = static_cast<uint32_t>(value.size());
+}
+
+void StringColumn::resetMapped(const char* base, size_t rows) {
+    mapped_ = base;
+    offsets_.assign(rows, 0);
+    lengths_.assign(rows, 0);
+    arena_.clear();
+    hasLast_ = false;
+}
+
+void Sheet::setText(size_t row, size_t col, string_view value) {
+    SheetColumn& column = columns_[col];
+    column.text.set(row, value);
+    if (column.type != ColumnType::Text) parse(column, row);
+}
+
+void Sheet::parse(SheetColumn& column, size_t row) {
+    string_view text = column.text.get(row);
+    if (column.type == ColumnType::Double) column.hasValue[row] = parseDouble(text, column.doubles[row]);
+    else column.hasValue[row] = parseInt64(text, column.ints[row]);
+}
+
+void Sheet::clear() {
+    rowWidths_.clear();
+    columns_.clear();
+    mapping_.reset();
+}
+
+// Numeric columns get their value arrays and are parsed, each on the pool, once all the
+// text is in
+void Sheet::setTypes(const ColumnTypes& types) {
+    ThreadPool::shared().parallelFor(types.size(), [&](size_t t) {
+        int col = types[t].first;
+        if (col < 0 || (size_t)col >= columns_.size() || types[t].second == ColumnType::Text) return;
+        SheetColumn& column = columns_[col];
+        column.type = types[t].second;
+        if (column.type == ColumnType::Double) column.doubles.assign(rowCount(), 0);
+        else column.ints.assign(rowCount(), 0);
+        column.hasValue.assign(rowCount(), 0);
+        for (size_t r = 0; r < rowCount(); ++r) {
+            if (hasCell(r, col)) parse(column, r);
+        }
+    });
+}
+
+void Sheet::assign(const SheetData& data, const ColumnTypes& types) {
+    PROFILE_SCOPE("Sheet::assign");
+    clear();
+    size_t width = 0;
+    rowWidths_.reserve(data.size());
+    for (const SheetRow& row : data) {
+        rowWidths_.push_back(static_cast<uint32_t>(row.size()));
+        width = max(width, row.size());
+    }
+    columns_.resize(width);
+    ThreadPool::shared().parallelFor(width, [&](size_t c) {
+        StringColumn& column = columns_[c].text;
+        column.reserve(data.size());
+        for (const SheetRow& row : data) column.push(c < row.size() ? string_view(row[c]) : string_view());
+    });
+    setTypes(types);
+}
+
+// Blocks of rows are read on the pool in file order, each row's cells going to their
+// columns at the row's index. Cells whose text lies in the mapping stay spans of it; the
+// others (decoded quotes, or all of them where the file cannot stay mapped) are listed
+// and copied into their columns after the loop, as a column's arena takes one writer.
+template <class View>
+void Sheet::assignRows(const View& view, shared_ptr<const MappedFile> mapping, const ColumnTypes& types) {
+    clear();
+    const char* base = nullptr;
+    size_t mappedSize = 0;
+    if (kReplaceableWhileMapped && mapping) {
+        base = mapping->data();
+        mappedSize = mapping->size();
+        mapping_ = std::move(mapping);
+    }
+    size_t width = 0;
+    rowWidths_.reserve(view.rowCount());
+    for (size_t r = 0; r < view.rowCount(); ++r) {
+        rowWidths_.push_back(static_cast<uint32_t>(view.cellCount(r)));
+        width = max(width, view.cellCount(r));
+    }
+    columns_.resize(width);
+    for (SheetColumn& column : columns_) column.text.resetMapped(base, rowCount());
+
+    size_t blocks = (rowCount() + kRowsPerTask - 1) / kRowsPerTask;
+    vector<vector<pair<size_t, size_t>>> copies(blocks); // (row, column)
+    ThreadPool::shared().parallelFor(blocks, [&](size_t block) {
+        size_t end = min(rowCount(), (block + 1) * kRowsPerTask);
+        for (size_t r = block * kRowsPerTask; r < end; ++r) {
+            for (size_t c = 0; c < rowWidths_[r]; ++c) {
+                string_view value = view.cell(r, c);
+                if (base && value.data() >= base && value.data() + value.size() <= base + mappedSize) {
+                    columns_[c].text.setMapped(r, value);
+                } else {
+                    copies[block].push_back({r, c});
+                }
+            }
+        }
+    });
+    for (const auto& block : copies) {
+        for (const auto& cell : block) columns_[cell.second].text.set(cell.first, view.cell(cell.first, cell.second));
+    }
+    setTypes(types);
+}
+
+void Sheet::assign(const CsvView& view, const ColumnTypes& types) {
+    PROFILE_SCOPE("Sheet::assign");
+    assignRows(view, view.mapping(), types);
+}
+
+void Sheet::assign(const SheetSnapshot& snapshot, const ColumnTypes& types) {
+    PROFILE_SCOPE("Sheet::assign");
+    assignRows(snapshot, snapshot.mapping(), types);
+}
+
+// The rows share the mapping: cells still read from it stay spans of it
+void Sheet::toSheetData(SheetData& data) const {
+    PROFILE_SCOPE("Sheet::toSheetData");
+    data.clear();
+    if (mapping_) data.adoptMapping(mapping_);
+    data.resize(rowCount());
+    for (size_t r = 0; r < rowCount(); ++r) {
+        SheetRow& row = data[r];
+        row.reserve(rowWidths_[r]);
+        for (size_t c = 0; c < rowWidths_[r]; ++c) {
+            const StringColumn& column = columns_[c].text;
+            if (mapping_ && !column.owned(r)) row.push_back(SheetCell::mapped(column.get(r), row.get_allocator()));
+            else row.emplace_back(column.get(r));
+        }
+    }
+}
+
+const ColumnTypes& appSheetColumnTypes() {
+    static const ColumnTypes types = {{9, ColumnType::Double}, {25, ColumnType::Int64}, {27, ColumnType::Int64}};
+    return types;
+}
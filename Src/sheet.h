@@ -0,0 +1,136 @@
+#pragma once
+#include "sheet_data.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class CsvView;
+class MappedFile;
+class SheetSnapshot;
+
+enum class ColumnType { Text, Double, Int64 };
+
+// Columns kept as parsed numbers, by column index
+typedef std::vector<std::pair<int, ColumnType>> ColumnTypes;
+
+// Text of one column, cell after cell: a cell is lengths_[row] bytes at offsets_[row],
+// either in the file its sheet was read from (kept mapped, see Sheet) or, once written,
+// in the column's own arena. Writing never moves another cell; the bytes a cell used
+// before stay in the arena. A write of the same text as the previous write shares its
+// bytes, so a step setting many cells to one value ("0", "9000000") adds it once.
+class StringColumn {
+public:
+    size_t size() const { return offsets_.size(); }
+    std::string_view get(size_t row) const {
+        uint64_t offset = offsets_[row];
+        const char* base = (offset & kOwned) ? arena_.data() : mapped_;
+        return std::string_view(base + (offset & ~kOwned), lengths_[row]);
+    }
+    uint32_t length(size_t row) const { return lengths_[row]; }
+    // False while the cell is still read from the mapping
+    bool owned(size_t row) const { return (offsets_[row] & kOwned) != 0; }
+
+    void push(std::string_view value);
+    void set(size_t row, std::string_view value);
+    // Cells of different rows may be set to spans of the mapping from different threads
+    void setMapped(size_t row, std::string_view value) {
+        offsets_[row] = static_cast<uint64_t>(value.data() - mapped_);
+        lengths_[row] = static_cast<uint32_t>(value.size());
+    }
+    void reserve(size_t rows) {
+        offsets_.reserve(rows);
+        lengths_.reserve(rows);
+    }
+    // Makes rows empty cells reading from the mapping at base
+    void resetMapped(const char* base, size_t rows);
+
+private:
+    static const uint64_t kOwned = 1ull << 63; // the offset is into arena_, not the mapping
+    uint64_t append(std::string_view value);
+
+    const char* mapped_ = nullptr;
+    std::vector<uint64_t> offsets_;
+    std::vector<uint32_t> lengths_;
+    std::string arena_;
+    uint64_t lastOffset_ = 0; // the previous write, shared by a repeat of it
+    uint32_t lastLength_ = 0;
+    bool hasLast_ = false;
+};
+
+// One column of a Sheet. A numeric column also keeps each cell parsed in a dense vector
+// (hasValue is 0 where the text is not a plain number: empty, "nan", a word), while the
+// text stays as it was, so the sheet writes back byte for byte.
+struct SheetColumn {
+    ColumnType type = ColumnType::Text;
+    StringColumn text;
+    std::vector<double> doubles;   // ColumnType::Double
+    std::vector<int64_t> ints;     // ColumnType::Int64
+    std::vector<uint8_t> hasValue; // numeric columns
+};
+
+// Column-oriented sheet, for steps that read a few columns of every row or one kind of
+// value across the whole sheet: each column is a dense array, so such a step walks
+// memory in order instead of visiting every row's cells. Holds the same rows as a
+// SheetData, including rows shorter or longer than the header, and converts to and from
+// one (or reads and writes CSV directly, see readCSV and writeCSV) without changing a
+// byte. Every column spans all rows; cells beyond a row's width are absent, not empty.
+//
+// Like SheetData, a sheet loaded from a CSV file or a snapshot keeps the file mapped and
+// its cells read from it until they are written (where kReplaceableWhileMapped allows).
+class Sheet {
+public:
+    // A row, read like a SheetRow
+    class RowView {
+    public:
+        RowView(const Sheet& sheet, size_t row) : sheet_(&sheet), row_(row) {}
+        size_t size() const { return sheet_->rowWidth(row_); }
+        bool empty() const { return size() == 0; }
+        std::string_view operator[](size_t col) const { return sheet_->text(row_, col); }
+
+    private:
+        const Sheet* sheet_;
+        size_t row_;
+    };
+
+    size_t rowCount() const { return rowWidths_.size(); }
+    size_t columnCount() const { return columns_.size(); }
+    size_t rowWidth(size_t row) const { return rowWidths_[row]; }
+    bool hasCell(size_t row, size_t col) const { return col < rowWidths_[row]; }
+
+    const SheetColumn& column(size_t col) const { return columns_[col]; }
+    std::string_view text(size_t row, size_t col) const { return columns_[col].text.get(row); }
+    // Read access shaped like SheetData's, for code written against both
+    size_t size() const { return rowCount(); }
+    bool empty() const { return rowWidths_.empty(); }
+    RowView operator[](size_t row) const { return RowView(*this, row); }
+    RowView back() const { return RowView(*this, rowCount() - 1); }
+
+    // Replaces the text of an existing cell, and its parsed value in a numeric column.
+    // Cells of different columns may be set from different threads at the same time.
+    void setText(size_t row, size_t col, std::string_view value);
+
+    // Copies data's rows, keeping the given columns as numbers too
+    void assign(const SheetData& data, const ColumnTypes& types = ColumnTypes());
+    // Takes a parsed file's rows, adopting its mapping
+    void assign(const CsvView& view, const ColumnTypes& types = ColumnTypes());
+    void assign(const SheetSnapshot& snapshot, const ColumnTypes& types = ColumnTypes());
+    void toSheetData(SheetData& data) const;
+    void clear();
+
+private:
+    template <class View>
+    void assignRows(const View& view, std::shared_ptr<const MappedFile> mapping, const ColumnTypes& types);
+    void setTypes(const ColumnTypes& types);
+    static void parse(SheetColumn& column, size_t row);
+
+    std::vector<uint32_t> rowWidths_;
+    std::vector<SheetColumn> columns_;
+    std::shared_ptr<const MappedFile> mapping_;
+};
+
+// The App Sheet's numeric columns: price (9) as double, max stock (25) and stock (27)
+// as integers
+const ColumnTypes& appSheetColumnTypes();
@@ -0,0 +1,287 @@
+#include "sheet_data.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <new>
+using namespace std;
+
+namespace {
+
+const size_t kFirstChunkBytes = 64 * 1024;
+const size_t kMaxChunkBytes = 64 << 20;
+const size_t kBlockBytes = 16 * 1024;            // handed to one thread at a time
+const size_t kSmallBytes = kBlockBytes / 8;      // larger allocations go straight to a chunk
+const size_t kBlockAlignment = alignof(max_align_t);
+
+atomic<uint64_t> gNextGeneration{1};
+
+// The block this thread is filling, and the arena (generation) it belongs to
+struct ThreadBlock {
+    uint64_t generation = 0;
+    char* pos = nullptr;
+    char* end = nullptr;
+};
+thread_local ThreadBlock tBlock;
+
+char* alignUp(char* p, size_t alignment) {
+    uintptr_t value = reinterpret_cast<uintptr_t>(p);
+    return reinterpret_cast<char*>((value + alignment - 1) & ~(uintptr_t)(alignment - 1));
+}
+
+} // namespace
+
+SheetArena::SheetArena() : generation_(gNextGeneration++) {}
+
+SheetArena::~SheetArena() { release(); }
+
+void SheetArena::reset() {
+    lock_guard<mutex> lock(mutex_);
+    spare_.insert(spare_.end(), chunks_.rbegin(), chunks_.rend());
+    chunks_.clear();
+    usedBytes_ = 0;
+    chunkPos_ = chunkEnd_ = nullptr;
+    generation_ = gNextGeneration++;
+}
+
+void SheetArena::release() {
+    reset();
+    lock_guard<mutex> lock(mutex_);
+    for (const Chunk& chunk : spare_) ::operator delete(chunk.first);
+    spare_.clear();
+    reserved_ = 0;
+}
+
+size_t SheetArena::bytesReserved() const {
+    lock_guard<mutex> lock(mutex_);
+    return reserved_;
+}
+
+void* SheetArena::do_allocate(size_t bytes, size_t alignment) {
+    if (bytes == 0) bytes = 1;
+    if (bytes > kSmallBytes || alignment > kBlockAlignment) {
+        lock_guard<mutex> lock(mutex_);
+        return allocateLocked(bytes, alignment);
+    }
+    ThreadBlock& block = tBlock;
+    if (block.generation == generation_) {
+        char* p = alignUp(block.pos, alignment);
+        if (p + bytes <= block.end) {
+            block.pos = p + bytes;
+            return p;
+        }
+    }
+    char* start;
+    {
+        lock_guard<mutex> lock(mutex_);
+        start = allocateLocked(kBlockBytes, kBlockAlignment);
+        block.generation = generation_;
+    }
+    block.pos = start + bytes;
+    block.end = start + kBlockBytes;
+    return start;
+}
+
+// Takes bytes from the current chunk. When it runs out the next spare chunk is used if the
+// allocation fits in it, or else a new chunk is allocated, growing with the arena. An
+// allocation too big for a regular chunk gets a new one of its own and leaves the current
+// chunk in use.
+char* SheetArena::allocateLocked(size_t bytes, size_t alignment) {
+    char* p = chunkPos_ ? alignUp(chunkPos_, alignment) : nullptr;
+    if (p && p + bytes <= chunkEnd_) {
+        chunkPos_ = p + bytes;
+        return p;
+    }
+    size_t chunkBytes = min(kMaxChunkBytes, max(kFirstChunkBytes, usedBytes_));
+    bool ownChunk = bytes + alignment > chunkBytes / 2;
+    Chunk chunk;
+    if (!ownChunk && !spare_.empty() && spare_.back().second >= bytes + alignment) {
+        chunk = spare_.back();
+        spare_.pop_back();
+    } else {
+        chunk.second = ownChunk ? bytes + alignment : chunkBytes;
+        chunk.first = static_cast<char*>(::operator new(chunk.second));
+        reserved_ += chunk.second;
+    }
+    chunks_.push_back(chunk);
+    usedBytes_ += chunk.second;
+    p = alignUp(chunk.first, alignment);
+    if (!ownChunk) {
+        chunkPos_ = p + bytes;
+        chunkEnd_ = chunk.first + chunk.second;
+    }
+    return p;
+}
+
+// Sharing a mapped span is only safe within one resource (one sheet, which keeps the file
+// mapped); anything else gets its own copy of the bytes
+SheetCell& SheetCell::operator=(const SheetCell& other) {
+    if (this == &other) return *this;
+    if (other.capacity_ == 0 && other.resource_ == resource_) {
+        freeOwned();
+        data_ = other.data_;
+        size_ = other.size_;
+        capacity_ = 0;
+        return *this;
+    }
+    return assign(other.view());
+}
+
+SheetCell& SheetCell::operator=(SheetCell&& other) {
+    if (this == &other) return *this;
+    if (other.resource_ != resource_) return *this = static_cast<const SheetCell&>(other);
+    freeOwned();
+    steal(other);
+    return *this;
+}
+
+// Writes into the cell's own bytes when the text fits, or else into new ones from its
+// resource (a mapped cell always takes this path on its first write)
+SheetCell& SheetCell::assign(string_view text) {
+    if (text.size() <= capacity_) {
+        memmove(const_cast<char*>(data_), text.data(), text.size());
+        size_ = static_cast<uint32_t>(text.size());
+        return *this;
+    }
+    if (text.empty()) {
+        data_ = "";
+        size_ = 0;
+        return *this;
+    }
+    char* bytes = static_cast<char*>(resource_->allocate(text.size(), 1));
+    memcpy(bytes, text.data(), text.size());
+    freeOwned();
+    data_ = bytes;
+    size_ = capacity_ = static_cast<uint32_t>(text.size());
+    return *this;
+}
+
+SheetCell& SheetCell::append(string_view text) {
+    size_t size = size_ + text.size();
+    if (size <= capacity_) {
+        memmove(const_cast<char*>(data_) + size_, text.data(), text.size());
+        size_ = static_cast<uint32_t>(size);
+        return *this;
+    }
+    size_t capacity = max(size, max<size_t>(2 * capacity_, 16));
+    char* bytes = static_cast<char*>(resource_->allocate(capacity, 1));
+    memcpy(bytes, data_, size_);
+    memcpy(bytes + size_, text.data(), text.size());
+    freeOwned();
+    data_ = bytes;
+    size_ = static_cast<uint32_t>(size);
+    capacity_ = static_cast<uint32_t>(capacity);
+    return *this;
+}
+
+SheetCell& SheetCell::erase(size_t pos, size_t count) {
+    count = min<size_t>(count, size_ - pos);
+    if (pos + count == size_) {
+        size_ = static_cast<uint32_t>(pos);
+    } else if (capacity_) {
+        char* bytes = const_cast<char*>(data_);
+        memmove(bytes + pos, bytes + pos + count, size_ - pos - count);
+        size_ -= static_cast<uint32_t>(count);
+    } else if (pos == 0) {
+        data_ += count;
+        size_ -= static_cast<uint32_t>(count);
+    } else {
+        string text(view());
+        text.erase(pos, count);
+        assign(text);
+    }
+    return *this;
+}
+
+void SheetCell::resize(size_t size) {
+    if (size <= size_) size_ = static_cast<uint32_t>(size);
+    else append(string(size - size_, '\0'));
+}
+
+void SheetCell::swap(SheetCell& other) noexcept {
+    if (resource_ == other.resource_) {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        std::swap(capacity_, other.capacity_);
+        return;
+    }
+    SheetCell held(std::move(*this));
+    *this = other;
+    other = held;
+}
+
+void SheetCell::steal(SheetCell& other) noexcept {
+    data_ = other.data_;
+    size_ = other.size_;
+    capacity_ = other.capacity_;
+    other.data_ = "";
+    other.size_ = other.capacity_ = 0;
+}
+
+SheetData::SheetData() : storage_(new Storage) {}
+
+SheetData::SheetData(const SheetData& other) : storage_(new Storage) {
+    copyRows(other);
+}
+
+SheetData::SheetData(SheetData&& other) : storage_(std::move(other.storage_)) {
+    other.storage_.reset(new Storage);
+}
+
+SheetData& SheetData::operator=(const SheetData& other) {
+    if (this != &other) {
+        clear();
+        copyRows(other);
+    }
+    return *this;
+}
+
+SheetData& SheetData::operator=(SheetData&& other) noexcept {
+    swap(other);
+    return *this;
+}
+
+// The copy shares other's mappings, so its mapped cells read from the same spans
+void SheetData::copyRows(const SheetData& other) {
+    storage_->mappings = other.storage_->mappings;
+    Rows& copy = rows();
+    copy.reserve(other.size());
+    for (const SheetRow& row : other) {
+        SheetRow& added = copy.emplace_back();
+        added.reserve(row.size());
+        for (const SheetCell& cell : row) {
+            if (cell.isMapped()) added.push_back(SheetCell::mapped(cell, added.get_allocator()));
+            else added.emplace_back(cell.view());
+        }
+    }
+}
+
+// The old rows are abandoned in place, not destroyed: their memory goes with the arena's
+void SheetData::clear() {
+    storage_->arena.reset();
+    new (&storage_->rows) Rows(&storage_->arena);
+    storage_->mappings.clear();
+}
+
+// Copying the rows vector into the fresh arena copies every cell's bytes
+void SheetData::compact() {
+    SheetData fresh;
+    fresh.rows() = rows();
+    swap(fresh);
+}
+
+void SheetData::release() {
+    storage_->arena.release();
+    new (&storage_->rows) Rows(&storage_->arena);
+    storage_->mappings.clear();
+    storage_->mappings.shrink_to_fit();
+}
+
+void SheetData::adoptMapping(shared_ptr<const MappedFile> file) {
+    storage_->mappings.push_back(std::move(file));
+}
+
+void SheetData::push_back(const vector<string>& row) {
+    SheetRow& added = rows().emplace_back();
+    added.reserve(row.size());
+    for (const string& cell : row) added.emplace_back(cell);
+}
@@ -0,0 +1,278 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <memory>
+#include <memory_resource>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+class MappedFile;
+
+// Monotonic arena holding one sheet's rows and cells: an allocation bumps a pointer, a
+// free does nothing, and everything allocated is dropped at once by reset() (which keeps
+// the chunks for the next load) or release() and the destructor (which free them).
+// Several threads may allocate at the same time (the loaders fill rows in parallel): each
+// thread carves small allocations out of its own block and only locks to get a new one.
+// Nothing is given back before then: a cell rewritten with text that outgrows its buffer
+// leaves the old buffer behind, so a sheet edited in place for good (the resident server)
+// keeps growing unless it is compacted now and then (SheetData::compact).
+class SheetArena : public std::pmr::memory_resource {
+public:
+    SheetArena();
+    ~SheetArena() override;
+    SheetArena(const SheetArena&) = delete;
+    SheetArena& operator=(const SheetArena&) = delete;
+
+    // Drops everything allocated so far but keeps the chunks, so refilling the arena
+    // reuses memory that is already mapped. Anything still pointing into it dangles.
+    void reset();
+    // Same, and frees the chunks
+    void release();
+    // Memory held in chunks, used or spare
+    size_t bytesReserved() const;
+
+private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void*, size_t, size_t) override {}
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    char* allocateLocked(size_t bytes, size_t alignment);
+
+    typedef std::pair<char*, size_t> Chunk;
+    mutable std::mutex mutex_;
+    std::vector<Chunk> chunks_; // in use
+    std::vector<Chunk> spare_;  // kept by reset(), next one to use at the back
+    size_t usedBytes_ = 0;      // size of the chunks in use
+    char* chunkPos_ = nullptr;
+    char* chunkEnd_ = nullptr;
+    size_t reserved_ = 0;       // size of all chunks
+    uint64_t generation_;       // tells the per-thread blocks of this arena (and of each reset) apart
+};
+
+// A cell of a sheet: its text either stays where the loader found it (a span of a CSV
+// file the sheet keeps mapped, see SheetData::adoptMapping) or is owned, in the sheet's
+// arena. Reading never copies; the first write to a mapped cell copies the new text into
+// the arena and later writes reuse those bytes while they fit. Reads like a const
+// std::string (the text is not NUL terminated: there is no c_str()) and converts to
+// std::string_view; writes go through assignment and the few editing members below.
+//
+// Copying a cell within a sheet shares a mapped span; copying it into another sheet (or
+// out of the arena altogether) copies the bytes, since only its own sheet keeps the file
+// mapped.
+class SheetCell {
+public:
+    typedef std::pmr::polymorphic_allocator<char> allocator_type;
+    typedef char value_type;
+    typedef size_t size_type;
+    typedef const char* const_iterator;
+    typedef const_iterator iterator;
+    static constexpr size_t npos = std::string_view::npos;
+
+    SheetCell() noexcept : resource_(std::pmr::get_default_resource()) {}
+    explicit SheetCell(const allocator_type& alloc) noexcept : resource_(alloc.resource()) {}
+    SheetCell(std::string_view text, const allocator_type& alloc = allocator_type()) : resource_(alloc.resource()) {
+        assign(text);
+    }
+    SheetCell(const char* text, const allocator_type& alloc = allocator_type())
+        : SheetCell(std::string_view(text), alloc) {}
+    SheetCell(const std::string& text, const allocator_type& alloc = allocator_type())
+        : SheetCell(std::string_view(text), alloc) {}
+    SheetCell(const char* text, size_t length, const allocator_type& alloc = allocator_type())
+        : SheetCell(std::string_view(text, length), alloc) {}
+    SheetCell(const SheetCell& other) : SheetCell(other, allocator_type()) {}
+    SheetCell(const SheetCell& other, const allocator_type& alloc) : resource_(alloc.resource()) { *this = other; }
+    SheetCell(SheetCell&& other) noexcept : resource_(other.resource_) { steal(other); }
+    SheetCell(SheetCell&& other, const allocator_type& alloc) : resource_(alloc.resource()) {
+        *this = std::move(other);
+    }
+    ~SheetCell() { freeOwned(); }
+
+    // A cell reading text that outlives it (a span of a mapped file, or a literal)
+    static SheetCell mapped(std::string_view text, const allocator_type& alloc) {
+        SheetCell cell(alloc);
+        cell.data_ = text.data();
+        cell.size_ = static_cast<uint32_t>(text.size());
+        return cell;
+    }
+
+    SheetCell& operator=(const SheetCell& other);
+    SheetCell& operator=(SheetCell&& other);
+    SheetCell& operator=(std::string_view text) { return assign(text); }
+    SheetCell& operator=(const char* text) { return assign(std::string_view(text)); }
+    SheetCell& operator=(const std::string& text) { return assign(std::string_view(text)); }
+    SheetCell& assign(std::string_view text);
+    SheetCell& assign(const char* text, size_t length) { return assign(std::string_view(text, length)); }
+    SheetCell& operator+=(std::string_view text) { return append(text); }
+    SheetCell& operator+=(char ch) { return append(std::string_view(&ch, 1)); }
+    SheetCell& append(std::string_view text);
+    void clear() { assign(std::string_view()); }
+    // Cutting a mapped cell's text at either end narrows its span instead of copying it
+    SheetCell& erase(size_t pos, size_t count = npos);
+    void resize(size_t size);
+    void swap(SheetCell& other) noexcept;
+
+    operator std::string_view() const noexcept { return std::string_view(data_, size_); }
+    std::string_view view() const noexcept { return std::string_view(data_, size_); }
+    const char* data() const noexcept { return data_; }
+    size_t size() const noexcept { return size_; }
+    size_t length() const noexcept { return size_; }
+    bool empty() const noexcept { return size_ == 0; }
+    const char* begin() const noexcept { return data_; }
+    const char* end() const noexcept { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+    char front() const { return data_[0]; }
+    char back() const { return data_[size_ - 1]; }
+    // True while the text is still read from where the cell was loaded
+    bool isMapped() const noexcept { return capacity_ == 0 && size_ != 0; }
+
+    size_t find(std::string_view text, size_t pos = 0) const noexcept { return view().find(text, pos); }
+    size_t find(char ch, size_t pos = 0) const noexcept { return view().find(ch, pos); }
+    size_t rfind(char ch, size_t pos = npos) const noexcept { return view().rfind(ch, pos); }
+    size_t find_first_of(std::string_view chars, size_t pos = 0) const noexcept { return view().find_first_of(chars, pos); }
+    size_t find_first_not_of(std::string_view chars, size_t pos = 0) const noexcept {
+        return view().find_first_not_of(chars, pos);
+    }
+    size_t find_last_not_of(std::string_view chars, size_t pos = npos) const noexcept {
+        return view().find_last_not_of(chars, pos);
+    }
+    int compare(std::string_view text) const noexcept { return view().compare(text); }
+    std::string substr(size_t pos, size_t count = npos) const { return std::string(view().substr(pos, count)); }
+
+    allocator_type get_allocator() const noexcept { return allocator_type(resource_); }
+
+    // Found only through a SheetCell operand, so they leave other string comparisons alone
+    friend bool operator==(const SheetCell& a, const SheetCell& b) noexcept { return a.view() == b.view(); }
+    friend bool operator==(const SheetCell& a, std::string_view b) noexcept { return a.view() == b; }
+    friend bool operator==(std::string_view a, const SheetCell& b) noexcept { return a == b.view(); }
+    friend bool operator==(const SheetCell& a, const char* b) noexcept { return a.view() == b; }
+    friend bool operator==(const char* a, const SheetCell& b) noexcept { return a == b.view(); }
+    friend bool operator==(const SheetCell& a, const std::string& b) noexcept { return a.view() == b; }
+    friend bool operator==(const std::string& a, const SheetCell& b) noexcept { return a == b.view(); }
+    friend bool operator!=(const SheetCell& a, const SheetCell& b) noexcept { return !(a == b); }
+    friend bool operator!=(const SheetCell& a, std::string_view b) noexcept { return !(a == b); }
+    friend bool operator!=(std::string_view a, const SheetCell& b) noexcept { return !(a == b); }
+    friend bool operator!=(const SheetCell& a, const char* b) noexcept { return !(a == b); }
+    friend bool operator!=(const char* a, const SheetCell& b) noexcept { return !(a == b); }
+    friend bool operator!=(const SheetCell& a, const std::string& b) noexcept { return !(a == b); }
+    friend bool operator!=(const std::string& a, const SheetCell& b) noexcept { return !(a == b); }
+    friend bool operator<(const SheetCell& a, const SheetCell& b) noexcept { return a.view() < b.view(); }
+    friend std::string operator+(const std::string& a, const SheetCell& b) { return a + std::string(b.view()); }
+    friend std::string operator+(const SheetCell& a, const std::string& b) { return std::string(a.view()) + b; }
+    friend std::string operator+(const char* a, const SheetCell& b) { return a + std::string(b.view()); }
+    friend std::string operator+(const SheetCell& a, const char* b) { return std::string(a.view()) + b; }
+    friend std::ostream& operator<<(std::ostream& out, const SheetCell& cell) { return out << cell.view(); }
+    friend void swap(SheetCell& a, SheetCell& b) noexcept { a.swap(b); }
+
+private:
+    void steal(SheetCell& other) noexcept;
+    void freeOwned() noexcept {
+        if (capacity_) resource_->deallocate(const_cast<char*>(data_), capacity_, 1);
+    }
+
+    const char* data_ = "";
+    uint32_t size_ = 0;
+    uint32_t capacity_ = 0; // bytes owned in resource_; 0 while the text is mapped (or empty)
+    std::pmr::memory_resource* resource_;
+};
+
+// A row of a sheet, allocated from the sheet's arena with its cells
+typedef std::pmr::vector<SheetCell> SheetRow;
+
+// Rows of a loaded sheet, laid out and used like std::vector<std::vector<std::string>>
+// but with every row and cell in one SheetArena owned by the sheet. Loading allocates in
+// big chunks instead of once per row and long cell, and clear() (every reload starts with
+// it) drops them all by rewinding the arena, keeping its memory for the rows that follow,
+// and destruction frees the arena whole: no row or cell destructor runs either way.
+//
+// A sheet read from a CSV file keeps the file mapped and its cells read their text from
+// the mapping (see SheetCell); only the cells written since hold text in the arena. The
+// mapping is dropped with the cells, by clear(), release(), compact() or destruction.
+//
+// Rows and cells may be moved around within a sheet. Moving them to another sheet copies
+// them into its arena; swapping them across sheets is not allowed (swap the sheets instead).
+class SheetData {
+public:
+    typedef std::pmr::vector<SheetRow> Rows;
+    typedef SheetRow value_type;
+    typedef Rows::size_type size_type;
+    typedef Rows::iterator iterator;
+    typedef Rows::const_iterator const_iterator;
+
+    SheetData();
+    SheetData(const SheetData& other);
+    // Takes the arena over; other is left empty with a new one
+    SheetData(SheetData&& other);
+    SheetData& operator=(const SheetData& other);
+    SheetData& operator=(SheetData&& other) noexcept;
+
+    void swap(SheetData& other) noexcept { storage_.swap(other.storage_); }
+
+    // Drops every row and cell at once; the arena keeps its memory for the next load
+    void clear();
+    // Same, and returns the arena's memory
+    void release();
+    // Copies the rows into a fresh arena and frees the old one, with the space that
+    // rewritten cells left behind. Mapped cells are copied as well and the files they
+    // were read from are unmapped. Anything pointing into the sheet dangles.
+    void compact();
+    // Keeps file mapped for as long as the sheet's cells may read from it
+    void adoptMapping(std::shared_ptr<const MappedFile> file);
+    // Files the sheet keeps mapped
+    size_t mappingCount() const { return storage_->mappings.size(); }
+
+    size_t size() const { return rows().size(); }
+    bool empty() const { return rows().empty(); }
+    SheetRow& operator[](size_t row) { return rows()[row]; }
+    const SheetRow& operator[](size_t row) const { return rows()[row]; }
+    SheetRow& front() { return rows().front(); }
+    const SheetRow& front() const { return rows().front(); }
+    SheetRow& back() { return rows().back(); }
+    const SheetRow& back() const { return rows().back(); }
+    iterator begin() { return rows().begin(); }
+    iterator end() { return rows().end(); }
+    const_iterator begin() const { return rows().begin(); }
+    const_iterator end() const { return rows().end(); }
+
+    void reserve(size_t rowCount) { rows().reserve(rowCount); }
+    void resize(size_t rowCount) { rows().resize(rowCount); }
+    void push_back(const SheetRow& row) { rows().push_back(row); }
+    void push_back(SheetRow&& row) { rows().push_back(std::move(row)); }
+    // Appends a copy of a row built outside the sheet
+    void push_back(const std::vector<std::string>& row);
+    template <class... Args>
+    SheetRow& emplace_back(Args&&... args) { return rows().emplace_back(std::forward<Args>(args)...); }
+    void pop_back() { rows().pop_back(); }
+    iterator insert(const_iterator pos, const SheetRow& row) { return rows().insert(pos, row); }
+    iterator erase(const_iterator pos) { return rows().erase(pos); }
+    iterator erase(const_iterator first, const_iterator last) { return rows().erase(first, last); }
+
+    // The row vector itself, e.g. to build a reordered copy in the same arena
+    Rows& rows() { return storage_->rows; }
+    const Rows& rows() const { return storage_->rows; }
+    // An empty row that allocates from this sheet's arena
+    SheetRow newRow() const { return SheetRow(rows().get_allocator()); }
+    const SheetArena& arena() const { return storage_->arena; }
+
+private:
+    void copyRows(const SheetData& other);
+
+    // The arena and the rows in it, and the files mapped cells read from. The rows are
+    // never destroyed one by one: the arena going away takes all of their memory with it.
+    struct Storage {
+        SheetArena arena;
+        std::vector<std::shared_ptr<const MappedFile>> mappings;
+        union {
+            Rows rows;
+        };
+        Storage() { new (&rows) Rows(&arena); }
+        ~Storage() {}
+    };
+
+    std::unique_ptr<Storage> storage_;
+};
+
+inline bool operator==(const SheetData& a, const SheetData& b) { return a.rows() == b.rows(); }
+inline bool operator!=(const SheetData& a, const SheetData& b) { return !(a == b); }
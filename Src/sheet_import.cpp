@@ -0,0 +1,570 @@
+#include "sheet_import.h"
+#include "csv_view.h"
+#include "file_handler.h"
+#include "snapshot.h"
+#include "text_utils.h"
+#include "mapped_file.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+// Minimal pull scanner for HTML and XML markup: steps from tag to tag and exposes the
+// raw text between them. Comments, processing instructions and doctypes are skipped.
+class MarkupScanner {
+public:
+    explicit MarkupScanner(string_view doc) : doc_(doc) {}
+
+    // Advances to the next tag. Returns false at the end of the document.
+    bool next() {
+        size_t textStart = pos_;
+        while (true) {
+            size_t lt = doc_.find('<', pos_);
+            if (lt == string_view::npos) {
+                text_ = doc_.substr(textStart);
+                pos_ = doc_.size();
+                return false;
+            }
+            if (doc_.compare(lt, 4, "<!--") == 0) {
+                // Comments are dropped but the text around them is kept together
+                size_t end = doc_.find("-->", lt + 4);
+                pending_.append(doc_.substr(textStart, lt - textStart));
+                pos_ = textStart = (end == string_view::npos) ? doc_.size() : end + 3;
+                continue;
+            }
+            if (lt + 1 < doc_.size() && (doc_[lt + 1] == '!' || doc_[lt + 1] == '?')) {
+                size_t end = doc_.find('>', lt);
+                pending_.append(doc_.substr(textStart, lt - textStart));
+                pos_ = textStart = (end == string_view::npos) ? doc_.size() : end + 1;
+                continue;
+            }
+            if (pending_.empty()) {
+                text_ = doc_.substr(textStart, lt - textStart);
+            } else {
+                pending_.append(doc_.substr(textStart, lt - textStart));
+                owned_.swap(pending_);
+                pending_.clear();
+                text_ = owned_;
+            }
+            return parseTag(lt);
+        }
+    }
+
+    // Skips everything up to the closing tag of a raw-text element such as <script>
+    void skipRawText(string_view name) {
+        string closing = "</" + string(name);
+        while (pos_ < doc_.size()) {
+            size_t lt = doc_.find("</", pos_);
+            if (lt == string_view::npos) break;
+            if (lt + closing.size() <= doc_.size() && equalsIgnoreCase(doc_.substr(lt, closing.size()), closing)) {
+                pos_ = lt;
+                return;
+            }
+            pos_ = lt + 2;
+        }
+        pos_ = doc_.size();
+    }
+
+    string_view text() const { return text_; }
+    string_view name() const { return name_; }
+    bool closing() const { return closing_; }
+    bool selfClosing() const { return selfClosing_; }
+
+    // Local tag name without an XML namespace prefix
+    string_view localName() const {
+        size_t colon = name_.find(':');
+        return colon == string_view::npos ? name_ : name_.substr(colon + 1);
+    }
+
+    // Returns the raw value of an attribute, or an empty view if it is missing
+    string_view attribute(string_view wanted) const {
+        size_t i = 0;
+        while (i < attrs_.size()) {
+            while (i < attrs_.size() && isspace(static_cast<unsigned char>(attrs_[i]))) ++i;
+            size_t nameStart = i;
+            while (i < attrs_.size() && attrs_[i] != '=' && !isspace(static_cast<unsigned char>(attrs_[i]))) ++i;
+            string_view attrName = attrs_.substr(nameStart, i - nameStart);
+            while (i < attrs_.size() && isspace(static_cast<unsigned char>(attrs_[i]))) ++i;
+            if (i >= attrs_.size() || attrs_[i] != '=') {
+                if (i == nameStart) ++i;
+                continue;
+            }
+            ++i;
+            while (i < attrs_.size() && isspace(static_cast<unsigned char>(attrs_[i]))) ++i;
+            string_view value;
+            if (i < attrs_.size() && (attrs_[i] == '"' || attrs_[i] == '\'')) {
+                char quote = attrs_[i++];
+                size_t end = attrs_.find(quote, i);
+                if (end == string_view::npos) end = attrs_.size();
+                value = attrs_.substr(i, end - i);
+                i = end + 1;
+            } else {
+                size_t start = i;
+                while (i < attrs_.size() && !isspace(static_cast<unsigned char>(attrs_[i]))) ++i;
+                value = attrs_.substr(start, i - start);
+            }
+            if (equalsIgnoreCase(attrName, wanted)) return value;
+        }
+        return string_view();
+    }
+
+private:
+    bool parseTag(size_t lt) {
+        size_t i = lt + 1;
+        closing_ = i < doc_.size() && doc_[i] == '/';
+        if (closing_) ++i;
+        size_t nameStart = i;
+        while (i < doc_.size() && !isspace(static_cast<unsigned char>(doc_[i])) && doc_[i] != '>' && doc_[i] != '/') ++i;
+        name_ = doc_.substr(nameStart, i - nameStart);
+        // Find the end of the tag, ignoring '>' inside quoted attribute values
+        size_t attrStart = i;
+        char quote = 0;
+        while (i < doc_.size() && (quote != 0 || doc_[i] != '>')) {
+            if (quote != 0) {
+                if (doc_[i] == quote) quote = 0;
+            } else if (doc_[i] == '"' || doc_[i] == '\'') {
+                quote = doc_[i];
+            }
+            ++i;
+        }
+        size_t attrEnd = i;
+        selfClosing_ = attrEnd > attrStart && doc_[attrEnd - 1] == '/';
+        if (selfClosing_) --attrEnd;
+        attrs_ = doc_.substr(attrStart, attrEnd - attrStart);
+        pos_ = (i < doc_.size()) ? i + 1 : doc_.size();
+        return true;
+    }
+
+    string_view doc_;
+    size_t pos_ = 0;
+    string_view text_;
+    string_view name_;
+    string_view attrs_;
+    bool closing_ = false;
+    bool selfClosing_ = false;
+    string pending_;
+    string owned_;
+};
+
+void appendUtf8(string& out, unsigned long cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x110000) {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Appends text with character references decoded. With collapseSpace, whitespace runs
+// (including &nbsp;) become one space, as the HTML converter did.
+void appendDecoded(string& out, string_view text, bool collapseSpace) {
+    auto put = [&](char d) {
+        if (collapseSpace && isspace(static_cast<unsigned char>(d))) {
+            if (out.empty() || out.back() != ' ') out += ' ';
+        } else {
+            out += d;
+        }
+    };
+    for (size_t i = 0; i < text.size(); ++i) {
+        char c = text[i];
+        size_t semi = (c == '&') ? text.find(';', i) : string_view::npos;
+        if (semi == string_view::npos || semi - i > 10) {
+            put(c);
+            continue;
+        }
+        string_view entity = text.substr(i + 1, semi - i - 1);
+        string decoded;
+        if (entity == "amp") decoded = "&";
+        else if (entity == "lt") decoded = "<";
+        else if (entity == "gt") decoded = ">";
+        else if (entity == "quot") decoded = "\"";
+        else if (entity == "apos") decoded = "'";
+        else if (entity == "nbsp") decoded = collapseSpace ? " " : "\xC2\xA0";
+        else if (entity.size() > 1 && entity[0] == '#') {
+            bool hex = entity[1] == 'x' || entity[1] == 'X';
+            string digits(entity.substr(hex ? 2 : 1));
+            char* end = nullptr;
+            unsigned long cp = strtoul(digits.c_str(), &end, hex ? 16 : 10);
+            if (!digits.empty() && *end == '\0') appendUtf8(decoded, cp);
+        }
+        if (decoded.empty()) {
+            put(c); // not a known reference: keep the '&' literally
+            continue;
+        }
+        for (char d : decoded) put(d);
+        i = semi;
+    }
+}
+
+string trimSpaces(const string& s) {
+    size_t start = s.find_first_not_of(' ');
+    if (start == string::npos) return "";
+    size_t end = s.find_last_not_of(' ');
+    return s.substr(start, end - start + 1);
+}
+
+// Pads every row with empty cells to the width of the widest row
+void padRows(SheetData& data) {
+    size_t width = 0;
+    for (const auto& row : data) width = max(width, row.size());
+    for (auto& row : data) row.resize(width);
+}
+
+// Column index (0-based) of a cell reference such as "AB12", or -1
+int columnFromReference(string_view ref) {
+    int col = 0;
+    size_t i = 0;
+    for (; i < ref.size() && isalpha(static_cast<unsigned char>(ref[i])); ++i)
+        col = col * 26 + (toupper(static_cast<unsigned char>(ref[i])) - 'A' + 1);
+    return i == 0 ? -1 : col - 1;
+}
+
+// Formats a stored number the way the Python converter printed it: integers unchanged,
+// other values in the shortest form that reads back to the same double
+string formatXlsxNumber(const string& text) {
+    if (text.empty() || text.find_first_not_of("-0123456789") == string::npos) return text;
+    char* end = nullptr;
+    double value = strtod(text.c_str(), &end);
+    if (end != text.c_str() + text.size()) return text;
+    char buf[32];
+    for (int precision = 1; precision <= 17; ++precision) {
+        snprintf(buf, sizeof(buf), "%.*g", precision, value);
+        if (strtod(buf, nullptr) == value) break;
+    }
+    return buf;
+}
+
+// Resolves the path of the first worksheet through workbook.xml and its relationships
+string firstWorksheetPath(const ZipReader& zip) {
+    string workbook, rels;
+    if (zip.read("xl/workbook.xml", workbook) && zip.read("xl/_rels/workbook.xml.rels", rels)) {
+        string relId;
+        MarkupScanner wb(workbook);
+        while (wb.next()) {
+            if (!wb.closing() && wb.localName() == "sheet") {
+                relId = string(wb.attribute("r:id"));
+                break;
+            }
+        }
+        MarkupScanner rs(rels);
+        while (!relId.empty() && rs.next()) {
+            if (rs.closing() || rs.localName() != "Relationship" || rs.attribute("Id") != relId) continue;
+            string target(rs.attribute("Target"));
+            if (!target.empty() && target[0] == '/') return target.substr(1);
+            return "xl/" + target;
+        }
+    }
+    return "xl/worksheets/sheet1.xml";
+}
+
+// Reads the shared strings table (the text of every <si>, rich-text runs joined)
+void readSharedStrings(const ZipReader& zip, vector<string>& strings) {
+    string xml;
+    if (!zip.read("xl/sharedStrings.xml", xml)) return;
+    MarkupScanner scanner(xml);
+    bool inText = false, inPhonetic = false;
+    string current;
+    while (scanner.next()) {
+        if (inText) appendDecoded(current, scanner.text(), false);
+        string_view name = scanner.localName();
+        if (name == "si") {
+            if (scanner.closing()) strings.push_back(current);
+            else if (scanner.selfClosing()) strings.push_back("");
+            current.clear();
+        } else if (name == "rPh") {
+            inPhonetic = !scanner.closing() && !scanner.selfClosing(); // phonetic hints are not cell text
+        } else if (name == "t") {
+            inText = !scanner.closing() && !scanner.selfClosing() && !inPhonetic;
+        }
+    }
+}
+
+// Lowercased extension of the file name (".csv"), or "" if the name has none. A dot in a
+// directory name ("export.html_files/stock.csv") does not count.
+string fileExtension(const string& path) {
+    size_t dot = path.find_last_of('.');
+    size_t slash = path.find_last_of("/\\");
+    if (dot == string::npos || (slash != string::npos && dot < slash)) return "";
+    string extension = path.substr(dot);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension;
+}
+
+// What an .xls export really holds. ERP "Excel" exports are often an HTML table or an
+// .xlsx workbook under the old extension; only a real BIFF workbook needs pandas.
+enum class XlsContent { Html, Xlsx, Biff, Unreadable };
+
+XlsContent sniffXls(const string& path) {
+    MappedFile file;
+    if (!file.open(path)) return XlsContent::Unreadable;
+    string_view head(file.data(), min<size_t>(file.size(), 512));
+    if (head.size() >= 4 && head.compare(0, 4, "PK\x03\x04") == 0) return XlsContent::Xlsx;
+    if (head.size() >= 4 && head.compare(0, 4, "\xD0\xCF\x11\xE0") == 0) return XlsContent::Biff;
+    if (head.compare(0, 3, "\xEF\xBB\xBF") == 0) head.remove_prefix(3);
+    size_t first = head.find_first_not_of(" \t\r\n");
+    return first != string_view::npos && head[first] == '<' ? XlsContent::Html : XlsContent::Biff;
+}
+
+// Converts a binary .xls workbook through html_to_csv_converter.py (pandas), as every
+// import did before the native importers, and reads the CSV it writes
+bool importWithPythonConverter(const string& path, SheetData& data) {
+    error_code ec;
+    filesystem::path temp = filesystem::temp_directory_path(ec);
+    if (ec) temp = ".";
+    string csvPath = (temp / (filesystem::path(path).stem().string() + ".xls-import.csv")).string();
+    const char* interpreters[] = {"python3", "python", "py"};
+    bool converted = false;
+    for (const char* interpreter : interpreters) {
+        string command = string(interpreter) + " html_to_csv_converter.py --single-file \"" + path + "\" \"" + csvPath + "\"";
+        if (system(command.c_str()) == 0) {
+            converted = true;
+            break;
+        }
+    }
+    CsvView view; // not readCSV: the temporary CSV gets no snapshot
+    bool ok = converted && view.open(csvPath);
+    if (ok) view.toSheetData(data);
+    filesystem::remove(csvPath, ec);
+    if (!converted) cerr << "Error: Could not convert " << path << " (binary .xls needs Python with pandas and xlrd)" << endl;
+    return ok;
+}
+
+} // namespace
+
+// Imports the first <table> of an HTML file. Returns true if successful.
+bool importHtmlTable(const string& path, SheetData& data) {
+    MappedFile file;
+    if (!file.open(path)) {
+        cerr << "Error: Could not open file " << path << endl;
+        return false;
+    }
+    data.clear();
+    MarkupScanner scanner(string_view(file.data(), file.size()));
+
+    struct Span { int rowsLeft = 0; string text; };
+    vector<Span> rowSpans; // cells still covering later rows (rowspan)
+    vector<string> row;
+    string cell;
+    int tableDepth = 0, colspan = 1, rowspan = 1;
+    bool inRow = false, inCell = false, done = false;
+
+    auto placeSpanned = [&](bool untilEnd) {
+        while (row.size() < rowSpans.size() && rowSpans[row.size()].rowsLeft > 0) {
+            Span& span = rowSpans[row.size()];
+            span.rowsLeft--;
+            row.push_back(span.text);
+        }
+        if (untilEnd) {
+            for (size_t c = row.size(); c < rowSpans.size(); ++c) {
+                if (rowSpans[c].rowsLeft == 0) continue;
+                row.resize(c);
+                rowSpans[c].rowsLeft--;
+                row.push_back(rowSpans[c].text);
+            }
+        }
+    };
+    auto endCell = [&]() {
+        if (!inCell) return;
+        inCell = false;
+        placeSpanned(false);
+        string value = trimSpaces(cell);
+        for (int i = 0; i < colspan; ++i) {
+            if (rowspan > 1) {
+                if (rowSpans.size() <= row.size()) rowSpans.resize(row.size() + 1);
+                rowSpans[row.size()] = {rowspan - 1, value};
+            }
+            row.push_back(value);
+        }
+    };
+    auto endRow = [&]() {
+        endCell();
+        if (!inRow) return;
+        inRow = false;
+        placeSpanned(true);
+        if (!row.empty()) data.push_back(row);
+        row.clear();
+    };
+
+    while (!done && scanner.next()) {
+        if (inCell) appendDecoded(cell, scanner.text(), true);
+        string_view name = scanner.name();
+        auto is = [&](const char* tag) { return equalsIgnoreCase(name, tag); };
+
+        if (is("script") || is("style")) {
+            if (!scanner.closing() && !scanner.selfClosing()) scanner.skipRawText(name);
+        } else if (is("table")) {
+            if (!scanner.closing()) {
+                tableDepth++;
+            } else if (tableDepth > 0 && --tableDepth == 0) {
+                endRow();
+                done = true;
+            }
+        } else if (tableDepth != 1) {
+            continue; // before the first table, or inside a nested one
+        } else if (is("tr")) {
+            endRow();
+            if (!scanner.closing()) inRow = true;
+        } else if (is("td") || is("th")) {
+            endCell();
+            if (scanner.closing()) continue;
+            if (!inRow) inRow = true;
+            inCell = true;
+            cell.clear();
+            colspan = max(1, atoi(string(scanner.attribute("colspan")).c_str()));
+            rowspan = max(1, atoi(string(scanner.attribute("rowspan")).c_str()));
+        } else if (inCell && (is("br") || is("p") || is("div"))) {
+            cell += ' ';
+        } else if (is("thead") || is("tbody") || is("tfoot")) {
+            endRow();
+        }
+    }
+    if (!done) endRow();
+
+    if (data.empty()) {
+        cerr << "Error: No table found in " << path << endl;
+        return false;
+    }
+    padRows(data);
+    return true;
+}
+
+// Imports the first worksheet of an .xlsx workbook. Returns true if successful.
+bool importXlsxSheet(const string& path, SheetData& data) {
+    ZipReader zip;
+    if (!zip.open(path)) {
+        cerr << "Error: Could not open workbook " << path << endl;
+        return false;
+    }
+    data.clear();
+    vector<string> sharedStrings;
+    readSharedStrings(zip, sharedStrings);
+
+    string sheetPath = firstWorksheetPath(zip);
+    string xml;
+    if (!zip.read(sheetPath, xml)) {
+        cerr << "Error: Could not read worksheet " << sheetPath << " in " << path << endl;
+        return false;
+    }
+
+    MarkupScanner scanner(xml);
+    SheetRow* row = nullptr;
+    string type, value;
+    int col = -1;
+    bool inValue = false, inCell = false;
+    while (scanner.next()) {
+        if (inValue) appendDecoded(value, scanner.text(), false);
+        string_view name = scanner.localName();
+        if (name == "row") {
+            if (scanner.closing()) {
+                row = nullptr;
+                continue;
+            }
+            // Rows are numbered from 1; missing rows are kept as empty rows
+            int number = atoi(string(scanner.attribute("r")).c_str());
+            size_t index = number > 0 ? static_cast<size_t>(number - 1) : data.size();
+            if (index < data.size()) index = data.size();
+            data.resize(index + 1);
+            row = &data[index];
+            if (scanner.selfClosing()) row = nullptr;
+        } else if (name == "c" && row != nullptr) {
+            if (scanner.closing()) {
+                if (!inCell) continue;
+                inCell = false;
+                if (type == "s") {
+                    size_t index = strtoul(value.c_str(), nullptr, 10);
+                    value = index < sharedStrings.size() ? sharedStrings[index] : "";
+                } else if (type == "b") {
+                    value = (value == "1") ? "True" : "False";
+                } else if (type.empty() || type == "n") {
+                    value = formatXlsxNumber(value);
+                }
+                if (col < 0) col = static_cast<int>(row->size());
+                if ((int)row->size() <= col) row->resize(col + 1);
+                (*row)[col] = value;
+                continue;
+            }
+            col = columnFromReference(scanner.attribute("r"));
+            if (col < 0) col = static_cast<int>(row->size());
+            type = string(scanner.attribute("t"));
+            value.clear();
+            inCell = !scanner.selfClosing();
+            if (!inCell && (int)row->size() <= col) row->resize(col + 1);
+        } else if (inCell && (name == "v" || name == "t")) {
+            inValue = !scanner.closing() && !scanner.selfClosing();
+        }
+    }
+
+    if (data.empty()) {
+        cerr << "Error: No data found in " << path << endl;
+        return false;
+    }
+    padRows(data);
+    return true;
+}
+
+// True for the HTML/Excel exports that go through importSheetFile instead of readCSV
+bool isConvertibleFile(const string& filePath) {
+    string extension = fileExtension(filePath);
+    return extension == ".html" || extension == ".htm" || extension == ".xlsx" || extension == ".xls";
+}
+
+// Picks the importer from the file extension; an .xls file by what it contains. Returns
+// true if successful.
+bool importSheetFile(const string& path, SheetData& data) {
+    string extension = fileExtension(path);
+    bool html = extension == ".html" || extension == ".htm";
+    bool xls = extension == ".xls";
+    if (!html && !xls && extension != ".xlsx") {
+        cerr << "Error: Unsupported file format " << extension << " (supported: .html, .htm, .xlsx, .xls)" << endl;
+        return false;
+    }
+    // An export that was already imported in its current state is reloaded from its snapshot
+    if (loadSnapshotFor(path, data)) return true;
+    SourceStamp stamp;
+    bool stamped = snapshotsEnabled() && readSourceStamp(path, stamp);
+    XlsContent content = xls ? sniffXls(path) : html ? XlsContent::Html : XlsContent::Xlsx;
+    if (content == XlsContent::Unreadable) {
+        cerr << "Error: Could not open file " << path << endl;
+        return false;
+    }
+    bool imported = content == XlsContent::Html   ? importHtmlTable(path, data)
+                    : content == XlsContent::Xlsx ? importXlsxSheet(path, data)
+                                                  : importWithPythonConverter(path, data);
+    if (!imported) return false;
+    if (stamped) saveSnapshotFor(path, data, stamp);
+    return true;
+}
+
+bool readSheet(const string& path, SheetData& data) {
+    return isConvertibleFile(path) ? importSheetFile(path, data) : readCSV(path, data);
+}
+
+bool readSheet(const string& path, Sheet& sheet, const ColumnTypes& types) {
+    if (!isConvertibleFile(path)) return readCSV(path, sheet, types);
+    SheetData data;
+    if (!importSheetFile(path, data)) return false;
+    sheet.assign(data, types);
+    return true;
+}
+
+string csvPathFor(const string& path) {
+    return isConvertibleFile(path) ? path.substr(0, path.find_last_of('.')) + ".csv" : path;
+}
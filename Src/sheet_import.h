@@ -0,0 +1,34 @@
+#pragma once
+#include "sheet.h"
+#include "sheet_data.h"
+#include <string>
+#include <vector>
+
+// Native importers for the HTML and XLSX exports of the ERP, replacing the
+// html_to_csv_converter.py round-trip. Both fill data directly (first row is the
+// header) and pad every row to the widest row, as the pandas conversion did.
+
+// Imports the first <table> of an HTML file. Returns true if successful.
+bool importHtmlTable(const std::string& path, SheetData& data);
+
+// Imports the first worksheet of an .xlsx workbook. Returns true if successful.
+bool importXlsxSheet(const std::string& path, SheetData& data);
+
+// True for HTML/Excel exports (.html, .htm, .xlsx, .xls) that need importing instead of readCSV
+bool isConvertibleFile(const std::string& filePath);
+
+// Reads one sheet without prompting: HTML/XLSX exports go through importSheetFile,
+// anything else through readCSV. Returns true if successful.
+bool readSheet(const std::string& path, SheetData& data);
+// Same into a columnar sheet: a CSV file is read straight into its columns, an export
+// is imported and then copied into them
+bool readSheet(const std::string& path, Sheet& sheet, const ColumnTypes& types = ColumnTypes());
+
+// Where a sheet read from path is saved: an imported export as the .csv next to it, a
+// CSV file in place
+std::string csvPathFor(const std::string& path);
+
+// Picks the importer from the file extension (.html, .htm, .xlsx). An .xls file is imported
+// as HTML or XLSX when it is one under the old extension; a binary (BIFF) workbook is
+// converted by html_to_csv_converter.py as before. Returns true if successful.
+bool importSheetFile(const std::string& path, SheetData& data);
@@ -0,0 +1,130 @@
+#include "sheet_index.h"
+#include "profiler.h"
+#include "text_utils.h"
+using namespace std;
+
+NormalizedKey NormalizedKey::of(string_view cell) {
+    NormalizedKey key;
+    string_view trimmed = trimView(cell);
+    if (parseNumber(trimmed, key.number)) {
+        key.kind = Number;
+    } else {
+        key.kind = Text;
+        key.text.assign(trimmed.data(), trimmed.size());
+    }
+    return key;
+}
+
+bool NormalizedKey::parseNumber(string_view trimmed, uint64_t& number) {
+    if (trimmed.empty() || trimmed.size() > 18 || (trimmed[0] == '0' && trimmed.size() > 1)) return false;
+    uint64_t value = 0;
+    for (char c : trimmed) {
+        if (c < '0' || c > '9') return false;
+        value = value * 10 + static_cast<uint64_t>(c - '0');
+    }
+    number = value;
+    return true;
+}
+
+// Build the code index for a sheet. Rows are visited top-down and only the first row
+// holding a code is kept, so lookups return the same row findRowByCode would.
+SheetIndex::SheetIndex(const SheetData& sheet, int codeCol) : codeCol_(codeCol) {
+    keys_.reserve(sheet.size());
+    numberRows_.reserve(sheet.size());
+    appendRows(sheet);
+}
+
+void SheetIndex::appendRows(const SheetData& sheet) {
+    if (keys_.size() >= sheet.size()) return;
+    PROFILE_SCOPE("SheetIndex::build");
+    profileCount(ProfileCounter::RowsScanned, sheet.size() - keys_.size());
+    for (size_t i = keys_.size(); i < sheet.size(); ++i) {
+        addRow((int)sheet[i].size() > codeCol_ ? NormalizedKey::of(sheet[i][codeCol_]) : NormalizedKey());
+    }
+}
+
+void SheetIndex::addRow(NormalizedKey key) {
+    int row = static_cast<int>(keys_.size());
+    if (key.kind == NormalizedKey::Number) numberRows_.emplace(key.number, row);
+    else if (key.kind == NormalizedKey::Text) textRows_.emplace(key.text, row);
+    keys_.push_back(std::move(key));
+}
+
+void SheetIndex::eraseRows(size_t first, size_t count) {
+    first = min(first, keys_.size());
+    count = min(count, keys_.size() - first);
+    keys_.erase(keys_.begin() + first, keys_.begin() + first + count);
+    rebuildLookup();
+}
+
+// Row numbers moved, so the tables are refilled from the kept keys (nothing is re-trimmed)
+void SheetIndex::rebuildLookup() {
+    numberRows_.clear();
+    textRows_.clear();
+    for (size_t i = 0; i < keys_.size(); ++i) {
+        const NormalizedKey& key = keys_[i];
+        if (key.kind == NormalizedKey::Number) numberRows_.emplace(key.number, static_cast<int>(i));
+        else if (key.kind == NormalizedKey::Text) textRows_.emplace(key.text, static_cast<int>(i));
+    }
+}
+
+// Look up a code in the index
+int SheetIndex::find(string_view code) const {
+    string_view trimmed = trimView(code);
+    uint64_t number;
+    if (NormalizedKey::parseNumber(trimmed, number)) {
+        auto it = numberRows_.find(number);
+        return (it == numberRows_.end()) ? -1 : it->second;
+    }
+    auto it = textRows_.find(string(trimmed));
+    return (it == textRows_.end()) ? -1 : it->second;
+}
+
+int SheetIndex::find(const NormalizedKey& key) const {
+    if (key.kind == NormalizedKey::Number) {
+        auto it = numberRows_.find(key.number);
+        return (it == numberRows_.end()) ? -1 : it->second;
+    }
+    if (key.kind == NormalizedKey::Text) {
+        auto it = textRows_.find(key.text);
+        return (it == textRows_.end()) ? -1 : it->second;
+    }
+    return -1;
+}
+
+const SheetIndex& SheetKeys::index(const SheetData& sheet, int col) {
+    auto it = columns_.find(col);
+    if (it == columns_.end()) return columns_.emplace(col, SheetIndex(sheet, col)).first->second;
+    // A sheet shorter than the index lost rows nobody reported: start over
+    if (it->second.rowCount() > sheet.size()) it->second = SheetIndex(sheet, col);
+    else it->second.appendRows(sheet);
+    return it->second;
+}
+
+void SheetKeys::rowsErased(size_t first, size_t count) {
+    for (auto& entry : columns_) entry.second.eraseRows(first, count);
+}
+
+// Cells of a row keep their order when columns are erased, so a key column after the
+// erased range holds the same keys under a smaller number; columns inside it are dropped.
+void SheetKeys::columnsErased(int first, int count) {
+    map<int, SheetIndex> moved;
+    for (auto& entry : columns_) {
+        int col = entry.first;
+        if (col < first) {
+            moved.emplace(col, std::move(entry.second));
+        } else if (col >= first + count) {
+            entry.second.setColumn(col - count);
+            moved.emplace(col - count, std::move(entry.second));
+        }
+    }
+    columns_.swap(moved);
+}
+
+void SheetKeys::columnChanged(int col) {
+    columns_.erase(col);
+}
+
+void SheetKeys::invalidate() {
+    columns_.clear();
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include "sheet_data.h"
+#include <cstdint>
+#include <map>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Normalized form of a code cell: the text with surrounding whitespace trimmed, held as an
+// integer when it is a plain number (1-18 ASCII digits without a leading zero, so "012"
+// and "12" stay different codes). Two cells hold the same code exactly when their keys
+// are equal, and for numeric codes that is an integer comparison.
+struct NormalizedKey {
+    enum Kind : uint8_t { Missing, Number, Text };
+    Kind kind = Missing; // Missing: the row has no cell in the key column
+    uint64_t number = 0;
+    std::string text;    // Text keys only
+
+    static NormalizedKey of(std::string_view cell);
+    // Parses a trimmed code as a plain number. Returns false if it is not one.
+    static bool parseNumber(std::string_view trimmed, uint64_t& number);
+};
+
+// Hash index over one code column of a sheet (normalized code -> first row holding it),
+// with the normalized key of every row kept alongside. Build it once and reuse it for
+// every lookup instead of scanning and trimming the sheet per code.
+class SheetIndex {
+public:
+    SheetIndex() {}
+    SheetIndex(const SheetData& sheet, int codeCol);
+
+    int column() const { return codeCol_; }
+    size_t rowCount() const { return keys_.size(); }
+
+    // Returns the row holding the code, or -1 if it is not in the sheet
+    int find(std::string_view code) const;
+    int find(const NormalizedKey& key) const;
+    // Normalized code of a row
+    const NormalizedKey& key(size_t row) const { return keys_[row]; }
+
+    // Keeping the index in step with the sheet (see SheetKeys)
+    void appendRows(const SheetData& sheet); // rows [rowCount(), sheet.size()) were added
+    void eraseRows(size_t first, size_t count);
+    void setColumn(int codeCol) { codeCol_ = codeCol; }
+
+private:
+    void addRow(NormalizedKey key);
+    void rebuildLookup();
+
+    int codeCol_ = 0;
+    std::vector<NormalizedKey> keys_;
+    std::unordered_map<uint64_t, int> numberRows_;
+    std::unordered_map<std::string, int> textRows_;
+};
+
+// Code indexes kept alongside one sheet, one per key column (stock code 0, price الكود
+// 14/15, app sku 8), built on first use. Rows appended to the sheet (addProduct) are
+// picked up on the next lookup; operations that erase rows or shift and rewrite columns
+// report it here, so the cached keys follow the cells instead of being rebuilt. Any
+// other structural change (sorting, filtering rows, rewriting codes) must call invalidate().
+class SheetKeys {
+public:
+    // Index of column col, brought up to date with rows appended since the last call
+    const SheetIndex& index(const SheetData& sheet, int col);
+
+    void rowsErased(size_t first, size_t count);
+    void columnsErased(int first, int count); // columns after them move left by count
+    void columnChanged(int col);              // the column's cells were rewritten
+    void invalidate();
+
+private:
+    std::map<int, SheetIndex> columns_;
+};
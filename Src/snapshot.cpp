@@ -0,0 +1,268 @@
+#include "snapshot.h"
+#include "profiler.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+using namespace std;
+
+namespace {
+
+const char kMagic[8] = {'P', 'H', 'S', 'N', 'A', 'P', '\r', '\n'};
+const size_t kRowsPerTask = 16384; // rows per task when materializing a large snapshot
+
+const uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+const uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+
+uint64_t rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+uint64_t mixWord(uint64_t acc, uint64_t word) { return rotl(acc + word * kPrime2, 31) * kPrime1; }
+
+size_t align8(size_t n) { return (n + 7) & ~size_t(7); }
+
+string gSnapshotDir; // "" = snapshots off
+
+} // namespace
+
+bool readSourceStamp(const string& path, SourceStamp& stamp) {
+    error_code ec;
+    stamp.size = filesystem::file_size(path, ec);
+    if (ec) return false;
+    auto written = filesystem::last_write_time(path, ec);
+    if (ec) return false;
+    stamp.time = static_cast<int64_t>(written.time_since_epoch().count());
+    return true;
+}
+
+// Four independent multiply-rotate lanes over 8-byte words, so the checksum of a large
+// snapshot runs at memory speed instead of one byte per step
+uint64_t snapshotChecksum(const char* data, size_t size) {
+    uint64_t lanes[4] = {kPrime1 + kPrime2, kPrime2, 0, 0 - kPrime1};
+    size_t i = 0;
+    for (; i + 32 <= size; i += 32) {
+        for (int k = 0; k < 4; ++k) {
+            uint64_t word;
+            memcpy(&word, data + i + 8 * k, 8);
+            lanes[k] = mixWord(lanes[k], word);
+        }
+    }
+    uint64_t hash = rotl(lanes[0], 1) + rotl(lanes[1], 7) + rotl(lanes[2], 12) + rotl(lanes[3], 18);
+    hash += size;
+    for (; i < size; ++i) hash = rotl(hash ^ (static_cast<unsigned char>(data[i]) * kPrime1), 11) * kPrime2;
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+bool SheetSnapshot::open(const string& path) {
+    rowCount_ = 0;
+    file_ = make_shared<MappedFile>();
+    if (!file_->open(path)) return false;
+    const char* data = file_->data();
+    size_t size = file_->size();
+
+    SnapshotHeader header;
+    if (size < sizeof(header)) return false;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kSnapshotVersion ||
+        header.headerSize != sizeof(SnapshotHeader)) {
+        return false;
+    }
+
+    // Section sizes, checked against the file before anything is read through them
+    if (header.rowCount >= UINT32_MAX || header.cellCount >= UINT32_MAX || header.arenaSize >= UINT32_MAX) return false;
+    size_t rowsBytes = align8((header.rowCount + 1) * sizeof(uint32_t));
+    size_t cellsBytes = align8(header.cellCount * sizeof(uint32_t));
+    if (size != sizeof(header) + rowsBytes + cellsBytes + header.arenaSize) return false;
+    if (snapshotChecksum(data + sizeof(header), size - sizeof(header)) != header.checksum) return false;
+
+    rowStart_ = reinterpret_cast<const uint32_t*>(data + sizeof(header));
+    cellEnd_ = reinterpret_cast<const uint32_t*>(data + sizeof(header) + rowsBytes);
+    arena_ = data + sizeof(header) + rowsBytes + cellsBytes;
+    if (rowStart_[0] != 0 || rowStart_[header.rowCount] != header.cellCount) return false;
+    rowCount_ = header.rowCount;
+    profileCount(ProfileCounter::BytesRead, size);
+    return true;
+}
+
+bool SheetSnapshot::open(const string& path, uint64_t sourceSize, int64_t sourceTime) {
+    if (!open(path)) return false;
+    SnapshotHeader header;
+    memcpy(&header, file_->data(), sizeof(header));
+    if (header.sourceSize != sourceSize || header.sourceTime != sourceTime) {
+        rowCount_ = 0;
+        return false;
+    }
+    return true;
+}
+
+string_view SheetSnapshot::cell(size_t row, size_t col) const {
+    size_t index = rowStart_[row] + col;
+    uint32_t begin = index == 0 ? 0 : cellEnd_[index - 1];
+    return string_view(arena_ + begin, cellEnd_[index] - begin);
+}
+
+// Fills data with the snapshot's rows, as spans into the mapping the sheet adopts. As in
+// CsvView, blocks of rows are filled on the shared pool.
+void SheetSnapshot::toSheetData(SheetData& data) const {
+    PROFILE_SCOPE("SheetSnapshot::toSheetData");
+    data.clear();
+    if (kReplaceableWhileMapped) data.adoptMapping(file_);
+    data.resize(rowCount_);
+    size_t tasks = (data.size() + kRowsPerTask - 1) / kRowsPerTask;
+    ThreadPool::shared().parallelFor(tasks, [&](size_t task) {
+        size_t end = min(data.size(), (task + 1) * kRowsPerTask);
+        for (size_t r = task * kRowsPerTask; r < end; ++r) {
+            SheetRow& row = data[r];
+            size_t n = cellCount(r);
+            row.reserve(n);
+            for (size_t c = 0; c < n; ++c) {
+                string_view value = cell(r, c);
+                if (kReplaceableWhileMapped) row.push_back(SheetCell::mapped(value, row.get_allocator()));
+                else row.emplace_back(value);
+            }
+        }
+    });
+}
+
+namespace {
+
+// Writes data (a SheetData or a Sheet) as a snapshot of the file at sourcePath. The
+// snapshot is written to a temporary file and renamed into place, so a reader never maps
+// a half-written one.
+template <class Data>
+bool writeSnapshotOf(const string& path, const Data& data, const string& sourcePath, const SourceStamp& source) {
+    PROFILE_SCOPE("writeSnapshot");
+    SnapshotHeader header;
+    memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kSnapshotVersion;
+    header.headerSize = sizeof(SnapshotHeader);
+    header.sourceSize = source.size;
+    header.sourceTime = source.time;
+    header.rowCount = data.size();
+    header.cellCount = 0;
+    header.arenaSize = 0;
+    for (size_t r = 0; r < data.size(); ++r) {
+        const auto& row = data[r];
+        header.cellCount += row.size();
+        for (size_t c = 0; c < row.size(); ++c) header.arenaSize += string_view(row[c]).size();
+    }
+    if (header.rowCount >= UINT32_MAX || header.cellCount >= UINT32_MAX || header.arenaSize >= UINT32_MAX) return false;
+
+    size_t rowsBytes = align8((header.rowCount + 1) * sizeof(uint32_t));
+    size_t cellsBytes = align8(header.cellCount * sizeof(uint32_t));
+    string body(rowsBytes + cellsBytes + header.arenaSize, '\0');
+    char* rows = &body[0];
+    char* cells = rows + rowsBytes;
+    char* arena = cells + cellsBytes;
+    uint32_t cellIndex = 0, arenaEnd = 0;
+    for (size_t r = 0; r < data.size(); ++r) {
+        const auto& row = data[r];
+        memcpy(rows, &cellIndex, sizeof(cellIndex));
+        rows += sizeof(cellIndex);
+        for (size_t c = 0; c < row.size(); ++c) {
+            string_view value = row[c];
+            memcpy(arena + arenaEnd, value.data(), value.size());
+            arenaEnd += static_cast<uint32_t>(value.size());
+            memcpy(cells, &arenaEnd, sizeof(arenaEnd));
+            cells += sizeof(arenaEnd);
+        }
+        cellIndex += static_cast<uint32_t>(row.size());
+    }
+    memcpy(rows, &cellIndex, sizeof(cellIndex));
+    header.checksum = snapshotChecksum(body.data(), body.size());
+
+    string tempPath = path + ".tmp";
+    {
+        ofstream file(tempPath, ios::binary | ios::trunc);
+        if (!file) return false;
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(body.data(), static_cast<streamsize>(body.size()));
+        if (!file) {
+            file.close();
+            remove(tempPath.c_str());
+            return false;
+        }
+    }
+    // A source changed since it was read would get a snapshot of its old contents
+    SourceStamp now;
+    if (!readSourceStamp(sourcePath, now) || now.size != source.size || now.time != source.time) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    error_code ec;
+    filesystem::rename(tempPath, path, ec);
+    if (ec) {
+        remove(tempPath.c_str());
+        return false;
+    }
+    profileCount(ProfileCounter::BytesWritten, sizeof(header) + body.size());
+    return true;
+}
+
+} // namespace
+
+bool writeSnapshot(const string& path, const SheetData& data, const string& sourcePath,
+                   const SourceStamp& source) {
+    return writeSnapshotOf(path, data, sourcePath, source);
+}
+
+bool writeSnapshot(const string& path, const Sheet& sheet, const string& sourcePath, const SourceStamp& source) {
+    return writeSnapshotOf(path, sheet, sourcePath, source);
+}
+
+void setSnapshotDirectory(const string& dir) {
+    gSnapshotDir = dir;
+    if (dir.empty()) return;
+    error_code ec;
+    filesystem::create_directories(dir, ec);
+}
+
+bool snapshotsEnabled() { return !gSnapshotDir.empty(); }
+
+// Named after the source file, plus a hash of its absolute path so that sources with the
+// same name in different folders do not share a snapshot
+string snapshotPathFor(const string& sourcePath) {
+    error_code ec;
+    filesystem::path source = filesystem::absolute(sourcePath, ec);
+    if (ec) source = sourcePath;
+    string key = source.lexically_normal().string();
+    char hash[24];
+    snprintf(hash, sizeof(hash), "%016llx",
+             static_cast<unsigned long long>(snapshotChecksum(key.data(), key.size())));
+    string name = source.filename().string() + "." + hash + ".snap";
+    return (filesystem::path(gSnapshotDir.empty() ? "." : gSnapshotDir) / name).string();
+}
+
+bool loadSnapshotFor(const string& sourcePath, SheetData& data) {
+    if (!snapshotsEnabled()) return false;
+    PROFILE_SCOPE("loadSnapshotFor");
+    SourceStamp stamp;
+    if (!readSourceStamp(sourcePath, stamp)) return false;
+    SheetSnapshot snapshot;
+    if (!snapshot.open(snapshotPathFor(sourcePath), stamp.size, stamp.time)) return false;
+    snapshot.toSheetData(data);
+    return true;
+}
+
+bool loadSnapshotFor(const string& sourcePath, Sheet& sheet, const ColumnTypes& types) {
+    if (!snapshotsEnabled()) return false;
+    PROFILE_SCOPE("loadSnapshotFor");
+    SourceStamp stamp;
+    if (!readSourceStamp(sourcePath, stamp)) return false;
+    SheetSnapshot snapshot;
+    if (!snapshot.open(snapshotPathFor(sourcePath), stamp.size, stamp.time)) return false;
+    sheet.assign(snapshot, types);
+    return true;
+}
+
+void saveSnapshotFor(const string& sourcePath, const SheetData& data, const SourceStamp& stamp) {
+    if (snapshotsEnabled()) writeSnapshot(snapshotPathFor(sourcePath), data, sourcePath, stamp);
+}
+
+void saveSnapshotFor(const string& sourcePath, const Sheet& sheet, const SourceStamp& stamp) {
+    if (snapshotsEnabled()) writeSnapshot(snapshotPathFor(sourcePath), sheet, sourcePath, stamp);
+}
@@ -0,0 +1,109 @@
+#pragma once
+#include "mapped_file.h"
+#include "sheet.h"
+#include "sheet_data.h"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Binary snapshot of a loaded sheet, kept in the snapshot directory (off unless one is
+// set, see setSnapshotDirectory) as "<source file name>.<path hash>.snap". Reloading a
+// snapshot is a memory map plus a checksum: every cell is a span into one string arena,
+// located through two offset tables, so nothing is tokenized or unescaped.
+//
+// Layout (little-endian, 8-byte aligned sections):
+//   SnapshotHeader
+//   uint32_t rowStart[rowCount + 1]   index of each row's first cell, plus an end marker
+//   uint32_t cellEnd[cellCount]       end of each cell in the arena (a cell starts where
+//                                     the previous one ends)
+//   char     arena[arenaSize]         cell bytes, back to back
+//
+// The header records the size and modification time the source file had before it was
+// read, and the snapshot is only written if the source still has them. A snapshot whose
+// source has changed since (or that fails its checksum, or was written by another format
+// version) is ignored and the source is read instead.
+
+struct SnapshotHeader {
+    char magic[8];         // "PHSNAP\r\n"
+    uint32_t version;      // kSnapshotVersion
+    uint32_t headerSize;   // sizeof(SnapshotHeader)
+    uint64_t sourceSize;   // size of the source file when the snapshot was taken
+    int64_t sourceTime;    // its modification time (file clock ticks)
+    uint64_t rowCount;
+    uint64_t cellCount;
+    uint64_t arenaSize;
+    uint64_t checksum;     // snapshotChecksum of everything after the header
+};
+
+const uint32_t kSnapshotVersion = 1;
+
+// Word-at-a-time checksum of the snapshot body
+uint64_t snapshotChecksum(const char* data, size_t size);
+
+// Read-only view of a snapshot file, shaped like CsvView
+class SheetSnapshot {
+public:
+    // Maps the snapshot at path and checks its header and checksum. If sourceSize and
+    // sourceTime are given, the snapshot must also have been taken from that source.
+    // Returns true if the snapshot can be used.
+    bool open(const std::string& path);
+    bool open(const std::string& path, uint64_t sourceSize, int64_t sourceTime);
+
+    size_t rowCount() const { return rowCount_; }
+    size_t cellCount(size_t row) const { return rowStart_[row + 1] - rowStart_[row]; }
+    std::string_view cell(size_t row, size_t col) const;
+    // The mapped snapshot file the cells are spans of
+    std::shared_ptr<const MappedFile> mapping() const { return file_; }
+
+    // Fills data with the snapshot's rows. As with CsvView, the sheet keeps the snapshot
+    // mapped and its cells read from it (where kReplaceableWhileMapped allows).
+    void toSheetData(SheetData& data) const;
+
+private:
+    std::shared_ptr<MappedFile> file_; // a new one per open: sheets may still hold the last one
+    size_t rowCount_ = 0;
+    const uint32_t* rowStart_ = nullptr;
+    const uint32_t* cellEnd_ = nullptr;
+    const char* arena_ = nullptr;
+};
+
+// Size and modification time of a source file, taken before it is read
+struct SourceStamp {
+    uint64_t size = 0;
+    int64_t time = 0; // file clock ticks
+};
+
+// Stamp of the file at path as it is now. Returns false if it cannot be read.
+bool readSourceStamp(const std::string& path, SourceStamp& stamp);
+
+// Writes data, read from sourcePath while it had the given stamp, as a snapshot. The
+// source is checked again before the snapshot is renamed into place: if it changed in
+// the meantime nothing is written. Returns true if successful; sheets whose offsets do
+// not fit the 32-bit tables (4 GB of cells) are not snapshotted.
+bool writeSnapshot(const std::string& path, const SheetData& data, const std::string& sourcePath,
+                   const SourceStamp& source);
+bool writeSnapshot(const std::string& path, const Sheet& sheet, const std::string& sourcePath,
+                   const SourceStamp& source);
+
+// Turns snapshots on, kept in dir (created if missing), or off with "". Off by default,
+// so reading a sheet never writes next to it unless asked. Set it before loading.
+void setSnapshotDirectory(const std::string& dir);
+bool snapshotsEnabled();
+
+// Snapshot path of a source file in the snapshot directory
+std::string snapshotPathFor(const std::string& sourcePath);
+
+// Loads the snapshot of sourcePath if there is one taken from its current contents.
+// Returns false (leaving data untouched) if the source has to be read instead, or if
+// snapshots are off.
+bool loadSnapshotFor(const std::string& sourcePath, SheetData& data);
+// Same into a columnar sheet, keeping the given columns as numbers too
+bool loadSnapshotFor(const std::string& sourcePath, Sheet& sheet, const ColumnTypes& types);
+
+// Refreshes the snapshot of sourcePath after it was read (or written) while it had stamp.
+// Does nothing if snapshots are off. Failures are not reported: the snapshot is only a
+// cache, and a missing one means the source is parsed.
+void saveSnapshotFor(const std::string& sourcePath, const SheetData& data, const SourceStamp& stamp);
+void saveSnapshotFor(const std::string& sourcePath, const Sheet& sheet, const SourceStamp& stamp);
@@ -0,0 +1,561 @@
+#include "stream_sync.h"
+#include "file_handler.h"
+#include "logger.h"
+#include "profiler.h"
+#include "sheet_index.h"
+#include "text_utils.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+namespace {
+
+// Column layout of the sync (same fixed positions as syncAppSheet)
+const int kPriceCodeCol = 14;   // الكود column in pricesheet
+const int kPriceValueCol = 8;   // السعر column in pricesheet
+const int kStockCodeCol = 0;    // code column in stockSheet
+const int kStockTotalCol = 21;  // total column in stockSheet
+const int kAppSkuCol = 8;       // sku column in appSheet
+const int kAppPriceCol = 9;     // price column in appSheet
+const int kAppMaxStockCol = 25; // max stock column in appSheet
+const int kAppStockCol = 27;    // stock column in appSheet
+
+const size_t kMinSortBufferBytes = 1 << 20;
+const size_t kRunReadBufferBytes = 64 * 1024;
+const size_t kSrCodeBytes = 64; // rough memory of one #S#R code in its hash map
+
+// Byte string that sorts like the codes SheetIndex tells apart: numbers first by value
+// (big-endian), then texts bytewise
+string encodeKey(const NormalizedKey& key) {
+    string bytes;
+    if (key.kind == NormalizedKey::Number) {
+        bytes.resize(9);
+        bytes[0] = 1;
+        for (int i = 0; i < 8; ++i) bytes[1 + i] = static_cast<char>(key.number >> (56 - 8 * i));
+    } else {
+        bytes.reserve(key.text.size() + 1);
+        bytes += '\2';
+        bytes += key.text;
+    }
+    return bytes;
+}
+
+string encodeRow(uint64_t row) {
+    string bytes(8, '\0');
+    for (int i = 0; i < 8; ++i) bytes[i] = static_cast<char>(row >> (56 - 8 * i));
+    return bytes;
+}
+
+uint64_t decodeRow(const string& bytes) {
+    uint64_t row = 0;
+    for (int i = 0; i < 8; ++i) row = (row << 8) | static_cast<unsigned char>(bytes[i]);
+    return row;
+}
+
+// Code of a lookup sheet row, or false if the row has no cell in the code column (such
+// rows are not in SheetIndex either)
+bool lookupRowKey(const vector<string>& row, int codeCol, NormalizedKey& key) {
+    if ((int)row.size() <= codeCol) return false;
+    key = NormalizedKey::of(row[codeCol]);
+    return true;
+}
+
+// The value the full sync would copy from a lookup row ("" = none: no cell or blank)
+string_view lookupRowValue(const vector<string>& row, int valueCol) {
+    return (int)row.size() > valueCol ? trimView(row[valueCol]) : string_view();
+}
+
+// Sku of an App Sheet row, or false if the full sync skips the row
+bool appRowKey(const vector<string>& row, NormalizedKey& key) {
+    if ((int)row.size() <= max(kAppSkuCol, max(kAppPriceCol, kAppStockCol))) return false;
+    key = NormalizedKey::of(row[kAppSkuCol]);
+    return !(key.kind == NormalizedKey::Text && key.text.empty());
+}
+
+int syncCell(vector<string>& row, int col, string_view value) {
+    if (value.empty() || value == row[col]) return 0;
+    row[col].assign(value.data(), value.size());
+    return 1;
+}
+
+// Trimmed #S#R stock codes and how many Stock Sheet rows (after the header) hold each,
+// as setMaxStockForSRProducts collects them
+typedef unordered_map<string, int> SrCodes;
+
+void addSrCode(SrCodes& codes, const vector<string>& row) {
+    if (!row.empty() && row[kStockCodeCol].find("#S#R") != string::npos) codes[string(trimView(row[kStockCodeCol]))]++;
+}
+
+// setMaxStockForSRProducts for one App Sheet row. Returns the rows it counts for.
+int applySrRule(vector<string>& row, const SrCodes& codes) {
+    if (codes.empty() || row.size() <= kAppMaxStockCol) return 0;
+    const string& sku = row[kAppSkuCol];
+    if (sku.find("#S#R") == string::npos) return 0;
+    auto it = codes.find(string(trimView(sku)));
+    if (it == codes.end()) return 0;
+    row[kAppMaxStockCol] = "1";
+    return it->second;
+}
+
+// Code -> value of the first row holding each code (SheetIndex's rule), kept as two
+// sorted arrays over one byte arena: 16 bytes per code plus the text.
+class CodeValueTable {
+public:
+    void add(const NormalizedKey& key, string_view value) {
+        uint32_t valueOffset = append(value);
+        if (key.kind == NormalizedKey::Number) {
+            numbers_.push_back({key.number, valueOffset, static_cast<uint32_t>(value.size())});
+        } else {
+            uint32_t keyOffset = append(key.text);
+            texts_.push_back({keyOffset, static_cast<uint32_t>(key.text.size()), valueOffset,
+                              static_cast<uint32_t>(value.size())});
+        }
+    }
+
+    // Sorts the codes, keeps the first row of each and drops those without a value
+    void finish() {
+        stable_sort(numbers_.begin(), numbers_.end(),
+                    [](const NumberEntry& a, const NumberEntry& b) { return a.number < b.number; });
+        size_t kept = 0;
+        for (size_t i = 0; i < numbers_.size(); ++i) {
+            if (i > 0 && numbers_[i].number == numbers_[i - 1].number) continue;
+            if (numbers_[i].valueLength > 0) numbers_[kept++] = numbers_[i];
+        }
+        numbers_.resize(kept);
+        numbers_.shrink_to_fit();
+        stable_sort(texts_.begin(), texts_.end(),
+                    [this](const TextEntry& a, const TextEntry& b) { return keyOf(a) < keyOf(b); });
+        kept = 0;
+        for (size_t i = 0; i < texts_.size(); ++i) {
+            if (i > 0 && keyOf(texts_[i]) == keyOf(texts_[i - 1])) continue;
+            if (texts_[i].valueLength > 0) texts_[kept++] = texts_[i];
+        }
+        texts_.resize(kept);
+        texts_.shrink_to_fit();
+    }
+
+    // Value of the first row holding key, "" if there is none
+    string_view find(const NormalizedKey& key) const {
+        if (key.kind == NormalizedKey::Number) {
+            auto it = lower_bound(numbers_.begin(), numbers_.end(), key.number,
+                                  [](const NumberEntry& entry, uint64_t number) { return entry.number < number; });
+            if (it == numbers_.end() || it->number != key.number) return string_view();
+            return string_view(arena_.data() + it->valueOffset, it->valueLength);
+        }
+        string_view text = key.text;
+        auto it = lower_bound(texts_.begin(), texts_.end(), text,
+                              [this](const TextEntry& entry, string_view text) { return keyOf(entry) < text; });
+        if (it == texts_.end() || keyOf(*it) != text) return string_view();
+        return string_view(arena_.data() + it->valueOffset, it->valueLength);
+    }
+
+    size_t memoryBytes() const {
+        return numbers_.capacity() * sizeof(NumberEntry) + texts_.capacity() * sizeof(TextEntry) + arena_.capacity();
+    }
+    // Offsets are 32-bit: past 4 GB of text the table cannot grow (the sync sorts on disk)
+    bool full() const { return arena_.size() > UINT32_MAX - (1u << 20); }
+
+private:
+    struct NumberEntry {
+        uint64_t number;
+        uint32_t valueOffset, valueLength;
+    };
+    struct TextEntry {
+        uint32_t keyOffset, keyLength, valueOffset, valueLength;
+    };
+
+    uint32_t append(string_view text) {
+        uint32_t offset = static_cast<uint32_t>(arena_.size());
+        arena_.append(text.data(), text.size());
+        return offset;
+    }
+    string_view keyOf(const TextEntry& entry) const { return string_view(arena_.data() + entry.keyOffset, entry.keyLength); }
+
+    vector<NumberEntry> numbers_;
+    vector<TextEntry> texts_;
+    string arena_;
+};
+
+// Sorts (key, value) byte records that may not fit in memory: records are buffered up to
+// bufferBytes, sorted and written out as run files, and the runs are merged as they are
+// read back. Records with equal keys come out in the order they were added. If everything
+// fits in one buffer nothing is written to disk.
+class ExternalSorter {
+public:
+    ExternalSorter(string runPrefix, size_t bufferBytes) : prefix_(std::move(runPrefix)), bufferBytes_(bufferBytes) {}
+    ~ExternalSorter() {
+        for (Run& run : runs_) {
+            if (run.file) fclose(run.file);
+        }
+        for (const string& path : runPaths_) remove(path.c_str());
+    }
+    ExternalSorter(const ExternalSorter&) = delete;
+    ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+    bool add(string_view key, string_view value) {
+        records_.push_back({arena_.size(), static_cast<uint32_t>(key.size()), static_cast<uint32_t>(value.size())});
+        arena_.append(key.data(), key.size());
+        arena_.append(value.data(), value.size());
+        if (arena_.size() + records_.size() * sizeof(Record) < bufferBytes_) return true;
+        return spill();
+    }
+
+    // Ends the input and starts the merge. Returns false if a run could not be written or read.
+    bool finish() {
+        sortRecords();
+        if (runPaths_.empty()) return true; // everything fits: read straight from the buffer
+        if (!records_.empty() && !spill()) return false;
+        runs_.resize(runPaths_.size());
+        for (size_t i = 0; i < runs_.size(); ++i) {
+            Run& run = runs_[i];
+            run.file = fopen(runPaths_[i].c_str(), "rb");
+            if (!run.file) {
+                cerr << "Error: Could not open sort run " << runPaths_[i] << endl;
+                return false;
+            }
+            run.buffer.reset(new char[kRunReadBufferBytes]);
+            setvbuf(run.file, run.buffer.get(), _IOFBF, kRunReadBufferBytes);
+            if (readRecord(run)) heap_.push_back(i);
+        }
+        make_heap(heap_.begin(), heap_.end(), laterRun());
+        return !failed_;
+    }
+
+    // Next record in key order. Returns false at the end or on a read error (see failed()).
+    bool next(string& key, string& value) {
+        if (runPaths_.empty()) {
+            if (nextRecord_ >= records_.size()) return false;
+            const Record& record = records_[nextRecord_++];
+            key.assign(arena_, record.offset, record.keyLength);
+            value.assign(arena_, record.offset + record.keyLength, record.valueLength);
+            return true;
+        }
+        if (heap_.empty()) return false;
+        pop_heap(heap_.begin(), heap_.end(), laterRun());
+        Run& run = runs_[heap_.back()];
+        key.swap(run.key);
+        value.swap(run.value);
+        if (readRecord(run)) push_heap(heap_.begin(), heap_.end(), laterRun());
+        else heap_.pop_back();
+        return true;
+    }
+
+    size_t runCount() const { return runPaths_.size(); }
+    bool failed() const { return failed_; }
+
+private:
+    struct Record {
+        size_t offset;
+        uint32_t keyLength, valueLength;
+    };
+    struct Run {
+        FILE* file = nullptr;
+        unique_ptr<char[]> buffer;
+        string key, value;
+    };
+    // Heap order: the run with the smaller key (then the earlier run) comes out first
+    struct LaterRun {
+        const vector<Run>* runs;
+        bool operator()(size_t a, size_t b) const {
+            int order = (*runs)[a].key.compare((*runs)[b].key);
+            return order > 0 || (order == 0 && a > b);
+        }
+    };
+    LaterRun laterRun() const { return LaterRun{&runs_}; }
+
+    string_view keyOf(const Record& record) const { return string_view(arena_.data() + record.offset, record.keyLength); }
+
+    void sortRecords() {
+        stable_sort(records_.begin(), records_.end(),
+                    [this](const Record& a, const Record& b) { return keyOf(a) < keyOf(b); });
+    }
+
+    bool spill() {
+        PROFILE_SCOPE("ExternalSorter::spill");
+        sortRecords();
+        string path = prefix_ + "." + to_string(runPaths_.size()) + ".run";
+        runPaths_.push_back(path);
+        FILE* file = fopen(path.c_str(), "wb");
+        bool ok = file != nullptr;
+        for (size_t i = 0; ok && i < records_.size(); ++i) {
+            const Record& record = records_[i];
+            uint32_t lengths[2] = {record.keyLength, record.valueLength};
+            ok = fwrite(lengths, sizeof(lengths), 1, file) == 1 &&
+                 fwrite(arena_.data() + record.offset, 1, record.keyLength + record.valueLength, file) ==
+                     record.keyLength + record.valueLength;
+        }
+        if (file && fclose(file) != 0) ok = false;
+        if (!ok) {
+            cerr << "Error: Could not write sort run " << path << endl;
+            failed_ = true;
+            return false;
+        }
+        profileCount(ProfileCounter::BytesWritten, arena_.size() + records_.size() * 8);
+        records_.clear();
+        arena_.clear();
+        return true;
+    }
+
+    bool readRecord(Run& run) {
+        uint32_t lengths[2];
+        if (fread(lengths, sizeof(lengths), 1, run.file) != 1) {
+            if (ferror(run.file)) failed_ = true;
+            return false;
+        }
+        run.key.resize(lengths[0]);
+        run.value.resize(lengths[1]);
+        if ((lengths[0] && fread(&run.key[0], 1, lengths[0], run.file) != lengths[0]) ||
+            (lengths[1] && fread(&run.value[0], 1, lengths[1], run.file) != lengths[1])) {
+            failed_ = true;
+            return false;
+        }
+        return true;
+    }
+
+    string prefix_;
+    size_t bufferBytes_;
+    string arena_;
+    vector<Record> records_;
+    size_t nextRecord_ = 0;
+    vector<string> runPaths_;
+    vector<Run> runs_;
+    vector<size_t> heap_;
+    bool failed_ = false;
+};
+
+// Looks up ascending codes in a sorter of (code, value) records, using the first record
+// of each code
+class SortedLookup {
+public:
+    explicit SortedLookup(ExternalSorter& sorter) : sorter_(sorter) { valid_ = sorter_.next(key_, value_); }
+
+    // Value for code ("" if none). Codes must come in ascending order.
+    string_view find(const string& code) {
+        while (valid_ && key_ < code) {
+            string passed;
+            passed.swap(key_);
+            do {
+                valid_ = sorter_.next(key_, value_);
+            } while (valid_ && key_ == passed);
+        }
+        return valid_ && key_ == code ? string_view(value_) : string_view();
+    }
+
+private:
+    ExternalSorter& sorter_;
+    string key_, value_;
+    bool valid_;
+};
+
+enum LoadStatus { Loaded, Empty, ReadFailed, OverBudget };
+
+LoadStatus finishRead(const CsvRowReader& reader, size_t rows, const string& path) {
+    if (reader.failed()) {
+        cerr << "Error: Failed to read " << path << endl;
+        return ReadFailed;
+    }
+    return rows == 0 ? Empty : Loaded;
+}
+
+// Reads a lookup sheet into table (and its #S#R codes into srCodes, if given). Stops with
+// OverBudget once the tables would take more than budget bytes (0 = no limit).
+LoadStatus loadTable(const string& path, int codeCol, int valueCol, CodeValueTable& table, SrCodes* srCodes,
+                     size_t budget, size_t usedBytes) {
+    PROFILE_SCOPE("streamSync/loadTable");
+    CsvRowReader reader;
+    if (!reader.open(path)) return ReadFailed;
+    vector<string> row;
+    NormalizedKey key;
+    size_t rows = 0;
+    for (; reader.next(row); ++rows) {
+        if (srCodes && rows > 0) addSrCode(*srCodes, row);
+        if (lookupRowKey(row, codeCol, key)) table.add(key, lookupRowValue(row, valueCol));
+        size_t srBytes = srCodes ? srCodes->size() * kSrCodeBytes : 0;
+        if (table.full() || (budget && usedBytes + table.memoryBytes() + srBytes > budget)) return OverBudget;
+    }
+    profileCount(ProfileCounter::RowsScanned, rows);
+    table.finish();
+    return finishRead(reader, rows, path);
+}
+
+// Feeds a lookup sheet's (code, value) records to sorter (and its #S#R codes to srCodes)
+LoadStatus sortTable(const string& path, int codeCol, int valueCol, ExternalSorter& sorter, SrCodes* srCodes) {
+    PROFILE_SCOPE("streamSync/sortTable");
+    CsvRowReader reader;
+    if (!reader.open(path)) return ReadFailed;
+    vector<string> row;
+    NormalizedKey key;
+    size_t rows = 0;
+    for (; reader.next(row); ++rows) {
+        if (srCodes && rows > 0) addSrCode(*srCodes, row);
+        if (lookupRowKey(row, codeCol, key) && !sorter.add(encodeKey(key), lookupRowValue(row, valueCol))) {
+            return ReadFailed;
+        }
+    }
+    profileCount(ProfileCounter::RowsScanned, rows);
+    LoadStatus status = finishRead(reader, rows, path);
+    if (status == Loaded && !sorter.finish()) return ReadFailed;
+    return status;
+}
+
+bool reportEmpty() {
+    cout << "Error: One or more sheets are empty. Cannot synchronize.\n";
+    return false;
+}
+
+// Streams the App Sheet to outPath, letting syncRow update each row after the header.
+// The input is closed before the output replaces it, so outPath may be appPath.
+template <class SyncRow>
+bool rewriteAppSheet(const string& appPath, const string& outPath, StreamSyncResult& result, SyncRow&& syncRow) {
+    CsvRowReader reader;
+    if (!reader.open(appPath)) return false;
+    vector<string> row;
+    if (!reader.next(row)) return reader.failed() ? finishRead(reader, 0, appPath) == Loaded : reportEmpty();
+    CsvRowWriter writer;
+    if (!writer.open(outPath)) return false;
+    writer.write(row); // header
+    size_t rows = 1;
+    for (; reader.next(row); ++rows) {
+        syncRow(rows, row);
+        if (!writer.write(row)) break;
+    }
+    if (reader.failed()) return finishRead(reader, rows, appPath) == Loaded;
+    reader.close();
+    if (!writer.finish()) return false;
+    result.appRows = rows;
+    profileCount(ProfileCounter::RowsScanned, rows);
+    return true;
+}
+
+// Lookups from budget-sized sorted runs: the App Sheet codes are sorted with their row
+// numbers and merge-joined with the sorted stock and price codes, and the values found
+// are sorted back by row for a second pass over the App Sheet that writes the output.
+bool syncOnDisk(const string& appPath, const string& stockPath, const string& pricePath, const string& outPath,
+                const string& runPrefix, size_t bufferBytes, SrCodes& srCodes, StreamSyncResult& result) {
+    PROFILE_SCOPE("streamSync/onDisk");
+    ExternalSorter stockRuns(runPrefix + ".stock", bufferBytes), priceRuns(runPrefix + ".price", bufferBytes);
+    srCodes.clear();
+    LoadStatus status = sortTable(stockPath, kStockCodeCol, kStockTotalCol, stockRuns, &srCodes);
+    if (status == Loaded) status = sortTable(pricePath, kPriceCodeCol, kPriceValueCol, priceRuns, nullptr);
+    if (status == Empty) return reportEmpty();
+    if (status != Loaded) return false;
+
+    ExternalSorter appKeys(runPrefix + ".keys", bufferBytes);
+    {
+        CsvRowReader reader;
+        if (!reader.open(appPath)) return false;
+        vector<string> row;
+        NormalizedKey key;
+        size_t rows = 0;
+        for (; reader.next(row); ++rows) {
+            if (rows > 0 && appRowKey(row, key) && !appKeys.add(encodeKey(key), encodeRow(rows))) return false;
+        }
+        if (finishRead(reader, rows, appPath) != Loaded) return rows == 0 && !reader.failed() ? reportEmpty() : false;
+        if (!appKeys.finish()) return false;
+    }
+
+    // Per row: 4-byte price length, price, stock
+    ExternalSorter rowValues(runPrefix + ".rows", bufferBytes);
+    {
+        SortedLookup stock(stockRuns), price(priceRuns);
+        string code, rowBytes, values;
+        while (appKeys.next(code, rowBytes)) {
+            string_view priceValue = price.find(code), stockValue = stock.find(code);
+            if (priceValue.empty() && stockValue.empty()) continue;
+            uint32_t priceLength = static_cast<uint32_t>(priceValue.size());
+            values.assign(reinterpret_cast<const char*>(&priceLength), sizeof(priceLength));
+            values.append(priceValue.data(), priceValue.size());
+            values.append(stockValue.data(), stockValue.size());
+            if (!rowValues.add(rowBytes, values)) return false;
+        }
+        if (appKeys.failed() || stockRuns.failed() || priceRuns.failed() || !rowValues.finish()) {
+            cerr << "Error: Failed to read the sort runs" << endl;
+            return false;
+        }
+    }
+    result.sortRuns = stockRuns.runCount() + priceRuns.runCount() + appKeys.runCount() + rowValues.runCount();
+
+    string rowBytes, values;
+    bool pending = rowValues.next(rowBytes, values);
+    uint64_t pendingRow = pending ? decodeRow(rowBytes) : 0;
+    bool ok = rewriteAppSheet(appPath, outPath, result, [&](size_t rowNumber, vector<string>& row) {
+        if (pending && pendingRow == rowNumber) {
+            uint32_t priceLength;
+            memcpy(&priceLength, values.data(), sizeof(priceLength));
+            result.cellsUpdated += syncCell(row, kAppPriceCol, string_view(values).substr(4, priceLength));
+            result.cellsUpdated += syncCell(row, kAppStockCol, string_view(values).substr(4 + priceLength));
+            pending = rowValues.next(rowBytes, values);
+            if (pending) pendingRow = decodeRow(rowBytes);
+        }
+        result.srRowsUpdated += applySrRule(row, srCodes);
+    });
+    if (ok && rowValues.failed()) {
+        cerr << "Error: Failed to read the sort runs" << endl;
+        return false;
+    }
+    return ok;
+}
+
+} // namespace
+
+bool streamSyncAppSheet(const string& appPath, const string& stockPath, const string& pricePath,
+                        const string& outPath, const StreamSyncOptions& options, StreamSyncResult* result) {
+    PROFILE_SCOPE("streamSyncAppSheet");
+    StreamSyncResult local;
+    StreamSyncResult& out = result ? *result : local;
+    out = StreamSyncResult();
+
+    SrCodes srCodes;
+    bool ok = false;
+    {
+        CodeValueTable stockTable, priceTable;
+        LoadStatus status = loadTable(stockPath, kStockCodeCol, kStockTotalCol, stockTable, &srCodes,
+                                      options.memoryBudget, 0);
+        if (status == Loaded) {
+            status = loadTable(pricePath, kPriceCodeCol, kPriceValueCol, priceTable, nullptr, options.memoryBudget,
+                               stockTable.memoryBytes() + srCodes.size() * kSrCodeBytes);
+        }
+        if (status == Empty) return reportEmpty();
+        if (status == ReadFailed) return false;
+        out.sortedOnDisk = status == OverBudget;
+        if (!out.sortedOnDisk) {
+            out.tableBytes = stockTable.memoryBytes() + priceTable.memoryBytes() + srCodes.size() * kSrCodeBytes;
+            NormalizedKey key;
+            ok = rewriteAppSheet(appPath, outPath, out, [&](size_t, vector<string>& row) {
+                if (appRowKey(row, key)) {
+                    out.cellsUpdated += syncCell(row, kAppPriceCol, priceTable.find(key));
+                    out.cellsUpdated += syncCell(row, kAppStockCol, stockTable.find(key));
+                }
+                out.srRowsUpdated += applySrRule(row, srCodes);
+            });
+        }
+    }
+    if (out.sortedOnDisk) {
+        string runPrefix = outPath;
+        if (!options.tempDir.empty()) {
+            runPrefix = (filesystem::path(options.tempDir) / filesystem::path(outPath).filename()).string();
+        }
+        // Up to four sorters hold a buffer at once (stock, price, App Sheet codes, results)
+        size_t bufferBytes = max(kMinSortBufferBytes, options.memoryBudget / 4);
+        ok = syncOnDisk(appPath, stockPath, pricePath, outPath, runPrefix, bufferBytes, srCodes, out);
+    }
+    if (!ok) return false;
+
+    // Same records and messages as syncAppSheet followed by setMaxStockForSRProducts
+    profileCount(ProfileCounter::CellsUpdated, out.cellsUpdated);
+    logChange("App Sheet synchronized using VLOOKUP from Stock and Price Sheets - " + to_string(out.cellsUpdated) +
+              " cells updated.");
+    cout << "App Sheet synchronized. Updated " << out.cellsUpdated << " cells.\n";
+    profileCount(ProfileCounter::CellsUpdated, out.srRowsUpdated);
+    logChange("Set max stock for #S#R products in App Sheet for " + to_string(out.srRowsUpdated) + " rows.");
+    cout << "Updated max stock for #S#R products in App Sheet for " << out.srRowsUpdated << " rows.\n";
+    return true;
+}
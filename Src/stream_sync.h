@@ -0,0 +1,34 @@
+#pragma once
+#include <cstddef>
+#include <string>
+
+// Sync for App Sheets too large to load (batch "sync --stream"): the Stock and Price
+// Sheets are reduced to compact code -> value tables (stock total, السعر) and the App
+// Sheet is read one row at a time, synced and written straight to the output, so memory
+// holds the two tables and a few row buffers instead of three SheetData. The output is
+// the file syncAppSheet + writeCSV would produce, with the same log lines.
+//
+// When the tables would not fit in memoryBudget the sync falls back to sorting on disk:
+// stock, price and App Sheet codes are sorted in budget-sized runs, merge-joined, and the
+// results sorted back into row order for a second pass over the App Sheet. The #S#R stock
+// codes (a few percent of the rows) stay in memory in both modes.
+
+struct StreamSyncOptions {
+    size_t memoryBudget = 0; // bytes for the lookup tables and sort buffers (0 = no limit)
+    std::string tempDir;     // where sort runs go (default: next to the output file)
+};
+
+struct StreamSyncResult {
+    size_t appRows = 0;
+    int cellsUpdated = 0;
+    int srRowsUpdated = 0;
+    size_t tableBytes = 0; // memory held by the lookup tables (in-memory mode)
+    bool sortedOnDisk = false; // the tables went over the budget and the lookups were sorted
+    size_t sortRuns = 0;       // runs written to disk (0 if every sort fit in its buffer)
+};
+
+// Reads CSV files only. Returns false (after printing why) if a sheet is empty or a file
+// could not be read or written; the output file is then left as it was.
+bool streamSyncAppSheet(const std::string& appPath, const std::string& stockPath, const std::string& pricePath,
+                        const std::string& outPath, const StreamSyncOptions& options,
+                        StreamSyncResult* result = nullptr);
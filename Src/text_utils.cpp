@@ -0,0 +1,52 @@
+#include "text_utils.h"
+using namespace std;
+
+string_view trimView(string_view text) {
+    const char* ws = " \t\n\r\f\v";
+    size_t start = text.find_first_not_of(ws);
+    if (start == string_view::npos) return string_view();
+    size_t end = text.find_last_not_of(ws);
+    return text.substr(start, end - start + 1);
+}
+
+bool equalsIgnoreCase(string_view a, string_view b) {
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (asciiLower(a[i]) != asciiLower(b[i])) return false;
+    }
+    return true;
+}
+
+size_t findIgnoreCase(string_view text, string_view needle) {
+    if (needle.empty()) return 0;
+    if (needle.size() > text.size()) return string_view::npos;
+    char first = asciiLower(needle[0]);
+    string_view rest = needle.substr(1);
+    size_t last = text.size() - needle.size();
+    for (size_t i = 0; i <= last; ++i) {
+        if (asciiLower(text[i]) == first && equalsIgnoreCase(text.substr(i + 1, rest.size()), rest)) return i;
+    }
+    return string_view::npos;
+}
+
+WordMatcher::WordMatcher(initializer_list<string_view> words) {
+    for (string_view word : words) {
+        if (word.size() > kMaxWordLength) continue;
+        string lower(word);
+        for (char& c : lower) c = asciiLower(c);
+        byLength_[lower.size()].push_back(std::move(lower));
+    }
+}
+
+bool WordMatcher::matches(string_view text) const {
+    if (text.size() > kMaxWordLength) return false;
+    for (const string& word : byLength_[text.size()]) {
+        if (equalsIgnoreCase(text, word)) return true;
+    }
+    return false;
+}
+
+const WordMatcher& missingValueWords() {
+    static const WordMatcher words{"nan", "n/a", "na", "null", "undefined", ""};
+    return words;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <cstddef>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Allocation-free helpers for comparing cell text. They work on views into the caller's
+// strings and fold case for ASCII letters only (Arabic text has no case), which is what
+// ::tolower does in the default "C" locale the program runs in.
+
+// The text without leading and trailing whitespace (" \t\n\r\f\v"), as a view into it
+std::string_view trimView(std::string_view text);
+
+inline char asciiLower(char c) { return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c; }
+
+// ASCII case-insensitive equality
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+// Position of the first ASCII case-insensitive occurrence of needle in text, or npos
+size_t findIgnoreCase(std::string_view text, std::string_view needle);
+inline bool containsIgnoreCase(std::string_view text, std::string_view needle) {
+    return findIgnoreCase(text, needle) != std::string_view::npos;
+}
+
+// Fixed set of words (up to 31 characters), matched against whole cells ASCII
+// case-insensitively. The words are grouped by length when the matcher is built, so most
+// cells are rejected on their length and the rest are compared with the few words of the
+// same length.
+class WordMatcher {
+public:
+    WordMatcher(std::initializer_list<std::string_view> words);
+
+    bool matches(std::string_view text) const;
+
+private:
+    static const size_t kMaxWordLength = 31;
+    std::vector<std::string> byLength_[kMaxWordLength + 1]; // lowercased words, by length
+};
+
+// The values convertNanToZero treats as missing: "", nan, n/a, na, null, undefined (any case)
+const WordMatcher& missingValueWords();
@@ -0,0 +1,86 @@
+#include "thread_pool.h"
+#include <algorithm>
+using namespace std;
+
+ThreadPool::ThreadPool(unsigned threads) {
+    if (threads == 0) threads = max(1u, thread::hardware_concurrency());
+    workers_.reserve(threads - 1);
+    for (unsigned i = 1; i < threads; ++i) workers_.emplace_back([this]() { workerMain(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (thread& worker : workers_) worker.join();
+}
+
+// Claims indices until the loop is exhausted; the last call to finish wakes the owner.
+// Never throws: an exception from fn is kept for the owner, and once one was thrown the
+// remaining indices are counted as done without running them.
+void ThreadPool::runLoop(Loop& loop) {
+    while (true) {
+        size_t i = loop.next.fetch_add(1, memory_order_relaxed);
+        if (i >= loop.count) return;
+        if (!loop.failed.load(memory_order_relaxed)) {
+            try {
+                (*loop.fn)(i);
+            } catch (...) {
+                lock_guard<mutex> lock(loop.mutex);
+                if (!loop.error) loop.error = current_exception();
+                loop.failed.store(true, memory_order_relaxed);
+            }
+        }
+        if (loop.done.fetch_add(1, memory_order_acq_rel) + 1 == loop.count) {
+            lock_guard<mutex> lock(loop.mutex);
+            loop.finished.notify_all();
+        }
+    }
+}
+
+void ThreadPool::parallelFor(size_t count, const function<void(size_t)>& fn) {
+    if (count == 0) return;
+    if (count == 1 || workers_.empty()) {
+        for (size_t i = 0; i < count; ++i) fn(i);
+        return;
+    }
+
+    auto loop = make_shared<Loop>();
+    loop->fn = &fn;
+    loop->count = count;
+    size_t helpers = min(count - 1, workers_.size());
+    {
+        lock_guard<mutex> lock(mutex_);
+        for (size_t i = 0; i < helpers; ++i) queue_.push_back(loop);
+    }
+    if (helpers == 1) wake_.notify_one();
+    else wake_.notify_all();
+
+    runLoop(*loop);
+    unique_lock<mutex> lock(loop->mutex);
+    loop->finished.wait(lock, [&]() { return loop->done.load(memory_order_acquire) == count; });
+    // Every call has returned, so nothing uses fn any more
+    if (loop->error) rethrow_exception(loop->error);
+}
+
+void ThreadPool::workerMain() {
+    while (true) {
+        shared_ptr<Loop> loop;
+        {
+            unique_lock<mutex> lock(mutex_);
+            wake_.wait(lock, [this]() { return stopping_ || !queue_.empty(); });
+            if (queue_.empty()) return; // stopping
+            loop = std::move(queue_.front());
+            queue_.pop_front();
+        }
+        runLoop(*loop); // returns at once if the owner and other helpers already took every index
+    }
+}
+
+// Pool shared by the loaders and operations (one thread per core)
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool;
+    return pool;
+}
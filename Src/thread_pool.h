@@ -0,0 +1,55 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads for data-parallel loops. The calling thread always takes
+// part in its own loop, so a parallelFor started from inside another one (e.g. a file
+// parsed in chunks while three files load at once) never waits on an idle queue.
+class ThreadPool {
+public:
+    // threads = total threads a loop may use, including the caller (0 = one per core)
+    explicit ThreadPool(unsigned threads = 0);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Threads a loop can run on, including the caller
+    unsigned size() const { return static_cast<unsigned>(workers_.size()) + 1; }
+
+    // Runs fn(i) for every i in [0, count) and returns when all calls have finished.
+    // Indices are handed out one at a time, in increasing order. If a call throws, the
+    // indices not started yet are skipped and the first exception is rethrown here once
+    // every call in flight has returned.
+    void parallelFor(size_t count, const std::function<void(size_t)>& fn);
+
+    // Pool shared by the loaders and operations (one thread per core)
+    static ThreadPool& shared();
+
+private:
+    struct Loop {
+        const std::function<void(size_t)>* fn;
+        size_t count;
+        std::atomic<size_t> next{0};
+        std::atomic<size_t> done{0};
+        std::atomic<bool> failed{false};
+        std::exception_ptr error; // first exception thrown by fn, guarded by mutex
+        std::mutex mutex;
+        std::condition_variable finished;
+    };
+    static void runLoop(Loop& loop);
+    void workerMain();
+
+    std::vector<std::thread> workers_;
+    std::deque<std::shared_ptr<Loop>> queue_;
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    bool stopping_ = false;
+};
@@ -0,0 +1,288 @@
+#include "xlsx_writer.h"
+#include "zip_archive.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string_view>
+#include <unordered_map>
+using namespace std;
+
+namespace {
+
+const size_t kFlushBytes = 256 * 1024; // XML gathered before it is handed to the deflater
+
+const char* const kContentTypes =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">"
+    "<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>"
+    "<Default Extension=\"xml\" ContentType=\"application/xml\"/>"
+    "<Override PartName=\"/xl/workbook.xml\" "
+    "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet.main+xml\"/>"
+    "<Override PartName=\"/xl/worksheets/sheet1.xml\" "
+    "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.worksheet+xml\"/>"
+    "<Override PartName=\"/xl/sharedStrings.xml\" "
+    "ContentType=\"application/vnd.openxmlformats-officedocument.spreadsheetml.sharedStrings+xml\"/>"
+    "</Types>";
+
+const char* const kRootRels =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" "
+    "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument\" "
+    "Target=\"xl/workbook.xml\"/>"
+    "</Relationships>";
+
+const char* const kWorkbookRels =
+    "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+    "<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">"
+    "<Relationship Id=\"rId1\" "
+    "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/worksheet\" "
+    "Target=\"worksheets/sheet1.xml\"/>"
+    "<Relationship Id=\"rId2\" "
+    "Type=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships/sharedStrings\" "
+    "Target=\"sharedStrings.xml\"/>"
+    "</Relationships>";
+
+// Appends text escaped for XML content or attributes. Control characters that XML 1.0
+// cannot hold are dropped.
+void appendXmlEscaped(string& out, string_view text) {
+    size_t start = 0;
+    for (size_t i = 0; i < text.size(); ++i) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        const char* entity = nullptr;
+        if (c == '&') entity = "&amp;";
+        else if (c == '<') entity = "&lt;";
+        else if (c == '>') entity = "&gt;";
+        else if (c == '"') entity = "&quot;";
+        else if (c >= 0x20 || c == '\t' || c == '\n' || c == '\r') continue;
+        out.append(text.data() + start, i - start);
+        if (entity != nullptr) out += entity;
+        start = i + 1;
+    }
+    out.append(text.data() + start, text.size() - start);
+}
+
+// Column letters of a 0-based column index (0 -> A, 27 -> AB)
+string columnName(size_t col) {
+    string name;
+    for (size_t n = col + 1; n > 0; n = (n - 1) / 26) name.insert(name.begin(), static_cast<char>('A' + (n - 1) % 26));
+    return name;
+}
+
+// Appends the digits of a run that Python's int()/float() accept: ASCII or (Extended)
+// Arabic-Indic digits, with single underscores between digits. Returns the digit count,
+// or -1 if an underscore is misplaced.
+int appendDigitRun(string_view text, size_t& i, string& out) {
+    int digits = 0;
+    bool afterUnderscore = false;
+    while (i < text.size()) {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        unsigned char next = i + 1 < text.size() ? static_cast<unsigned char>(text[i + 1]) : 0;
+        if (c >= '0' && c <= '9') {
+            out += static_cast<char>(c);
+            i += 1;
+        } else if (c == 0xD9 && next >= 0xA0 && next <= 0xA9) {
+            out += static_cast<char>('0' + (next - 0xA0));
+            i += 2;
+        } else if (c == 0xDB && next >= 0xB0 && next <= 0xB9) {
+            out += static_cast<char>('0' + (next - 0xB0));
+            i += 2;
+        } else if (c == '_' && digits > 0 && !afterUnderscore) {
+            afterUnderscore = true;
+            i += 1;
+            continue;
+        } else {
+            break;
+        }
+        digits++;
+        afterUnderscore = false;
+    }
+    return afterUnderscore ? -1 : digits;
+}
+
+// Writes a whole double as integer digits (Python's int(f)), anything else in the
+// shortest form that reads back as the same double (Python's repr)
+void appendNumber(string& out, double value) {
+    char buf[40];
+    if (value == static_cast<double>(static_cast<long long>(value)) && value > -1e18 && value < 1e18) {
+        snprintf(buf, sizeof(buf), "%lld", static_cast<long long>(value));
+    } else {
+        for (int precision = 15; precision <= 17; ++precision) {
+            snprintf(buf, sizeof(buf), "%.*g", precision, value);
+            if (strtod(buf, nullptr) == value) break;
+        }
+    }
+    out += buf;
+}
+
+// The html_to_csv_converter.py try_numeric rule: text containing '.' is tried as a float
+// (stored as an integer when whole), other text as an integer. Appends the <v> text of
+// the number and returns true, or returns false to keep the cell as text.
+bool appendNumericValue(string& out, string_view cell) {
+    const char* ws = " \t\n\r\f\v";
+    size_t first = cell.find_first_not_of(ws);
+    if (first == string_view::npos) return false;
+    string_view text = cell.substr(first, cell.find_last_not_of(ws) - first + 1);
+    if (text.size() > 64) return false;
+
+    string clean; // ASCII digits, underscores removed
+    size_t i = 0;
+    if (text[0] == '+' || text[0] == '-') clean += text[i++];
+    int intDigits = appendDigitRun(text, i, clean);
+    if (intDigits < 0) return false;
+
+    if (text.find('.') == string_view::npos) {
+        if (intDigits == 0 || i != text.size()) return false;
+        // Canonical integer: no '+', no leading zeros, no "-0"
+        bool negative = clean[0] == '-';
+        size_t digitsStart = (clean[0] == '-' || clean[0] == '+') ? 1 : 0;
+        size_t nonZero = clean.find_first_not_of('0', digitsStart);
+        if (nonZero == string::npos) {
+            out += '0';
+            return true;
+        }
+        if (negative) out += '-';
+        out.append(clean, nonZero, string::npos);
+        return true;
+    }
+
+    if (i >= text.size() || text[i] != '.') return false;
+    clean += text[i++];
+    int fracDigits = appendDigitRun(text, i, clean);
+    if (fracDigits < 0 || intDigits + fracDigits == 0) return false;
+    if (i < text.size() && (text[i] == 'e' || text[i] == 'E')) {
+        clean += text[i++];
+        if (i < text.size() && (text[i] == '+' || text[i] == '-')) clean += text[i++];
+        if (appendDigitRun(text, i, clean) <= 0) return false;
+    }
+    if (i != text.size()) return false;
+    appendNumber(out, strtod(clean.c_str(), nullptr));
+    return true;
+}
+
+// Streams XML into one zip entry through a reusable buffer
+class EntryStream {
+public:
+    EntryStream(ZipWriter& zip, string& buffer) : zip_(zip), buffer_(buffer) { buffer_.clear(); }
+    string& buffer() { return buffer_; }
+    void maybeFlush() {
+        if (buffer_.size() >= kFlushBytes) flush();
+    }
+    void flush() {
+        zip_.write(buffer_);
+        buffer_.clear();
+    }
+
+private:
+    ZipWriter& zip_;
+    string& buffer_;
+};
+
+} // namespace
+
+// Writes data as a one-sheet workbook. Returns true if successful.
+bool writeXlsx(const string& path, const SheetData& data, const string& sheetName) {
+    ZipWriter zip;
+    if (!zip.open(path)) {
+        cerr << "Error: Could not open file for writing: " << path << endl;
+        return false;
+    }
+
+    zip.beginEntry("[Content_Types].xml");
+    zip.write(kContentTypes);
+    zip.beginEntry("_rels/.rels");
+    zip.write(kRootRels);
+    zip.beginEntry("xl/_rels/workbook.xml.rels");
+    zip.write(kWorkbookRels);
+    zip.beginEntry("xl/workbook.xml");
+    string workbook =
+        "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+        "<workbook xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" "
+        "xmlns:r=\"http://schemas.openxmlformats.org/officeDocument/2006/relationships\"><sheets><sheet name=\"";
+    appendXmlEscaped(workbook, sheetName);
+    workbook += "\" sheetId=\"1\" r:id=\"rId1\"/></sheets></workbook>";
+    zip.write(workbook);
+
+    // Worksheet: text cells refer to the shared string table, which is collected on the way.
+    // Cells carry an explicit reference only after a skipped (empty) cell.
+    size_t width = 0;
+    for (const auto& row : data) width = max(width, row.size());
+    vector<string> columnNames(width);
+    for (size_t c = 0; c < width; ++c) columnNames[c] = columnName(c);
+
+    unordered_map<string_view, uint32_t> stringIndex;
+    vector<string_view> strings;
+    size_t stringCells = 0;
+    string buffer;
+    buffer.reserve(kFlushBytes + 4096);
+
+    zip.beginEntry("xl/worksheets/sheet1.xml");
+    EntryStream sheet(zip, buffer);
+    buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+              "<worksheet xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\"><sheetData>";
+    char number[24], index[12];
+    for (size_t r = 0; r < data.size(); ++r) {
+        snprintf(number, sizeof(number), "%zu", r + 1);
+        buffer += "<row r=\"";
+        buffer += number;
+        buffer += "\">";
+        size_t nextCol = 0;
+        for (size_t c = 0; c < data[r].size(); ++c) {
+            string_view cell = data[r][c];
+            if (cell.empty()) continue;
+            buffer += "<c";
+            if (c != nextCol) {
+                buffer += " r=\"";
+                buffer += columnNames[c];
+                buffer += number;
+                buffer += '"';
+            }
+            nextCol = c + 1;
+
+            size_t mark = buffer.size();
+            buffer += "><v>";
+            if (r > 0 && appendNumericValue(buffer, cell)) {
+                buffer += "</v></c>";
+                continue;
+            }
+            buffer.resize(mark);
+            auto it = stringIndex.find(cell);
+            if (it == stringIndex.end()) {
+                it = stringIndex.emplace(cell, static_cast<uint32_t>(strings.size())).first;
+                strings.push_back(cell);
+            }
+            stringCells++;
+            snprintf(index, sizeof(index), "%u", it->second);
+            buffer += " t=\"s\"><v>";
+            buffer += index;
+            buffer += "</v></c>";
+        }
+        buffer += "</row>";
+        sheet.maybeFlush();
+    }
+    buffer += "</sheetData></worksheet>";
+    sheet.flush();
+
+    zip.beginEntry("xl/sharedStrings.xml");
+    EntryStream shared(zip, buffer);
+    buffer += "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+              "<sst xmlns=\"http://schemas.openxmlformats.org/spreadsheetml/2006/main\" count=\"" +
+              to_string(stringCells) + "\" uniqueCount=\"" + to_string(strings.size()) + "\">";
+    for (string_view text : strings) {
+        bool preserve = text.front() == ' ' || text.back() == ' ' || text.front() == '\t' || text.back() == '\t' ||
+                        text.find('\n') != string_view::npos;
+        buffer += preserve ? "<si><t xml:space=\"preserve\">" : "<si><t>";
+        appendXmlEscaped(buffer, text);
+        buffer += "</t></si>";
+        shared.maybeFlush();
+    }
+    buffer += "</sst>";
+    shared.flush();
+
+    if (!zip.close()) {
+        cerr << "Error: Could not write workbook " << path << endl;
+        return false;
+    }
+    return true;
+}
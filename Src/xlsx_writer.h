@@ -0,0 +1,17 @@
+#pragma once
+#include "sheet_data.h"
+#include <string>
+#include <vector>
+
+// Native XLSX export, replacing the html_to_csv_converter.py --csv-to-xlsx round-trip.
+// The worksheet and shared strings XML are streamed straight into a deflated zip
+// container; nothing but the shared string table is held in memory.
+//
+// The first row is written as text (it is the header). Other cells become numbers where
+// the script's try_numeric would convert them: integers ("007", "+5", " 12 "), and
+// decimals containing a '.' (whole values such as "3.0" are stored as integers).
+// Empty cells are left out.
+
+// Writes data as a one-sheet workbook. Returns true if successful.
+bool writeXlsx(const std::string& path, const SheetData& data,
+               const std::string& sheetName = "Sheet1");
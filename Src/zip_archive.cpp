@@ -0,0 +1,636 @@
+#include "zip_archive.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+using namespace std;
+
+namespace {
+
+uint16_t readU16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+uint32_t readU32(const unsigned char* p) {
+    return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) |
+           (static_cast<uint32_t>(p[2]) << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+// LSB-first bit reader over the compressed bytes. Reading past the end yields zero
+// bits and sets overrun, which the caller checks once the stream is done.
+class BitReader {
+public:
+    BitReader(const unsigned char* data, size_t size) : data_(data), size_(size) {}
+
+    uint32_t peek(int n) {
+        while (count_ < n) {
+            uint64_t byte = 0;
+            if (pos_ < size_) byte = data_[pos_];
+            else overrun_ = true;
+            ++pos_;
+            buffer_ |= byte << count_;
+            count_ += 8;
+        }
+        return static_cast<uint32_t>(buffer_ & ((uint64_t(1) << n) - 1));
+    }
+    void drop(int n) {
+        buffer_ >>= n;
+        count_ -= n;
+    }
+    uint32_t bits(int n) {
+        if (n == 0) return 0;
+        uint32_t value = peek(n);
+        drop(n);
+        return value;
+    }
+    // Discards the bits left in the current byte (stored blocks start byte aligned)
+    void alignToByte() { drop(count_ % 8); }
+    bool overrun() const {
+        // Bytes refilled past the end but not consumed are fine
+        return overrun_ && pos_ - static_cast<size_t>(count_ / 8) > size_;
+    }
+
+private:
+    const unsigned char* data_;
+    size_t size_;
+    size_t pos_ = 0;
+    uint64_t buffer_ = 0;
+    int count_ = 0;
+    bool overrun_ = false;
+};
+
+const int kMaxBits = 15;
+const int kFastBits = 10;
+
+// Canonical Huffman decoder: a 10-bit lookup table for short codes and the
+// count/symbol walk from zlib's puff.c for the longer ones.
+struct Huffman {
+    uint16_t count[kMaxBits + 1];
+    uint16_t symbol[288];
+    uint16_t fast[1 << kFastBits]; // (length << 9) | symbol, 0 if the code is longer
+
+    // Returns false for an over-subscribed code set (incomplete sets are allowed)
+    bool build(const uint8_t* lengths, int n) {
+        memset(count, 0, sizeof(count));
+        memset(fast, 0, sizeof(fast));
+        for (int i = 0; i < n; ++i) count[lengths[i]]++;
+        if (count[0] == n) return true;
+        int left = 1;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            left <<= 1;
+            left -= count[len];
+            if (left < 0) return false;
+        }
+        uint16_t offsets[kMaxBits + 1];
+        uint16_t nextCode[kMaxBits + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < kMaxBits; ++len) offsets[len + 1] = offsets[len] + count[len];
+        uint16_t code = 0;
+        count[0] = 0;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            code = static_cast<uint16_t>((code + count[len - 1]) << 1);
+            nextCode[len] = code;
+        }
+        for (int sym = 0; sym < n; ++sym) {
+            int len = lengths[sym];
+            if (len == 0) continue;
+            symbol[offsets[len]++] = static_cast<uint16_t>(sym);
+            if (len > kFastBits) continue;
+            // Codes are sent MSB first but read LSB first, so index the table by the reversed code
+            uint32_t c = nextCode[len]++, reversed = 0;
+            for (int b = 0; b < len; ++b) reversed |= ((c >> b) & 1) << (len - 1 - b);
+            for (uint32_t k = reversed; k < (1u << kFastBits); k += 1u << len)
+                fast[k] = static_cast<uint16_t>((len << 9) | sym);
+        }
+        return true;
+    }
+
+    // Returns the next symbol, or -1 if the bits do not form a code
+    int decode(BitReader& in) const {
+        uint16_t entry = fast[in.peek(kFastBits)];
+        if (entry != 0) {
+            in.drop(entry >> 9);
+            return entry & 0x1FF;
+        }
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= kMaxBits; ++len) {
+            code |= static_cast<int>(in.bits(1));
+            int n = count[len];
+            if (code - n < first) return symbol[index + (code - first)];
+            index += n;
+            first += n;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+const uint16_t kLengthBase[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                  35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+const uint8_t kLengthExtra[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                  3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+const uint16_t kDistBase[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129,
+                                193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097,
+                                6145, 8193, 12289, 16385, 24577};
+const uint8_t kDistExtra[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6,
+                                6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Decodes one Huffman-coded block
+bool inflateBlock(BitReader& in, const Huffman& lit, const Huffman& dist, string& out, size_t start) {
+    while (true) {
+        int sym = lit.decode(in);
+        if (sym < 0) return false;
+        if (sym < 256) {
+            out += static_cast<char>(sym);
+        } else if (sym == 256) {
+            return true;
+        } else {
+            sym -= 257;
+            if (sym >= 29) return false;
+            size_t length = kLengthBase[sym] + in.bits(kLengthExtra[sym]);
+            int dsym = dist.decode(in);
+            if (dsym < 0 || dsym >= 30) return false;
+            size_t distance = kDistBase[dsym] + in.bits(kDistExtra[dsym]);
+            if (distance > out.size() - start) return false;
+            size_t from = out.size() - distance;
+            for (size_t i = 0; i < length; ++i) out += out[from + i];
+        }
+        if (in.overrun()) return false;
+    }
+}
+
+} // namespace
+
+// Decompresses a raw deflate stream (RFC 1951) and appends it to out
+bool inflateRaw(const unsigned char* data, size_t size, string& out) {
+    BitReader in(data, size);
+    size_t start = out.size();
+    Huffman lit, dist;
+    bool last = false;
+    while (!last) {
+        last = in.bits(1) == 1;
+        uint32_t type = in.bits(2);
+        if (type == 0) {
+            in.alignToByte();
+            uint32_t len = in.bits(16);
+            uint32_t nlen = in.bits(16);
+            if (len != (~nlen & 0xFFFF)) return false;
+            for (uint32_t i = 0; i < len; ++i) out += static_cast<char>(in.bits(8));
+        } else if (type == 1) {
+            uint8_t lengths[288 + 30];
+            int i = 0;
+            for (; i < 144; ++i) lengths[i] = 8;
+            for (; i < 256; ++i) lengths[i] = 9;
+            for (; i < 280; ++i) lengths[i] = 7;
+            for (; i < 288; ++i) lengths[i] = 8;
+            for (; i < 288 + 30; ++i) lengths[i] = 5;
+            lit.build(lengths, 288);
+            dist.build(lengths + 288, 30);
+            if (!inflateBlock(in, lit, dist, out, start)) return false;
+        } else if (type == 2) {
+            static const uint8_t order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+            int nlit = in.bits(5) + 257;
+            int ndist = in.bits(5) + 1;
+            int ncode = in.bits(4) + 4;
+            if (nlit > 286 || ndist > 30) return false;
+            uint8_t lengths[288 + 30] = {0};
+            for (int i = 0; i < ncode; ++i) lengths[order[i]] = static_cast<uint8_t>(in.bits(3));
+            Huffman codeLengths;
+            if (!codeLengths.build(lengths, 19)) return false;
+            int index = 0;
+            while (index < nlit + ndist) {
+                int sym = codeLengths.decode(in);
+                if (sym < 0) return false;
+                if (sym < 16) {
+                    lengths[index++] = static_cast<uint8_t>(sym);
+                    continue;
+                }
+                uint8_t value = 0;
+                int repeat;
+                if (sym == 16) {
+                    if (index == 0) return false;
+                    value = lengths[index - 1];
+                    repeat = 3 + in.bits(2);
+                } else if (sym == 17) {
+                    repeat = 3 + in.bits(3);
+                } else {
+                    repeat = 11 + in.bits(7);
+                }
+                if (index + repeat > nlit + ndist) return false;
+                while (repeat--) lengths[index++] = value;
+            }
+            if (lengths[256] == 0) return false; // no end-of-block code
+            if (!lit.build(lengths, nlit) || !dist.build(lengths + nlit, ndist)) return false;
+            if (!inflateBlock(in, lit, dist, out, start)) return false;
+        } else {
+            return false;
+        }
+        if (in.overrun()) return false;
+    }
+    return true;
+}
+
+// Maps the archive and reads its central directory. Returns true if successful.
+bool ZipReader::open(const string& path) {
+    entries_.clear();
+    if (!file_.open(path)) return false;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file_.data());
+    size_t size = file_.size();
+    if (size < 22) return false;
+
+    // The end-of-central-directory record sits at the end, before an optional comment
+    size_t eocd = size - 22;
+    size_t lowest = size > 22 + 65535 ? size - 22 - 65535 : 0;
+    while (readU32(data + eocd) != 0x06054b50) {
+        if (eocd == lowest) return false;
+        --eocd;
+    }
+    uint16_t entryCount = readU16(data + eocd + 10);
+    uint32_t directoryOffset = readU32(data + eocd + 16);
+
+    size_t pos = directoryOffset;
+    for (uint16_t i = 0; i < entryCount; ++i) {
+        if (pos + 46 > size || readU32(data + pos) != 0x02014b50) return false;
+        Entry entry;
+        entry.method = readU16(data + pos + 10);
+        entry.compressedSize = readU32(data + pos + 20);
+        entry.uncompressedSize = readU32(data + pos + 24);
+        uint16_t nameLength = readU16(data + pos + 28);
+        uint16_t extraLength = readU16(data + pos + 30);
+        uint16_t commentLength = readU16(data + pos + 32);
+        entry.localHeaderOffset = readU32(data + pos + 42);
+        if (pos + 46 + nameLength > size) return false;
+        entry.name.assign(reinterpret_cast<const char*>(data + pos + 46), nameLength);
+        entries_.push_back(entry);
+        pos += 46 + nameLength + extraLength + commentLength;
+    }
+    return true;
+}
+
+const ZipReader::Entry* ZipReader::find(const string& name) const {
+    for (const Entry& entry : entries_) {
+        if (entry.name == name) return &entry;
+    }
+    return nullptr;
+}
+
+bool ZipReader::contains(const string& name) const {
+    return find(name) != nullptr;
+}
+
+// Decompresses one entry into out. Returns true if successful.
+bool ZipReader::read(const string& name, string& out) const {
+    out.clear();
+    const Entry* entry = find(name);
+    if (entry == nullptr) return false;
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(file_.data());
+    size_t size = file_.size();
+    size_t header = entry->localHeaderOffset;
+    if (header + 30 > size || readU32(data + header) != 0x04034b50) return false;
+    size_t start = header + 30 + readU16(data + header + 26) + readU16(data + header + 28);
+    if (start + entry->compressedSize > size) return false;
+
+    if (entry->method == 0) {
+        out.assign(reinterpret_cast<const char*>(data + start), entry->compressedSize);
+        return true;
+    }
+    if (entry->method == 8) {
+        out.reserve(entry->uncompressedSize);
+        return inflateRaw(data + start, entry->compressedSize, out);
+    }
+    return false;
+}
+
+namespace {
+
+void appendU16(string& out, uint32_t value) {
+    out += static_cast<char>(value & 0xFF);
+    out += static_cast<char>((value >> 8) & 0xFF);
+}
+
+void appendU32(string& out, uint32_t value) {
+    appendU16(out, value & 0xFFFF);
+    appendU16(out, value >> 16);
+}
+
+const size_t kWindowSize = 32768;
+const size_t kWindowMask = kWindowSize - 1;
+const size_t kMaxMatch = 258;
+const int kHashBits = 15;
+const int kMaxChain = 8;                 // candidates tried per position
+const size_t kMaxInsertLength = 32;      // longer matches do not index their inner positions
+const size_t kCompressStep = 256 * 1024; // pending bytes compressed per step
+
+// Index of the lowest nonzero byte of a little-endian word
+inline size_t lowestSetByte(uint64_t x) {
+#ifdef _MSC_VER
+    unsigned long index;
+    _BitScanForward64(&index, x);
+    return index / 8;
+#else
+    return static_cast<size_t>(__builtin_ctzll(x)) / 8;
+#endif
+}
+
+inline uint32_t hash3(const unsigned char* p) {
+    uint32_t v = p[0] | (p[1] << 8) | (p[2] << 16);
+    return (v * 2654435761u) >> (32 - kHashBits);
+}
+
+inline uint16_t reverseBits(uint32_t code, int length) {
+    uint32_t reversed = 0;
+    for (int b = 0; b < length; ++b) reversed |= ((code >> b) & 1) << (length - 1 - b);
+    return static_cast<uint16_t>(reversed);
+}
+
+// Fixed Huffman codes (RFC 1951 3.2.6), bit-reversed for LSB-first output, and the
+// length -> length symbol table
+struct FixedCodes {
+    uint16_t litBits[288];
+    uint8_t litLength[288];
+    uint16_t distBits[30];
+    uint8_t lengthSymbol[kMaxMatch + 1]; // match length -> symbol - 257
+
+    FixedCodes() {
+        for (int sym = 0; sym < 288; ++sym) {
+            uint32_t code;
+            int length;
+            if (sym < 144) code = 0x30 + sym, length = 8;
+            else if (sym < 256) code = 0x190 + (sym - 144), length = 9;
+            else if (sym < 280) code = sym - 256, length = 7;
+            else code = 0xC0 + (sym - 280), length = 8;
+            litBits[sym] = reverseBits(code, length);
+            litLength[sym] = static_cast<uint8_t>(length);
+        }
+        for (int sym = 0; sym < 30; ++sym) distBits[sym] = reverseBits(sym, 5);
+        for (int sym = 0; sym < 29; ++sym) {
+            for (size_t len = kLengthBase[sym]; len < kLengthBase[sym] + (1u << kLengthExtra[sym]) && len <= kMaxMatch; ++len)
+                lengthSymbol[len] = static_cast<uint8_t>(sym); // 258 ends up on symbol 285, as it must
+        }
+    }
+};
+
+const FixedCodes& fixedCodes() {
+    static const FixedCodes codes;
+    return codes;
+}
+
+// Length of the common prefix of a and b, up to maxLength; compares 8 bytes at a time
+inline size_t matchLength(const unsigned char* a, const unsigned char* b, size_t maxLength) {
+    size_t length = 0;
+    while (length + 8 <= maxLength) {
+        uint64_t x, y;
+        memcpy(&x, a + length, 8);
+        memcpy(&y, b + length, 8);
+        if (x != y) return length + lowestSetByte(x ^ y);
+        length += 8;
+    }
+    while (length < maxLength && a[length] == b[length]) ++length;
+    return length;
+}
+
+inline int distanceSymbol(size_t distance) {
+    return static_cast<int>(upper_bound(kDistBase, kDistBase + 30, distance) - kDistBase) - 1;
+}
+
+} // namespace
+
+// CRC-32 (as used by zip) of data, continuing from a previous crc (0 to start)
+uint32_t crc32(uint32_t crc, const char* data, size_t size) {
+    static const vector<uint32_t> table = []() {
+        vector<uint32_t> t(256);
+        for (uint32_t n = 0; n < 256; ++n) {
+            uint32_t c = n;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[n] = c;
+        }
+        return t;
+    }();
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) crc = table[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+Deflater::Deflater() : head_(size_t(1) << kHashBits, -1), prev_(kWindowSize, -1) {}
+
+// Queues count (<= 16) bits; whole 32-bit words are moved to out
+void Deflater::putBits(uint32_t value, int count, string& out) {
+    bits_ |= static_cast<uint64_t>(value) << bitCount_;
+    bitCount_ += count;
+    if (bitCount_ >= 32) {
+        char word[4] = {static_cast<char>(bits_), static_cast<char>(bits_ >> 8), static_cast<char>(bits_ >> 16),
+                        static_cast<char>(bits_ >> 24)};
+        out.append(word, 4);
+        bits_ >>= 32;
+        bitCount_ -= 32;
+    }
+}
+
+void Deflater::putSymbol(int symbol, string& out) {
+    const FixedCodes& codes = fixedCodes();
+    putBits(codes.litBits[symbol], codes.litLength[symbol], out);
+}
+
+void Deflater::insertHash(uint64_t pos) {
+    uint32_t h = hash3(reinterpret_cast<const unsigned char*>(buffer_.data()) + (pos - bufferStart_));
+    prev_[pos & kWindowMask] = head_[h];
+    head_[h] = static_cast<int64_t>(pos);
+}
+
+void Deflater::write(const char* data, size_t size, string& out) {
+    buffer_.append(data, size);
+    // Keep kMaxMatch bytes of lookahead so matches are not cut at the step boundary
+    while (bufferStart_ + buffer_.size() - next_ >= kCompressStep + kMaxMatch) {
+        compress(next_ + kCompressStep, out);
+        size_t behind = static_cast<size_t>(next_ - bufferStart_);
+        if (behind > kWindowSize) { // drop what is out of the window's reach
+            buffer_.erase(0, behind - kWindowSize);
+            bufferStart_ += behind - kWindowSize;
+        }
+    }
+}
+
+// Encodes the input from next_ up to (about) end into the open fixed-Huffman block
+void Deflater::compress(uint64_t end, string& out) {
+    if (!blockOpen_) {
+        putBits(0, 1, out); // BFINAL = 0
+        putBits(1, 2, out); // BTYPE = 01, fixed codes
+        blockOpen_ = true;
+    }
+    const FixedCodes& codes = fixedCodes();
+    const unsigned char* data = reinterpret_cast<const unsigned char*>(buffer_.data());
+    uint64_t available = bufferStart_ + buffer_.size();
+    while (next_ < end) {
+        const unsigned char* cur = data + (next_ - bufferStart_);
+        size_t bestLength = 0, bestDistance = 0;
+        if (available - next_ >= 3) {
+            size_t maxLength = static_cast<size_t>(min<uint64_t>(kMaxMatch, available - next_));
+            uint32_t h = hash3(cur);
+            int64_t candidate = head_[h];
+            for (int chain = kMaxChain; chain > 0 && candidate >= static_cast<int64_t>(bufferStart_) &&
+                                        next_ - candidate <= kWindowSize; --chain) {
+                const unsigned char* match = data + (candidate - bufferStart_);
+                if (match[bestLength] == cur[bestLength]) {
+                    size_t length = matchLength(match, cur, maxLength);
+                    if (length > bestLength) {
+                        bestLength = length;
+                        bestDistance = static_cast<size_t>(next_ - candidate);
+                        if (length == maxLength) break;
+                    }
+                }
+                int64_t older = prev_[candidate & kWindowMask];
+                if (older >= candidate) break; // the slot was reused by a newer position
+                candidate = older;
+            }
+            prev_[next_ & kWindowMask] = head_[h];
+            head_[h] = static_cast<int64_t>(next_);
+        }
+
+        if (bestLength >= 3) {
+            int lsym = codes.lengthSymbol[bestLength];
+            putSymbol(257 + lsym, out);
+            putBits(static_cast<uint32_t>(bestLength - kLengthBase[lsym]), kLengthExtra[lsym], out);
+            int dsym = distanceSymbol(bestDistance);
+            putBits(codes.distBits[dsym], 5, out);
+            putBits(static_cast<uint32_t>(bestDistance - kDistBase[dsym]), kDistExtra[dsym], out);
+            if (bestLength <= kMaxInsertLength) {
+                for (size_t k = 1; k < bestLength; ++k) {
+                    if (available - (next_ + k) >= 3) insertHash(next_ + k);
+                }
+            }
+            next_ += bestLength;
+        } else {
+            putSymbol(*cur, out);
+            ++next_;
+        }
+    }
+}
+
+// Compresses the buffered input and ends the stream; the deflater can then be reused
+void Deflater::finish(string& out) {
+    compress(bufferStart_ + buffer_.size(), out);
+    putSymbol(256, out); // end of the open block
+    putBits(1, 1, out);  // an empty final block
+    putBits(1, 2, out);
+    putSymbol(256, out);
+    while (bitCount_ > 0) { // the last partial word, padded to a whole byte
+        out += static_cast<char>(bits_ & 0xFF);
+        bits_ >>= 8;
+        bitCount_ = max(bitCount_ - 8, 0);
+    }
+
+    buffer_.clear();
+    bufferStart_ = next_ = 0;
+    fill(head_.begin(), head_.end(), -1);
+    fill(prev_.begin(), prev_.end(), -1);
+    bits_ = 0;
+    bitCount_ = 0;
+    blockOpen_ = false;
+}
+
+// Creates the archive at path. Returns true if successful.
+bool ZipWriter::open(const string& path) {
+    file_.open(path.c_str(), ios::binary | ios::trunc);
+    entries_.clear();
+    output_.clear();
+    offset_ = 0;
+    inEntry_ = false;
+    return file_.is_open();
+}
+
+bool ZipWriter::beginEntry(const string& name) {
+    if (inEntry_ && !endEntry()) return false;
+    Entry entry = {name, 0, 0, 0, static_cast<uint32_t>(offset_)};
+    entries_.push_back(entry);
+
+    appendU32(output_, 0x04034b50);
+    appendU16(output_, 20);     // version needed (deflate)
+    appendU16(output_, 0x0808); // sizes in a data descriptor, UTF-8 name
+    appendU16(output_, 8);      // deflate
+    appendU16(output_, 0);      // time 00:00
+    appendU16(output_, 0x21);   // date 1980-01-01
+    appendU32(output_, 0);      // crc and sizes follow the data
+    appendU32(output_, 0);
+    appendU32(output_, 0);
+    appendU16(output_, static_cast<uint32_t>(name.size()));
+    appendU16(output_, 0);
+    output_ += name;
+    flushOutput();
+
+    entryStart_ = offset_;
+    crc_ = 0;
+    uncompressed_ = 0;
+    inEntry_ = true;
+    return true;
+}
+
+void ZipWriter::write(string_view data) {
+    crc_ = crc32(crc_, data.data(), data.size());
+    uncompressed_ += data.size();
+    deflater_.write(data.data(), data.size(), output_);
+    if (output_.size() >= (1u << 20)) flushOutput();
+}
+
+bool ZipWriter::endEntry() {
+    if (!inEntry_) return false;
+    inEntry_ = false;
+    deflater_.finish(output_);
+    flushOutput();
+    Entry& entry = entries_.back();
+    entry.crc = crc_;
+    entry.compressedSize = static_cast<uint32_t>(offset_ - entryStart_);
+    entry.uncompressedSize = static_cast<uint32_t>(uncompressed_);
+
+    appendU32(output_, 0x08074b50);
+    appendU32(output_, entry.crc);
+    appendU32(output_, entry.compressedSize);
+    appendU32(output_, entry.uncompressedSize);
+    flushOutput();
+    return uncompressed_ <= 0xFFFFFFFFu && offset_ <= 0xFFFFFFFFu;
+}
+
+// Writes the central directory and closes the file. Returns true if everything was written.
+bool ZipWriter::close() {
+    bool ok = !inEntry_ || endEntry();
+    uint64_t directoryOffset = offset_;
+    for (const Entry& entry : entries_) {
+        appendU32(output_, 0x02014b50);
+        appendU16(output_, 20);     // version made by
+        appendU16(output_, 20);     // version needed
+        appendU16(output_, 0x0808);
+        appendU16(output_, 8);
+        appendU16(output_, 0);
+        appendU16(output_, 0x21);
+        appendU32(output_, entry.crc);
+        appendU32(output_, entry.compressedSize);
+        appendU32(output_, entry.uncompressedSize);
+        appendU16(output_, static_cast<uint32_t>(entry.name.size()));
+        appendU16(output_, 0);      // extra field
+        appendU16(output_, 0);      // comment
+        appendU16(output_, 0);      // disk
+        appendU16(output_, 0);      // internal attributes
+        appendU32(output_, 0);      // external attributes
+        appendU32(output_, entry.localHeaderOffset);
+        output_ += entry.name;
+    }
+    uint64_t directorySize = offset_ + output_.size() - directoryOffset;
+    appendU32(output_, 0x06054b50);
+    appendU16(output_, 0);
+    appendU16(output_, 0);
+    appendU16(output_, static_cast<uint32_t>(entries_.size()));
+    appendU16(output_, static_cast<uint32_t>(entries_.size()));
+    appendU32(output_, static_cast<uint32_t>(directorySize));
+    appendU32(output_, static_cast<uint32_t>(directoryOffset));
+    appendU16(output_, 0);
+    flushOutput();
+    file_.close();
+    return ok && !file_.fail() && entries_.size() <= 0xFFFF && offset_ <= 0xFFFFFFFFu;
+}
+
+void ZipWriter::flushOutput() {
+    file_.write(output_.data(), static_cast<streamsize>(output_.size()));
+    offset_ += output_.size();
+    output_.clear();
+}
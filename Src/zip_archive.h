@@ -0,0 +1,102 @@
+#pragma once
+#include "mapped_file.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Read-only access to the entries of a zip file (as used by .xlsx workbooks).
+// Supports stored and deflated entries; zip64 archives are not supported.
+class ZipReader {
+public:
+    // Maps the archive and reads its central directory. Returns true if successful.
+    bool open(const std::string& path);
+
+    bool contains(const std::string& name) const;
+
+    // Decompresses one entry into out. Returns true if successful.
+    bool read(const std::string& name, std::string& out) const;
+
+private:
+    struct Entry {
+        std::string name;
+        uint16_t method;
+        uint32_t compressedSize;
+        uint32_t uncompressedSize;
+        uint32_t localHeaderOffset;
+    };
+    const Entry* find(const std::string& name) const;
+
+    MappedFile file_;
+    std::vector<Entry> entries_;
+};
+
+// Decompresses a raw deflate stream (RFC 1951) and appends it to out.
+// Returns false if the stream is corrupt or truncated.
+bool inflateRaw(const unsigned char* data, size_t size, std::string& out);
+
+// CRC-32 (as used by zip) of data, continuing from a previous crc (0 to start)
+uint32_t crc32(uint32_t crc, const char* data, size_t size);
+
+// Streaming raw deflate (RFC 1951) compressor: LZ77 matches over the 32 KB window found
+// through hash chains, encoded with the fixed Huffman codes. Input is buffered and
+// compressed in large steps; compressed bytes are appended to out as they are produced.
+class Deflater {
+public:
+    Deflater();
+    void write(const char* data, size_t size, std::string& out);
+    // Compresses the buffered input and ends the stream; the deflater can then be reused
+    void finish(std::string& out);
+
+private:
+    void compress(uint64_t end, std::string& out);
+    void putBits(uint32_t value, int count, std::string& out);
+    void putSymbol(int symbol, std::string& out);
+    void insertHash(uint64_t pos);
+
+    std::string buffer_;          // the window before next_ followed by the pending input
+    uint64_t bufferStart_ = 0;    // stream position of buffer_[0]
+    uint64_t next_ = 0;           // stream position of the next byte to encode
+    std::vector<int64_t> head_;   // hash of 3 bytes -> latest position holding them
+    std::vector<int64_t> prev_;   // position & window mask -> previous position with the same hash
+    uint64_t bits_ = 0;
+    int bitCount_ = 0;
+    bool blockOpen_ = false;
+};
+
+// Writes a zip archive entry by entry, deflating each entry as it is written.
+// Sizes and CRCs follow each entry's data (data descriptors), so nothing is buffered
+// whole; zip64 is not supported (entries and archive below 4 GB).
+class ZipWriter {
+public:
+    // Creates the archive at path. Returns true if successful.
+    bool open(const std::string& path);
+
+    bool beginEntry(const std::string& name);
+    void write(std::string_view data);
+    bool endEntry();
+
+    // Writes the central directory and closes the file. Returns true if everything was written.
+    bool close();
+
+private:
+    struct Entry {
+        std::string name;
+        uint32_t crc;
+        uint32_t compressedSize;
+        uint32_t uncompressedSize;
+        uint32_t localHeaderOffset;
+    };
+    void flushOutput();
+
+    std::ofstream file_;
+    std::vector<Entry> entries_;
+    Deflater deflater_;
+    std::string output_;   // compressed bytes waiting to be written
+    uint64_t offset_ = 0;  // bytes written to the file so far
+    uint64_t entryStart_ = 0;
+    uint32_t crc_ = 0;
+    uint64_t uncompressed_ = 0;
+    bool inEntry_ = false;
+};